@@ -0,0 +1,486 @@
+/* swc: bench/client.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/* A synthetic client for swc-bench. It shows a single toplevel, damages a
+ * moving rectangle of it at a fixed rate, and reports the latency of each
+ * frame to the server when it is done. */
+
+#include <drm_fourcc.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+#include <wayland-client.h>
+#include <wld/wld.h>
+#include <wld/drm.h>
+#include "linux-dmabuf-unstable-v1-client-protocol.h"
+#include "xdg-shell-client-protocol.h"
+
+#define DEFAULT_SIZE 256
+
+struct buffer {
+	struct wl_buffer *wl;
+	struct wld_buffer *wld;
+	void *data;
+	size_t size;
+	uint32_t stride;
+	bool busy;
+};
+
+static struct {
+	bool dmabuf;
+	unsigned rate;
+	uint32_t damage_width, damage_height;
+	unsigned duration;
+	int fd;
+} config = {
+	.rate = 60,
+	.damage_width = 64,
+	.damage_height = 64,
+	.duration = 10,
+	.fd = -1,
+};
+
+static struct wl_display *display;
+static struct wl_compositor *compositor;
+static struct wl_shm *shm;
+static struct zwp_linux_dmabuf_v1 *dmabuf;
+static struct xdg_wm_base *wm_base;
+static struct wld_context *context;
+
+static struct wl_surface *surface;
+static struct xdg_surface *xdg_surface;
+static struct xdg_toplevel *toplevel;
+static struct buffer buffers[2];
+static uint32_t width = DEFAULT_SIZE, height = DEFAULT_SIZE;
+static uint32_t pending_width, pending_height;
+static bool configured, running = true;
+
+static struct wl_callback *frame;
+static uint64_t commit_time;
+static uint32_t *latencies;
+static uint32_t num_latencies, max_latencies, missed;
+static unsigned step;
+
+static uint64_t
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void
+die(const char *message)
+{
+	fprintf(stderr, "swc-bench-client: %s\n", message);
+	exit(EXIT_FAILURE);
+}
+
+/* Buffers {{{ */
+
+static void
+handle_release(void *data, struct wl_buffer *wl)
+{
+	struct buffer *buffer = data;
+
+	buffer->busy = false;
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+	.release = handle_release,
+};
+
+static bool
+create_shm_buffer(struct buffer *buffer)
+{
+	struct wl_shm_pool *pool;
+	int fd;
+
+	buffer->stride = width * 4;
+	buffer->size = buffer->stride * height;
+	if ((fd = memfd_create("swc-bench", MFD_CLOEXEC)) < 0)
+		return false;
+	if (ftruncate(fd, buffer->size) < 0)
+		goto error;
+	buffer->data = mmap(NULL, buffer->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (buffer->data == MAP_FAILED)
+		goto error;
+	pool = wl_shm_create_pool(shm, fd, buffer->size);
+	buffer->wl = wl_shm_pool_create_buffer(pool, 0, width, height, buffer->stride, WL_SHM_FORMAT_XRGB8888);
+	wl_shm_pool_destroy(pool);
+	close(fd);
+
+	return true;
+
+error:
+	close(fd);
+	return false;
+}
+
+static bool
+create_dmabuf_buffer(struct buffer *buffer)
+{
+	struct zwp_linux_buffer_params_v1 *params;
+	union wld_object object;
+	uint64_t modifier = DRM_FORMAT_MOD_INVALID;
+
+	buffer->wld = wld_create_buffer(context, width, height, WLD_FORMAT_XRGB8888, WLD_FLAG_MAP);
+	if (!buffer->wld)
+		return false;
+	if (!wld_export(buffer->wld, WLD_DRM_OBJECT_PRIME_FD, &object)) {
+		wld_buffer_unreference(buffer->wld);
+		return false;
+	}
+	buffer->stride = buffer->wld->pitch;
+	params = zwp_linux_dmabuf_v1_create_params(dmabuf);
+	zwp_linux_buffer_params_v1_add(params, object.i, 0, 0, buffer->stride, modifier >> 32, modifier & 0xffffffff);
+	buffer->wl = zwp_linux_buffer_params_v1_create_immed(params, width, height, DRM_FORMAT_XRGB8888, 0);
+	zwp_linux_buffer_params_v1_destroy(params);
+	close(object.i);
+
+	return true;
+}
+
+static void
+destroy_buffer(struct buffer *buffer)
+{
+	if (!buffer->wl)
+		return;
+	wl_buffer_destroy(buffer->wl);
+	if (buffer->wld)
+		wld_buffer_unreference(buffer->wld);
+	else
+		munmap(buffer->data, buffer->size);
+	memset(buffer, 0, sizeof(*buffer));
+}
+
+static void
+create_buffers(void)
+{
+	unsigned i;
+
+	for (i = 0; i < 2; ++i) {
+		destroy_buffer(&buffers[i]);
+		if (!(config.dmabuf ? create_dmabuf_buffer(&buffers[i]) : create_shm_buffer(&buffers[i])))
+			die("could not create buffer");
+		wl_buffer_add_listener(buffers[i].wl, &buffer_listener, &buffers[i]);
+	}
+}
+
+/* Fill a rectangle of the buffer with a color that changes every frame. */
+static void
+draw(struct buffer *buffer, int32_t x, int32_t y, uint32_t w, uint32_t h)
+{
+	uint32_t color = 0xff000000 | step * 0x010305, *row, i, j;
+	char *data;
+
+	if (buffer->wld) {
+		if (!wld_map(buffer->wld))
+			return;
+		data = buffer->wld->map;
+	} else {
+		data = buffer->data;
+	}
+	for (i = 0; i < h; ++i) {
+		row = (uint32_t *)(data + (y + i) * buffer->stride) + x;
+		for (j = 0; j < w; ++j)
+			row[j] = color;
+	}
+	if (buffer->wld)
+		wld_unmap(buffer->wld);
+}
+
+/* }}} */
+
+/* Frames {{{ */
+
+static void
+handle_frame(void *data, struct wl_callback *callback, uint32_t time)
+{
+	wl_callback_destroy(callback);
+	frame = NULL;
+	if (num_latencies == max_latencies) {
+		max_latencies = max_latencies ? max_latencies * 2 : 1024;
+		if (!(latencies = realloc(latencies, max_latencies * sizeof(*latencies))))
+			die("out of memory");
+	}
+	latencies[num_latencies++] = (now() - commit_time) / 1000;
+}
+
+static const struct wl_callback_listener frame_listener = {
+	.done = handle_frame,
+};
+
+static void
+tick(void)
+{
+	struct buffer *buffer = NULL;
+	uint32_t w, h;
+	int32_t x, y;
+	unsigned i;
+
+	if (!configured)
+		return;
+	if (frame) {
+		++missed;
+		return;
+	}
+	if (pending_width && pending_height && (pending_width != width || pending_height != height)) {
+		width = pending_width;
+		height = pending_height;
+		create_buffers();
+	}
+	for (i = 0; i < 2; ++i) {
+		if (!buffers[i].busy) {
+			buffer = &buffers[i];
+			break;
+		}
+	}
+	if (!buffer) {
+		++missed;
+		return;
+	}
+
+	/* Sweep the damage across the window. */
+	w = config.damage_width < width ? config.damage_width : width;
+	h = config.damage_height < height ? config.damage_height : height;
+	x = step * 8 % (width - w + 1);
+	y = step * 8 / (width - w + 1) * h % (height - h + 1);
+	draw(buffer, x, y, w, h);
+	++step;
+
+	wl_surface_attach(surface, buffer->wl, 0, 0);
+	wl_surface_damage_buffer(surface, x, y, w, h);
+	frame = wl_surface_frame(surface);
+	wl_callback_add_listener(frame, &frame_listener, NULL);
+	wl_surface_commit(surface);
+	buffer->busy = true;
+	commit_time = now();
+}
+
+/* }}} */
+
+/* Shell {{{ */
+
+static void
+handle_ping(void *data, struct xdg_wm_base *wm_base, uint32_t serial)
+{
+	xdg_wm_base_pong(wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener wm_base_listener = {
+	.ping = handle_ping,
+};
+
+static void
+handle_surface_configure(void *data, struct xdg_surface *xdg_surface, uint32_t serial)
+{
+	xdg_surface_ack_configure(xdg_surface, serial);
+	if (!configured) {
+		configured = true;
+		if (pending_width && pending_height) {
+			width = pending_width;
+			height = pending_height;
+		}
+		create_buffers();
+	}
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+	.configure = handle_surface_configure,
+};
+
+static void
+handle_toplevel_configure(void *data, struct xdg_toplevel *toplevel, int32_t w, int32_t h, struct wl_array *states)
+{
+	pending_width = w;
+	pending_height = h;
+}
+
+static void
+handle_close(void *data, struct xdg_toplevel *toplevel)
+{
+	running = false;
+}
+
+static const struct xdg_toplevel_listener toplevel_listener = {
+	.configure = handle_toplevel_configure,
+	.close = handle_close,
+};
+
+static void
+handle_global(void *data, struct wl_registry *registry, uint32_t name, const char *interface, uint32_t version)
+{
+	if (strcmp(interface, "wl_compositor") == 0) {
+		compositor = wl_registry_bind(registry, name, &wl_compositor_interface, 4);
+	} else if (strcmp(interface, "wl_shm") == 0) {
+		shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+	} else if (strcmp(interface, "xdg_wm_base") == 0) {
+		wm_base = wl_registry_bind(registry, name, &xdg_wm_base_interface, 1);
+		xdg_wm_base_add_listener(wm_base, &wm_base_listener, NULL);
+	} else if (strcmp(interface, "zwp_linux_dmabuf_v1") == 0 && version >= 3) {
+		dmabuf = wl_registry_bind(registry, name, &zwp_linux_dmabuf_v1_interface, 3);
+	}
+}
+
+static void
+handle_global_remove(void *data, struct wl_registry *registry, uint32_t name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+	.global = handle_global,
+	.global_remove = handle_global_remove,
+};
+
+/* }}} */
+
+static void
+report(void)
+{
+	uint32_t header[2] = {missed, num_latencies};
+	size_t size = num_latencies * sizeof(*latencies);
+	ssize_t ret;
+	char *data = (char *)latencies;
+
+	if (config.fd == -1)
+		return;
+	if (write(config.fd, header, sizeof(header)) != sizeof(header))
+		return;
+	while (size > 0 && (ret = write(config.fd, data, size)) > 0) {
+		data += ret;
+		size -= ret;
+	}
+	close(config.fd);
+}
+
+static void
+usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-t shm|dmabuf] [-r rate] [-a WxH] [-d seconds] [-f fd]\n", name);
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct wl_registry *registry;
+	struct itimerspec interval = {0};
+	struct pollfd fds[2];
+	uint64_t end, expirations;
+	const char *node;
+	int option, fd;
+
+	while ((option = getopt(argc, argv, "t:r:a:d:f:")) != -1) {
+		switch (option) {
+		case 't':
+			config.dmabuf = strcmp(optarg, "dmabuf") == 0;
+			break;
+		case 'r':
+			config.rate = strtoul(optarg, NULL, 10);
+			break;
+		case 'a':
+			if (sscanf(optarg, "%ux%u", &config.damage_width, &config.damage_height) != 2)
+				usage(argv[0]);
+			break;
+		case 'd':
+			config.duration = strtoul(optarg, NULL, 10);
+			break;
+		case 'f':
+			config.fd = strtol(optarg, NULL, 10);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (config.rate == 0 || config.damage_width == 0 || config.damage_height == 0)
+		usage(argv[0]);
+
+	if (!(display = wl_display_connect(NULL)))
+		die("could not connect to display");
+	registry = wl_display_get_registry(display);
+	wl_registry_add_listener(registry, &registry_listener, NULL);
+	wl_display_roundtrip(display);
+	if (!compositor || !shm || !wm_base)
+		die("missing required globals");
+
+	if (config.dmabuf) {
+		if (!dmabuf)
+			die("compositor does not support linux-dmabuf");
+		if (!(node = getenv("SWC_BENCH_RENDER_NODE")))
+			node = "/dev/dri/renderD128";
+		if ((fd = open(node, O_RDWR | O_CLOEXEC)) < 0 || !(context = wld_drm_create_context(fd)))
+			die("could not open render node");
+	}
+
+	surface = wl_compositor_create_surface(compositor);
+	xdg_surface = xdg_wm_base_get_xdg_surface(wm_base, surface);
+	xdg_surface_add_listener(xdg_surface, &xdg_surface_listener, NULL);
+	toplevel = xdg_surface_get_toplevel(xdg_surface);
+	xdg_toplevel_add_listener(toplevel, &toplevel_listener, NULL);
+	xdg_toplevel_set_title(toplevel, "swc-bench-client");
+	wl_surface_commit(surface);
+
+	if ((fds[1].fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC)) < 0)
+		die("could not create timer");
+	interval.it_interval.tv_nsec = 1000000000 / config.rate;
+	interval.it_value = interval.it_interval;
+	timerfd_settime(fds[1].fd, 0, &interval, NULL);
+	fds[0].fd = wl_display_get_fd(display);
+	fds[0].events = fds[1].events = POLLIN;
+
+	end = now() + config.duration * 1000000000ull;
+	while (running && now() < end) {
+		wl_display_dispatch_pending(display);
+		if (wl_display_flush(display) < 0 && errno != EAGAIN)
+			break;
+		if (poll(fds, 2, 100) < 0 && errno != EINTR)
+			break;
+		if (fds[0].revents & POLLIN && wl_display_dispatch(display) < 0)
+			break;
+		if (fds[0].revents & (POLLERR | POLLHUP))
+			break;
+		if (fds[1].revents & POLLIN && read(fds[1].fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+			/* Timer expirations beyond the first are frames we had no chance to
+			 * commit. */
+			missed += expirations - 1;
+			tick();
+		}
+	}
+
+	report();
+	wl_display_disconnect(display);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,50 @@
+# swc: bench/local.mk
+
+dir := bench
+
+$(dir)_PACKAGES = libdrm pixman-1 wayland-client wayland-server wld xkbcommon
+$(dir)_CFLAGS = $(libswc_CFLAGS) -Ilibswc -Iprotocol
+
+BENCH_FLAGS ?=
+MICROBENCH_FLAGS ?=
+
+.PHONY: $(dir) microbench
+$(dir): $(dir)/swc-bench $(dir)/swc-bench-client
+	bench/swc-bench -c bench/swc-bench-client $(BENCH_FLAGS)
+
+microbench: $(dir)/swc-microbench
+	bench/swc-microbench $(MICROBENCH_FLAGS)
+
+$(dir)/swc-bench: $(dir)/server.o libswc/libswc-internal.o
+	$(link) $(bench_PACKAGE_LIBS) $(libswc_PACKAGE_LIBS) -lm
+
+# compositor.o is replaced by micro_compositor.o, which includes its source.
+$(dir)/swc-microbench: $(dir)/micro.o $(dir)/micro_compositor.o $(filter-out libswc/compositor.o,$(SWC_STATIC_OBJECTS))
+	$(link) $(bench_PACKAGE_LIBS) $(libswc_PACKAGE_LIBS) -lm
+
+$(dir)/swc-bench-client: $(dir)/client.o protocol/xdg-shell-protocol.o protocol/linux-dmabuf-unstable-v1-protocol.o
+	$(link) $(bench_PACKAGE_LIBS)
+
+REPLAY_PROTOCOLS =               \
+    linux-dmabuf-unstable-v1    \
+    server-decoration           \
+    swc                         \
+    wayland-drm                 \
+    wlr-screencopy-unstable-v1  \
+    xdg-decoration-unstable-v1  \
+    xdg-output-unstable-v1      \
+    xdg-shell
+
+$(dir)/swc-replay: $(dir)/replay.o $(REPLAY_PROTOCOLS:%=protocol/%-protocol.o)
+	$(link) $(bench_PACKAGE_LIBS)
+
+# Explicitly state dependencies on generated files
+$(dir)/client.o: protocol/xdg-shell-client-protocol.h protocol/linux-dmabuf-unstable-v1-client-protocol.h
+$(dir)/micro_compositor.o: protocol/swc-server-protocol.h
+$(dir)/replay.o: $(REPLAY_PROTOCOLS:%=protocol/%-client-protocol.h)
+
+CLEAN_FILES += $(dir)/server.o $(dir)/client.o $(dir)/swc-bench $(dir)/swc-bench-client \
+               $(dir)/micro.o $(dir)/micro_compositor.o $(dir)/swc-microbench \
+               $(dir)/replay.o $(dir)/swc-replay
+
+include common.mk
@@ -0,0 +1,524 @@
+/* swc: bench/micro.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/* swc-microbench runs a headless swc in-process and calls its hot paths
+ * directly with scaled-up inputs, reporting the time and number of heap
+ * allocations per call of each. The output follows the format of Go
+ * benchmarks so that runs can be compared with existing tools. */
+
+#include "micro.h"
+#include "compositor.h"
+#include "internal.h"
+#include "pointer.h"
+#include "screen.h"
+#include "seat.h"
+#include "surface.h"
+#include "swc.h"
+#include "util.h"
+#include "view.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <wayland-server.h>
+#include <wld/wld.h>
+#include <xkbcommon/xkbcommon.h>
+
+#define GRID_SPACING 12
+#define GRID_SIZE 10
+
+struct benchmark {
+	const char *name;
+	bool (*setup)(unsigned size);
+	void (*run)(void);
+	void (*teardown)(void);
+	unsigned sizes[4];
+};
+
+extern struct pointer_handler screens_pointer_handler;
+
+static struct wl_client *client;
+static struct compositor_view **grid;
+static unsigned grid_count;
+static uint64_t target_time = 200000000;
+static unsigned long allocations;
+
+/* Allocations {{{ */
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static const bool counts_allocations = true;
+
+/* These replace the C library's allocator for the whole process, including
+ * pixman, so they must be visible to shared libraries. */
+__attribute__((visibility("default"))) void *
+malloc(size_t size)
+{
+	++allocations;
+	return __libc_malloc(size);
+}
+
+__attribute__((visibility("default"))) void *
+calloc(size_t count, size_t size)
+{
+	++allocations;
+	return __libc_calloc(count, size);
+}
+
+__attribute__((visibility("default"))) void *
+realloc(void *ptr, size_t size)
+{
+	++allocations;
+	return __libc_realloc(ptr, size);
+}
+#else
+static const bool counts_allocations = false;
+#endif
+
+/* }}} */
+
+/* Views {{{ */
+
+struct compositor_view *
+create_view(int32_t x, int32_t y, uint32_t width, uint32_t height, struct wld_buffer *buffer)
+{
+	struct surface *surface;
+	struct compositor_view *view;
+
+	if (!(surface = surface_new(client, 4, 0)))
+		goto error0;
+	if (!(view = compositor_create_view(surface)))
+		goto error1;
+	if (buffer)
+		view_attach(&view->base, buffer);
+	else
+		view_set_size(&view->base, width, height);
+
+	/* Move away from the origin first so that the extents are updated even if
+	 * the view is placed there. */
+	view_move(&view->base, x - 1, y - 1);
+	view_move(&view->base, x, y);
+	pixman_region32_reset(&surface->state.opaque, &(pixman_box32_t){0, 0, view->base.geometry.width, view->base.geometry.height});
+	compositor_view_show(view);
+
+	return view;
+
+error1:
+	wl_resource_destroy(surface->resource);
+error0:
+	return NULL;
+}
+
+void
+destroy_view(struct compositor_view *view)
+{
+	struct surface *surface = view->surface;
+
+	compositor_view_destroy(view);
+	wl_resource_destroy(surface->resource);
+}
+
+bool
+create_grid(unsigned count)
+{
+	struct screen *screen;
+	struct swc_rectangle *geom;
+	unsigned columns = 0, rows = 0;
+
+	wl_list_for_each (screen, &swc.screens, link) {
+		geom = &screen->base.geometry;
+		columns += geom->width / GRID_SPACING;
+		rows = MAX(rows, geom->height / GRID_SPACING);
+	}
+	if (count > columns * rows) {
+		fprintf(stderr, "Screens only fit %u views\n", columns * rows);
+		return false;
+	}
+	if (!(grid = calloc(count, sizeof(*grid))))
+		return false;
+	for (grid_count = 0; grid_count < count; ++grid_count) {
+		grid[grid_count] = create_view(grid_count % columns * GRID_SPACING, grid_count / columns * GRID_SPACING, GRID_SIZE, GRID_SIZE, NULL);
+		if (!grid[grid_count]) {
+			destroy_grid();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void
+destroy_grid(void)
+{
+	while (grid_count > 0)
+		destroy_view(grid[--grid_count]);
+	free(grid);
+	grid = NULL;
+}
+
+struct compositor_view *
+grid_view(unsigned index)
+{
+	return grid[index];
+}
+
+/* }}} */
+
+/* Benchmarks {{{ */
+
+static unsigned motion_step;
+
+/* Hit-test against a grid of views, at the bottom one so that every view is
+ * tested first. */
+static void
+compositor_motion_run(void)
+{
+	const struct swc_rectangle *geom = &grid[0]->base.geometry;
+	wl_fixed_t x = wl_fixed_from_int(geom->x + motion_step++ % geom->width);
+
+	swc.compositor->pointer_handler->motion(swc.compositor->pointer_handler, 0, x, wl_fixed_from_int(geom->y));
+}
+
+static void
+compositor_motion_teardown(void)
+{
+	pointer_set_focus(swc.seat->pointer, NULL);
+	destroy_grid();
+}
+
+static struct screen *first_screen, *last_screen;
+
+static bool
+screen_motion_setup(unsigned size)
+{
+	struct screen *screen;
+	unsigned count = 0;
+
+	first_screen = NULL;
+	wl_list_for_each (screen, &swc.screens, link) {
+		if (!first_screen)
+			first_screen = screen;
+		if (++count == size) {
+			last_screen = screen;
+			return true;
+		}
+	}
+	fprintf(stderr, "Only %u screens\n", count);
+
+	return false;
+}
+
+/* Move back and forth between the first screen and the size'th. */
+static void
+screen_motion_run(void)
+{
+	struct screen *screen = motion_step++ % 2 ? last_screen : first_screen;
+	const struct swc_rectangle *geom = &screen->base.geometry;
+
+	screens_pointer_handler.motion(&screens_pointer_handler, 0, wl_fixed_from_int(geom->x), wl_fixed_from_int(geom->y));
+}
+
+static unsigned num_bindings;
+
+static void
+handle_binding(void *data, uint32_t time, uint32_t value, uint32_t state)
+{
+}
+
+/* Bindings can't be removed, so add more as the size grows. They all need the
+ * logo modifier, so the key press never matches and both lookups scan every
+ * binding. */
+static bool
+key_binding_setup(unsigned size)
+{
+	for (; num_bindings < size; ++num_bindings) {
+		if (swc_add_binding(SWC_BINDING_KEY, SWC_MOD_LOGO, XKB_KEY_a + num_bindings, &handle_binding, NULL) < 0)
+			return false;
+	}
+
+	return true;
+}
+
+static void
+key_binding_run(void)
+{
+	/* The evdev code for Q. */
+	struct key key = {.press.value = 16};
+
+	swc.bindings->keyboard_handler->key(swc.seat->keyboard, 0, &key, WL_KEYBOARD_KEY_STATE_PRESSED);
+}
+
+static struct pointer_handler *extra_handlers;
+static unsigned num_extra_handlers;
+
+static bool
+ignore_motion(struct pointer_handler *handler, uint32_t time, wl_fixed_t x, wl_fixed_t y)
+{
+	return false;
+}
+
+/* Add size handlers in front of the ones swc installs, none of which handle
+ * the motion. */
+static bool
+pointer_motion_setup(unsigned size)
+{
+	unsigned i;
+
+	if (size > 0 && !(extra_handlers = calloc(size, sizeof(*extra_handlers))))
+		return false;
+	for (i = 0; i < size; ++i) {
+		extra_handlers[i].motion = &ignore_motion;
+		wl_list_insert(&swc.seat->pointer->handlers, &extra_handlers[i].link);
+	}
+	num_extra_handlers = size;
+
+	return true;
+}
+
+static void
+pointer_motion_run(void)
+{
+	wl_fixed_t x = wl_fixed_from_int(motion_step++ % 256);
+
+	pointer_handle_absolute_motion(swc.seat->pointer, 0, x, x);
+}
+
+static void
+pointer_motion_teardown(void)
+{
+	while (num_extra_handlers > 0)
+		wl_list_remove(&extra_handlers[--num_extra_handlers].link);
+	free(extra_handlers);
+	extra_handlers = NULL;
+}
+
+struct strut {
+	struct screen_modifier modifier;
+	unsigned edge;
+};
+
+static struct screen *strut_screen;
+static struct strut *struts;
+static unsigned num_struts;
+
+/* Reserve an edge of the screen, like a docked panel. */
+static void
+modify(struct screen_modifier *modifier, const struct swc_rectangle *geom, pixman_region32_t *usable)
+{
+	struct strut *strut = wl_container_of(modifier, strut, modifier);
+	pixman_box32_t box = {geom->x, geom->y, geom->x + geom->width, geom->y + geom->height};
+
+	switch (strut->edge % 4) {
+	case 0:
+		box.y1 += 20;
+		break;
+	case 1:
+		box.y2 -= 20;
+		break;
+	case 2:
+		box.x1 += 20;
+		break;
+	case 3:
+		box.x2 -= 20;
+		break;
+	}
+	pixman_region32_reset(usable, &box);
+}
+
+static bool
+usable_geometry_setup(unsigned size)
+{
+	unsigned i;
+
+	if (!(struts = calloc(size, sizeof(*struts))))
+		return false;
+	strut_screen = wl_container_of(swc.screens.next, strut_screen, link);
+	for (i = 0; i < size; ++i) {
+		struts[i].modifier.modify = &modify;
+		struts[i].edge = i;
+		wl_list_insert(&strut_screen->modifiers, &struts[i].modifier.link);
+	}
+	num_struts = size;
+
+	return true;
+}
+
+static void
+usable_geometry_run(void)
+{
+	screen_update_usable_geometry(strut_screen);
+}
+
+static void
+usable_geometry_teardown(void)
+{
+	while (num_struts > 0)
+		wl_list_remove(&struts[--num_struts].modifier.link);
+	free(struts);
+	struts = NULL;
+	screen_update_usable_geometry(strut_screen);
+}
+
+static const struct benchmark benchmarks[] = {
+	{"calculate_damage", &calculate_damage_setup, &calculate_damage_run, &destroy_grid, {10, 100, 1000, 10000}},
+	{"repaint_view", &repaint_view_setup, &repaint_view_run, &repaint_view_teardown, {1, 10, 100, 1000}},
+	{"compositor_motion", &create_grid, &compositor_motion_run, &compositor_motion_teardown, {10, 100, 1000, 10000}},
+	{"screen_motion", &screen_motion_setup, &screen_motion_run, NULL, {1, 2, 8, 32}},
+	{"key_binding", &key_binding_setup, &key_binding_run, NULL, {10, 100, 1000, 10000}},
+	{"pointer_motion", &pointer_motion_setup, &pointer_motion_run, &pointer_motion_teardown, {0, 10, 100, 1000}},
+	{"usable_geometry", &usable_geometry_setup, &usable_geometry_run, &usable_geometry_teardown, {1, 10, 100, 1000}},
+};
+
+/* }}} */
+
+/* Run a benchmark with more and more iterations until it takes at least the
+ * target time. */
+static void
+run(const struct benchmark *benchmark, unsigned size)
+{
+	uint64_t iterations = 1, next, start, elapsed, i;
+	unsigned long allocated;
+
+	if (benchmark->setup && !benchmark->setup(size)) {
+		fprintf(stderr, "Could not set up %s/%u\n", benchmark->name, size);
+		return;
+	}
+
+	for (;;) {
+		allocated = allocations;
+		start = get_monotonic_ns();
+		for (i = 0; i < iterations; ++i)
+			benchmark->run();
+		elapsed = get_monotonic_ns() - start;
+		allocated = allocations - allocated;
+
+		if (elapsed >= target_time)
+			break;
+		next = elapsed > 0 ? iterations * target_time / elapsed * 6 / 5 : iterations * 100;
+		iterations = MAX(MIN(next, iterations * 100), iterations + 1);
+	}
+
+	printf("Benchmark_%s/%u\t%" PRIu64 "\t%.1f ns/op", benchmark->name, size, iterations, (double)elapsed / iterations);
+	if (counts_allocations)
+		printf("\t%.2f allocs/op", (double)allocated / iterations);
+	putchar('\n');
+	fflush(stdout);
+
+	if (benchmark->teardown)
+		benchmark->teardown();
+}
+
+static bool
+matches(const struct benchmark *benchmark, int argc, char *argv[])
+{
+	int i;
+
+	if (argc == 0)
+		return true;
+	for (i = 0; i < argc; ++i) {
+		if (strstr(benchmark->name, argv[i]))
+			return true;
+	}
+
+	return false;
+}
+
+static void
+new_screen(struct swc_screen *screen)
+{
+}
+
+static void
+new_window(struct swc_window *window)
+{
+}
+
+static const struct swc_manager manager = {
+	.new_screen = &new_screen,
+	.new_window = &new_window,
+};
+
+static void
+usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-t milliseconds] [benchmark...]\n", name);
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct wl_display *display;
+	char screens[32 * 8];
+	int option, fds[2];
+	unsigned i, j;
+
+	while ((option = getopt(argc, argv, "t:")) != -1) {
+		switch (option) {
+		case 't':
+			target_time = strtoull(optarg, NULL, 10) * 1000000;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	/* Plenty of small screens for screen_motion and the larger grids. */
+	setenv("SWC_BACKEND", "headless", 1);
+	if (!getenv("SWC_HEADLESS_SCREENS")) {
+		screens[0] = '\0';
+		for (i = 0; i < 32; ++i)
+			strcat(screens, i == 0 ? "640x480" : ",640x480");
+		setenv("SWC_HEADLESS_SCREENS", screens, 1);
+	}
+
+	if (!(display = wl_display_create()))
+		return EXIT_FAILURE;
+	if (!swc_initialize(display, NULL, &manager))
+		return EXIT_FAILURE;
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+		return EXIT_FAILURE;
+	if (!(client = wl_client_create(display, fds[0])))
+		return EXIT_FAILURE;
+
+	for (i = 0; i < ARRAY_LENGTH(benchmarks); ++i) {
+		if (!matches(&benchmarks[i], argc - optind, argv + optind))
+			continue;
+		for (j = 0; j < ARRAY_LENGTH(benchmarks[i].sizes); ++j)
+			run(&benchmarks[i], benchmarks[i].sizes[j]);
+	}
+
+	wl_client_destroy(client);
+	close(fds[1]);
+	swc_finalize();
+	wl_display_destroy(display);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+/* swc: bench/micro.h
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SWC_BENCH_MICRO_H
+#define SWC_BENCH_MICRO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct compositor_view;
+struct wld_buffer;
+
+/**
+ * Create a visible view of a new surface. If buffer is NULL, the view is
+ * given the size of the rectangle instead.
+ */
+struct compositor_view *create_view(int32_t x, int32_t y, uint32_t width, uint32_t height, struct wld_buffer *buffer);
+void destroy_view(struct compositor_view *view);
+
+/**
+ * Tile count opaque views over the screens, without overlapping. The first
+ * view is at the bottom of the stack.
+ */
+bool create_grid(unsigned count);
+void destroy_grid(void);
+struct compositor_view *grid_view(unsigned index);
+
+/* Benchmarks of static functions in compositor.c. */
+bool calculate_damage_setup(unsigned size);
+void calculate_damage_run(void);
+bool repaint_view_setup(unsigned size);
+void repaint_view_run(void);
+void repaint_view_teardown(void);
+
+#endif
@@ -0,0 +1,98 @@
+/* swc: bench/micro_compositor.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/* The compositor's hot paths are static, so this file includes its source and
+ * takes the place of libswc/compositor.o when linking swc-microbench. */
+
+#include "compositor.c"
+#include "micro.h"
+
+static struct compositor_view *damaged_view, *repainted_view;
+static struct wld_buffer *repainted_buffer;
+static struct target *repainted_target;
+static pixman_region32_t repaint_damage;
+
+bool
+calculate_damage_setup(unsigned size)
+{
+	if (!create_grid(size))
+		return false;
+	damaged_view = grid_view(size - 1);
+	return true;
+}
+
+void
+calculate_damage_run(void)
+{
+	pixman_region32_union_rect(&damaged_view->surface->state.damage, &damaged_view->surface->state.damage, 0, 0, 4, 4);
+	calculate_damage();
+	pixman_region32_clear(&compositor.damage);
+}
+
+/* Repaint a single view whose damage consists of size small rectangles. */
+bool
+repaint_view_setup(unsigned size)
+{
+	struct screen *screen = wl_container_of(swc.screens.next, screen, link);
+	const struct swc_rectangle *geom = &screen->base.geometry;
+	unsigned i;
+
+	if (!(repainted_target = target_get(screen)))
+		goto error0;
+	repainted_buffer = wld_create_buffer(swc.drm->context, MIN(geom->width, 512), MIN(geom->height, 512), WLD_FORMAT_XRGB8888, 0);
+	if (!repainted_buffer)
+		goto error0;
+	if (!(repainted_view = create_view(geom->x, geom->y, 0, 0, repainted_buffer)))
+		goto error1;
+
+	pixman_region32_init(&repaint_damage);
+	for (i = 0; i < size; ++i) {
+		pixman_region32_union_rect(&repaint_damage, &repaint_damage,
+		                           geom->x + i * 37 % (repainted_buffer->width - 4),
+		                           geom->y + i * 53 % (repainted_buffer->height - 4), 4, 4);
+	}
+	wld_set_target_surface(swc.drm->renderer, repainted_target->surface);
+
+	return true;
+
+error1:
+	wld_buffer_unreference(repainted_buffer);
+error0:
+	return false;
+}
+
+void
+repaint_view_run(void)
+{
+	repaint_view(repainted_target, repainted_view, &repaint_damage);
+}
+
+void
+repaint_view_teardown(void)
+{
+	wld_flush(swc.drm->renderer);
+	pixman_region32_fini(&repaint_damage);
+	destroy_view(repainted_view);
+	wld_buffer_unreference(repainted_buffer);
+}
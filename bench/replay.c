@@ -0,0 +1,679 @@
+/* swc: bench/replay.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/* swc-replay re-drives the clients of a trace recorded with SWC_RECORD against
+ * the compositor at WAYLAND_DISPLAY, with one connection per recorded client.
+ * Requests are sent at the recorded times, scaled by the speed, and the
+ * contents of SHM buffers are restored before each commit that used them.
+ *
+ * Objects the compositor created, such as data offers, are not known to the
+ * replay, so requests on them are skipped. Pings are answered as they arrive
+ * and configure events acknowledged with the latest serial, rather than with
+ * the recorded ones. */
+
+#include "record.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <wayland-client.h>
+#include "linux-dmabuf-unstable-v1-client-protocol.h"
+#include "server-decoration-client-protocol.h"
+#include "swc-client-protocol.h"
+#include "wayland-drm-client-protocol.h"
+#include "wlr-screencopy-unstable-v1-client-protocol.h"
+#include "xdg-decoration-unstable-v1-client-protocol.h"
+#include "xdg-output-unstable-v1-client-protocol.h"
+#include "xdg-shell-client-protocol.h"
+
+#define ARRAY_LENGTH(array) (sizeof(array) / sizeof(array)[0])
+#define MAX_ARGS 20
+
+struct pool {
+	int fd;
+	void *data;
+	size_t size;
+	unsigned references;
+};
+
+struct object {
+	struct wl_proxy *proxy;
+	const struct wl_interface *interface;
+
+	/* The pool of a wl_shm_pool or wl_buffer, and the offset of the buffer. */
+	struct pool *pool;
+	uint32_t offset;
+
+	/* The last configure serial of an xdg_surface. */
+	uint32_t serial;
+};
+
+struct global {
+	uint32_t name;
+	char *interface;
+	uint32_t version;
+};
+
+struct client {
+	uint32_t id;
+	struct wl_display *display;
+	struct wl_array objects;
+	struct wl_array globals;
+	struct wl_list link;
+};
+
+/* Interfaces of the globals swc advertises. */
+static const struct wl_interface *const interfaces[] = {
+	&wl_compositor_interface,
+	&wl_data_device_manager_interface,
+	&wl_output_interface,
+	&wl_seat_interface,
+	&wl_shell_interface,
+	&wl_shm_interface,
+	&wl_subcompositor_interface,
+	&org_kde_kwin_server_decoration_manager_interface,
+	&swc_panel_manager_interface,
+	&swc_screen_interface,
+	&wl_drm_interface,
+	&xdg_wm_base_interface,
+	&zwlr_screencopy_manager_v1_interface,
+	&zwp_linux_dmabuf_v1_interface,
+	&zxdg_decoration_manager_v1_interface,
+	&zxdg_output_manager_v1_interface,
+};
+
+static struct wl_list clients;
+static double speed = 1;
+static unsigned long replayed, skipped;
+
+static uint64_t
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Pools {{{ */
+
+static struct pool *
+pool_new(int fd, size_t size)
+{
+	struct pool *pool;
+
+	if (!(pool = malloc(sizeof(*pool))))
+		return NULL;
+	pool->data = size > 0 ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : NULL;
+	if (pool->data == MAP_FAILED) {
+		free(pool);
+		return NULL;
+	}
+	pool->fd = fd;
+	pool->size = size;
+	pool->references = 1;
+
+	return pool;
+}
+
+static void
+pool_resize(struct pool *pool, size_t size)
+{
+	void *data;
+
+	if (size <= pool->size || ftruncate(pool->fd, size) < 0)
+		return;
+	data = pool->data ? mremap(pool->data, pool->size, size, MREMAP_MAYMOVE) : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, pool->fd, 0);
+	if (data == MAP_FAILED)
+		return;
+	pool->data = data;
+	pool->size = size;
+}
+
+static void
+pool_unreference(struct pool *pool)
+{
+	if (--pool->references > 0)
+		return;
+	if (pool->data)
+		munmap(pool->data, pool->size);
+	close(pool->fd);
+	free(pool);
+}
+
+/* A file standing in for a recorded file descriptor. */
+static int
+create_file(uint32_t size)
+{
+	int fd;
+
+	if ((fd = memfd_create("swc-replay", MFD_CLOEXEC)) < 0)
+		return -1;
+	if (ftruncate(fd, size) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/* }}} */
+
+/* Objects {{{ */
+
+static struct object *
+get_object(struct client *client, uint32_t id)
+{
+	struct object **objects = client->objects.data;
+
+	if (id >= client->objects.size / sizeof(*objects) || !objects[id] || !objects[id]->proxy)
+		return NULL;
+
+	return objects[id];
+}
+
+static void
+destroy_object(struct object *object)
+{
+	if (object->pool)
+		pool_unreference(object->pool);
+	if (object->proxy && object->interface != &wl_display_interface)
+		wl_proxy_destroy(object->proxy);
+	memset(object, 0, sizeof(*object));
+}
+
+static struct object *
+add_object(struct client *client, uint32_t id, struct wl_proxy *proxy, const struct wl_interface *interface)
+{
+	size_t count = client->objects.size / sizeof(struct object *);
+	struct object **objects;
+
+	if (id >= count) {
+		if (!wl_array_add(&client->objects, (id + 1 - count) * sizeof(*objects)))
+			return NULL;
+		memset((struct object **)client->objects.data + count, 0, (id + 1 - count) * sizeof(*objects));
+	}
+
+	objects = client->objects.data;
+	if (!objects[id] && !(objects[id] = calloc(1, sizeof(**objects))))
+		return NULL;
+
+	/* The recorded client reused the ID, so the old object is gone. */
+	destroy_object(objects[id]);
+	objects[id]->proxy = proxy;
+	objects[id]->interface = interface;
+
+	return objects[id];
+}
+
+static void
+handle_global(void *data, struct wl_registry *registry, uint32_t name, const char *interface, uint32_t version)
+{
+	struct client *client = data;
+	struct global *global;
+
+	if (!(global = wl_array_add(&client->globals, sizeof(*global))))
+		return;
+	global->name = name;
+	global->interface = strdup(interface);
+	global->version = version;
+}
+
+static void
+handle_global_remove(void *data, struct wl_registry *registry, uint32_t name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+	.global = handle_global,
+	.global_remove = handle_global_remove,
+};
+
+/* Find the global to bind in place of the recorded one, preferring one with
+ * the same name. */
+static struct global *
+find_global(struct client *client, uint32_t name, const char *interface)
+{
+	struct global *global, *match = NULL;
+
+	wl_array_for_each (global, &client->globals) {
+		if (!global->interface || strcmp(global->interface, interface) != 0)
+			continue;
+		if (global->name == name)
+			return global;
+		if (!match)
+			match = global;
+	}
+
+	return match;
+}
+
+static void
+handle_ping(void *data, struct xdg_wm_base *wm_base, uint32_t serial)
+{
+	xdg_wm_base_pong(wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener wm_base_listener = {
+	.ping = handle_ping,
+};
+
+static void
+handle_configure(void *data, struct xdg_surface *xdg_surface, uint32_t serial)
+{
+	struct object *object = data;
+
+	object->serial = serial;
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+	.configure = handle_configure,
+};
+
+/* }}} */
+
+/* Clients {{{ */
+
+static struct client *
+find_client(uint32_t id)
+{
+	struct client *client;
+
+	wl_list_for_each (client, &clients, link) {
+		if (client->id == id)
+			return client;
+	}
+
+	return NULL;
+}
+
+static void
+create_client(uint32_t id)
+{
+	struct client *client;
+
+	if (!(client = malloc(sizeof(*client))))
+		return;
+	if (!(client->display = wl_display_connect(NULL))) {
+		fprintf(stderr, "Could not connect to display\n");
+		free(client);
+		return;
+	}
+	client->id = id;
+	wl_array_init(&client->objects);
+	wl_array_init(&client->globals);
+	add_object(client, 1, (struct wl_proxy *)client->display, &wl_display_interface);
+	wl_list_insert(clients.prev, &client->link);
+}
+
+static void
+destroy_client(struct client *client)
+{
+	struct object **object;
+	struct global *global;
+
+	wl_array_for_each (object, &client->objects) {
+		if (*object) {
+			destroy_object(*object);
+			free(*object);
+		}
+	}
+	wl_array_release(&client->objects);
+	wl_array_for_each (global, &client->globals)
+		free(global->interface);
+	wl_array_release(&client->globals);
+	if (wl_display_get_error(client->display))
+		fprintf(stderr, "Client %" PRIu32 " was disconnected: %s\n", client->id, strerror(wl_display_get_error(client->display)));
+	wl_display_disconnect(client->display);
+	wl_list_remove(&client->link);
+	free(client);
+}
+
+/* Wait up to timeout milliseconds for events, and dispatch them. */
+static void
+dispatch(int timeout)
+{
+	struct pollfd fds[64];
+	struct client *client, *clients_polled[ARRAY_LENGTH(fds)];
+	nfds_t i, count = 0;
+
+	wl_list_for_each (client, &clients, link) {
+		if (wl_display_get_error(client->display))
+			continue;
+		wl_display_flush(client->display);
+		if (count < ARRAY_LENGTH(fds)) {
+			fds[count].fd = wl_display_get_fd(client->display);
+			fds[count].events = POLLIN;
+			clients_polled[count++] = client;
+		}
+	}
+	if (poll(fds, count, timeout) <= 0)
+		return;
+	for (i = 0; i < count; ++i) {
+		if (fds[i].revents & POLLIN)
+			wl_display_dispatch(clients_polled[i]->display);
+	}
+}
+
+/* }}} */
+
+/* Replay {{{ */
+
+static bool
+read_uint(const char **data, const char *end, uint32_t *value)
+{
+	if (end - *data < (ptrdiff_t)sizeof(*value))
+		return false;
+	memcpy(value, *data, sizeof(*value));
+	*data += sizeof(*value);
+	return true;
+}
+
+static bool
+read_bytes(const char **data, const char *end, uint32_t size, const void **bytes)
+{
+	uint32_t padded = (size + 3) & ~3;
+
+	if ((uint32_t)(end - *data) < padded)
+		return false;
+	*bytes = *data;
+	*data += padded;
+	return true;
+}
+
+static bool
+is_destructor(const struct wl_message *message)
+{
+	return strcmp(message->name, "destroy") == 0 || strcmp(message->name, "release") == 0;
+}
+
+static bool
+replay_request(struct client *client, const char *data, const char *end)
+{
+	struct record_request request;
+	struct object *object, *argument, *new_object;
+	const struct wl_message *message;
+	const struct wl_interface *interface = NULL;
+	const char *signature;
+	union wl_argument args[MAX_ARGS];
+	struct wl_array arrays[MAX_ARGS];
+	const void *bytes;
+	struct global *global;
+	struct wl_proxy *proxy;
+	uint32_t value, version = 0, new_id = 0;
+	int fds[MAX_ARGS], num_fds = 0, i = 0, pool_size = 0;
+	bool ok = false;
+
+	if ((size_t)(end - data) < sizeof(request))
+		return false;
+	memcpy(&request, data, sizeof(request));
+	data += sizeof(request);
+	if (!(object = get_object(client, request.object)) || request.opcode >= (uint32_t)object->interface->method_count)
+		return false;
+	message = &object->interface->methods[request.opcode];
+
+	for (signature = message->signature; *signature; ++signature) {
+		if (i == MAX_ARGS)
+			goto done;
+		switch (*signature) {
+		case 'i':
+		case 'u':
+		case 'f':
+			if (!read_uint(&data, end, &args[i].u))
+				goto done;
+			break;
+		case 's':
+			if (!read_uint(&data, end, &value) || !read_bytes(&data, end, value, &bytes))
+				goto done;
+			args[i].s = value ? bytes : NULL;
+			break;
+		case 'o':
+			if (!read_uint(&data, end, &value))
+				goto done;
+			if (value == 0) {
+				args[i].o = NULL;
+			} else {
+				/* The compositor created the object, or it no longer exists. */
+				if (!(argument = get_object(client, value)))
+					goto done;
+				args[i].o = (struct wl_object *)argument->proxy;
+			}
+			break;
+		case 'n':
+			if (!read_uint(&data, end, &new_id))
+				goto done;
+			args[i].o = NULL;
+			if ((interface = message->types[i])) {
+				version = wl_proxy_get_version(object->proxy);
+			} else {
+				/* wl_registry.bind, where the interface and version precede the ID. */
+				if (i < 2 || !args[i - 2].s)
+					goto done;
+				if (!(global = find_global(client, args[0].u, args[i - 2].s))) {
+					wl_display_roundtrip(client->display);
+					global = find_global(client, args[0].u, args[i - 2].s);
+				}
+				if (!global)
+					goto done;
+				for (value = 0; value < ARRAY_LENGTH(interfaces); ++value) {
+					if (strcmp(interfaces[value]->name, global->interface) == 0)
+						interface = interfaces[value];
+				}
+				if (!interface)
+					goto done;
+				args[0].u = global->name;
+				version = args[i - 1].u = args[i - 1].u < global->version ? args[i - 1].u : global->version;
+			}
+			break;
+		case 'a':
+			if (!read_uint(&data, end, &value) || !read_bytes(&data, end, value, &bytes))
+				goto done;
+			arrays[i].size = arrays[i].alloc = value;
+			arrays[i].data = (void *)bytes;
+			args[i].a = &arrays[i];
+			break;
+		case 'h':
+			if (!read_uint(&data, end, &value) || (args[i].h = create_file(value)) < 0)
+				goto done;
+			fds[num_fds++] = args[i].h;
+			pool_size = value;
+			break;
+		default:
+			continue;
+		}
+		++i;
+	}
+
+	if (object->interface == &xdg_wm_base_interface && request.opcode == XDG_WM_BASE_PONG) {
+		/* Pings are answered as they arrive. */
+		ok = true;
+		goto done;
+	}
+	if (object->interface == &xdg_surface_interface && request.opcode == XDG_SURFACE_ACK_CONFIGURE)
+		args[0].u = object->serial;
+	if (object->interface == &wl_shm_pool_interface && request.opcode == WL_SHM_POOL_RESIZE)
+		pool_resize(object->pool, args[0].i);
+
+	if (interface) {
+		proxy = wl_proxy_marshal_array_constructor_versioned(object->proxy, request.opcode, args, interface, version);
+		if (!proxy || !(new_object = add_object(client, new_id, proxy, interface)))
+			goto done;
+		if (interface == &wl_registry_interface) {
+			wl_proxy_add_listener(proxy, (void (**)(void))&registry_listener, client);
+		} else if (interface == &xdg_wm_base_interface) {
+			wl_proxy_add_listener(proxy, (void (**)(void))&wm_base_listener, NULL);
+		} else if (interface == &xdg_surface_interface) {
+			wl_proxy_add_listener(proxy, (void (**)(void))&xdg_surface_listener, new_object);
+		} else if (interface == &wl_shm_pool_interface && num_fds == 1) {
+			if ((new_object->pool = pool_new(fds[0], pool_size)))
+				num_fds = 0;
+		} else if (interface == &wl_buffer_interface && object->pool) {
+			new_object->pool = object->pool;
+			new_object->offset = args[1].i;
+			++object->pool->references;
+		}
+	} else {
+		wl_proxy_marshal_array(object->proxy, request.opcode, args);
+		if (is_destructor(message))
+			destroy_object(object);
+	}
+	ok = true;
+
+done:
+	while (num_fds > 0)
+		close(fds[--num_fds]);
+
+	return ok;
+}
+
+static void
+replay_buffer(struct client *client, const char *data, const char *end)
+{
+	struct record_buffer header;
+	struct object *object;
+	char *dst;
+	uint32_t row;
+
+	if ((size_t)(end - data) < sizeof(header))
+		return;
+	memcpy(&header, data, sizeof(header));
+	data += sizeof(header);
+	if (!(object = get_object(client, header.object)) || !object->pool || !object->pool->data)
+		return;
+	if ((uint64_t)(end - data) < (uint64_t)header.width * header.rows)
+		return;
+	if (object->offset + header.offset + (uint64_t)(header.rows - 1) * header.stride + header.width > object->pool->size)
+		return;
+
+	dst = (char *)object->pool->data + object->offset + header.offset;
+	for (row = 0; row < header.rows; ++row)
+		memcpy(dst + row * header.stride, data + row * header.width, header.width);
+}
+
+/* }}} */
+
+static void
+usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-s speed] trace\n"
+	                "Speed 0 replays as fast as possible.\n", name);
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct record_header header;
+	struct client *client, *next;
+	char magic[sizeof(RECORD_MAGIC) - 1], *payload = NULL;
+	uint64_t start, due, current, last = 0;
+	uint32_t payload_size = 0;
+	FILE *file;
+	int option;
+
+	while ((option = getopt(argc, argv, "s:")) != -1) {
+		switch (option) {
+		case 's':
+			speed = strtod(optarg, NULL);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1 || speed < 0)
+		usage(argv[0]);
+
+	if (!(file = fopen(argv[optind], "r"))) {
+		fprintf(stderr, "Could not open %s: %s\n", argv[optind], strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if (fread(magic, sizeof(magic), 1, file) != 1 || memcmp(magic, RECORD_MAGIC, sizeof(magic)) != 0) {
+		fprintf(stderr, "%s is not an swc trace\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	wl_list_init(&clients);
+	start = now();
+	while (fread(&header, sizeof(header), 1, file) == 1) {
+		if (header.size > payload_size) {
+			if (!(payload = realloc(payload, header.size))) {
+				fprintf(stderr, "Out of memory\n");
+				return EXIT_FAILURE;
+			}
+			payload_size = header.size;
+		}
+		if (header.size > 0 && fread(payload, header.size, 1, file) != 1)
+			break;
+
+		if (speed > 0) {
+			due = start + header.time / speed;
+			while ((current = now()) < due)
+				dispatch((due - current + 999999) / 1000000);
+		}
+		dispatch(0);
+		last = header.time;
+
+		if (header.type == RECORD_CLIENT_CREATE) {
+			create_client(header.client);
+			continue;
+		}
+		if (!(client = find_client(header.client)))
+			continue;
+		switch (header.type) {
+		case RECORD_CLIENT_DESTROY:
+			destroy_client(client);
+			break;
+		case RECORD_REQUEST:
+			if (replay_request(client, payload, payload + header.size))
+				++replayed;
+			else
+				++skipped;
+			break;
+		case RECORD_BUFFER:
+			replay_buffer(client, payload, payload + header.size);
+			break;
+		}
+	}
+
+	wl_list_for_each_safe (client, next, &clients, link) {
+		wl_display_roundtrip(client->display);
+		destroy_client(client);
+	}
+	fclose(file);
+	free(payload);
+
+	printf("Replayed %lu requests (%lu skipped) spanning %.3fs in %.3fs\n",
+	       replayed, skipped, last / 1e9, (now() - start) / 1e9);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,545 @@
+/* swc: bench/server.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/* A compositor that runs a synthetic workload against swc and reports how
+ * well it kept up, as JSON.
+ *
+ * The synthetic clients (swc-bench-client) commit damage at a fixed rate,
+ * while the server moves and resizes their windows and moves the pointer.
+ * Clients measure the time from each commit to its frame callback, and count
+ * a frame as missed when its commit had to be skipped because the previous
+ * one had not been presented yet. */
+
+#include "compositor.h"
+#include "internal.h"
+#include "pointer.h"
+#include "seat.h"
+#include "swc.h"
+#include "util.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <wayland-server.h>
+
+struct bench_window {
+	struct swc_window *swc;
+	bool shrunk;
+	struct wl_list link;
+};
+
+struct bench_client {
+	pid_t pid;
+	int fd;
+	const char *type;
+};
+
+/* What a client writes to its pipe before exiting, followed by the latency
+ * of each frame in microseconds. */
+struct client_report {
+	uint32_t missed;
+	uint32_t count;
+};
+
+static struct {
+	const char *client_path;
+	unsigned shm_clients, dmabuf_clients;
+	unsigned commit_rate;
+	const char *damage_size;
+	unsigned move_rate, resize_rate, motion_rate;
+	unsigned duration;
+	const char *output;
+} config = {
+	.client_path = "bench/swc-bench-client",
+	.shm_clients = 4,
+	.commit_rate = 60,
+	.damage_size = "64x64",
+	.duration = 10,
+};
+
+static struct wl_display *display;
+static struct swc_screen *screen;
+static struct wl_list windows;
+static unsigned num_windows;
+static struct wl_array composite_times, latencies;
+static struct wl_array clients;
+static uint32_t missed_frames;
+static uint64_t start_time;
+static double elapsed;
+
+static void
+arrange(void)
+{
+	struct bench_window *window;
+	struct swc_rectangle *area, geometry;
+	unsigned columns, rows, index = 0;
+
+	if (!screen || num_windows == 0)
+		return;
+
+	area = &screen->usable_geometry;
+	columns = ceil(sqrt(num_windows));
+	rows = (num_windows + columns - 1) / columns;
+	wl_list_for_each (window, &windows, link) {
+		geometry.width = area->width / columns;
+		geometry.height = area->height / rows;
+		geometry.x = area->x + geometry.width * (index % columns);
+		geometry.y = area->y + geometry.height * (index / columns);
+		if (window->shrunk) {
+			geometry.width = geometry.width * 3 / 4;
+			geometry.height = geometry.height * 3 / 4;
+		}
+		swc_window_set_geometry(window->swc, &geometry);
+		++index;
+	}
+}
+
+static void
+window_destroy(void *data)
+{
+	struct bench_window *window = data;
+
+	wl_list_remove(&window->link);
+	free(window);
+	--num_windows;
+	arrange();
+}
+
+static const struct swc_window_handler window_handler = {
+	.destroy = &window_destroy,
+};
+
+static void
+new_screen(struct swc_screen *swc)
+{
+	if (!screen)
+		screen = swc;
+}
+
+static void
+new_window(struct swc_window *swc)
+{
+	struct bench_window *window;
+
+	if (!(window = malloc(sizeof(*window))))
+		return;
+	window->swc = swc;
+	window->shrunk = false;
+	wl_list_insert(windows.prev, &window->link);
+	++num_windows;
+	swc_window_set_handler(swc, &window_handler, window);
+	swc_window_set_tiled(swc);
+	swc_window_show(swc);
+	arrange();
+}
+
+static const struct swc_manager manager = {
+	.new_screen = &new_screen,
+	.new_window = &new_window,
+};
+
+static void
+handle_repaint(struct wl_listener *listener, void *data)
+{
+	uint64_t *duration = data, *sample;
+
+	if ((sample = wl_array_add(&composite_times, sizeof(*sample))))
+		*sample = *duration;
+}
+
+static struct wl_listener repaint_listener = {
+	.notify = &handle_repaint,
+};
+
+/* Workload {{{ */
+
+static struct wl_event_source *move_timer, *resize_timer, *motion_timer;
+
+static unsigned
+interval(unsigned rate)
+{
+	return MAX(1000 / rate, 1);
+}
+
+static struct bench_window *
+nth_window(unsigned n)
+{
+	struct bench_window *window;
+
+	wl_list_for_each (window, &windows, link) {
+		if (n-- == 0)
+			return window;
+	}
+
+	return NULL;
+}
+
+/* Nudge the windows back and forth one at a time. */
+static int
+move_window(void *data)
+{
+	static unsigned next;
+	struct bench_window *window;
+	int32_t offset;
+
+	if (num_windows > 0 && (window = nth_window(next % num_windows))) {
+		offset = next / num_windows % 2 ? -16 : 16;
+		swc_window_set_position(window->swc, window->swc->geometry.x + offset, window->swc->geometry.y);
+		++next;
+	}
+	wl_event_source_timer_update(move_timer, interval(config.move_rate));
+
+	return 0;
+}
+
+/* Alternate the windows between their full and reduced tile size. */
+static int
+resize_window(void *data)
+{
+	static unsigned next;
+	struct bench_window *window;
+
+	if (num_windows > 0 && (window = nth_window(next % num_windows))) {
+		window->shrunk = !window->shrunk;
+		arrange();
+		++next;
+	}
+	wl_event_source_timer_update(resize_timer, interval(config.resize_rate));
+
+	return 0;
+}
+
+/* Trace a circle around the middle of the screen. */
+static int
+move_pointer(void *data)
+{
+	static unsigned step;
+	struct swc_rectangle *geom = &screen->geometry;
+	double angle = 2 * M_PI * (step++ % 360) / 360;
+	wl_fixed_t x, y;
+
+	x = wl_fixed_from_double(geom->x + geom->width / 2 + cos(angle) * geom->width / 3);
+	y = wl_fixed_from_double(geom->y + geom->height / 2 + sin(angle) * geom->height / 3);
+	pointer_handle_absolute_motion(swc.seat->pointer, get_time(), x, y);
+	pointer_handle_frame(swc.seat->pointer);
+	wl_event_source_timer_update(motion_timer, interval(config.motion_rate));
+
+	return 0;
+}
+
+static struct wl_event_source *
+add_timer(wl_event_loop_timer_func_t func, unsigned rate)
+{
+	struct wl_event_source *timer;
+
+	if (rate == 0)
+		return NULL;
+	if ((timer = wl_event_loop_add_timer(wl_display_get_event_loop(display), func, NULL)))
+		wl_event_source_timer_update(timer, interval(rate));
+
+	return timer;
+}
+
+/* Stop measuring once the workload is over, then give the clients a moment
+ * to report and exit on their own. */
+static int
+finish(void *data)
+{
+	struct wl_event_source **timer = data;
+
+	if (elapsed == 0) {
+		elapsed = (get_monotonic_ns() - start_time) / 1e9;
+		wl_list_remove(&repaint_listener.link);
+		wl_event_source_timer_update(*timer, 1000);
+	} else {
+		wl_display_terminate(display);
+	}
+
+	return 0;
+}
+
+/* }}} */
+
+/* Clients {{{ */
+
+static bool
+spawn_client(const char *type)
+{
+	struct bench_client *client;
+	char rate[16], duration[16];
+	int fds[2];
+
+	if (!(client = wl_array_add(&clients, sizeof(*client))))
+		return false;
+	if (pipe2(fds, O_CLOEXEC) < 0)
+		return false;
+
+	snprintf(rate, sizeof(rate), "%u", config.commit_rate);
+	snprintf(duration, sizeof(duration), "%u", config.duration);
+	client->type = type;
+	client->fd = fds[0];
+	client->pid = fork();
+	if (client->pid == 0) {
+		char fd[16];
+
+		snprintf(fd, sizeof(fd), "%d", fds[1]);
+		fcntl(fds[1], F_SETFD, 0);
+		execl(config.client_path, config.client_path, "-t", type, "-r", rate,
+		      "-a", config.damage_size, "-d", duration, "-f", fd, (char *)NULL);
+		fprintf(stderr, "Could not run %s: %s\n", config.client_path, strerror(errno));
+		_exit(EXIT_FAILURE);
+	}
+	close(fds[1]);
+	if (client->pid < 0) {
+		close(fds[0]);
+		clients.size -= sizeof(*client);
+		return false;
+	}
+
+	return true;
+}
+
+static size_t
+read_all(int fd, void *data, size_t size)
+{
+	size_t total = 0;
+	ssize_t ret;
+
+	while (total < size && (ret = read(fd, (char *)data + total, size - total)) > 0)
+		total += ret;
+
+	return total;
+}
+
+static void
+collect_client(struct bench_client *client)
+{
+	struct client_report report;
+	uint32_t *samples;
+	size_t size;
+
+	if (read_all(client->fd, &report, sizeof(report)) != sizeof(report)) {
+		fprintf(stderr, "%s client %d did not report\n", client->type, (int)client->pid);
+		goto done;
+	}
+	missed_frames += report.missed;
+	size = report.count * sizeof(*samples);
+	if (!(samples = wl_array_add(&latencies, size)))
+		goto done;
+	/* Drop any partial sample. */
+	latencies.size -= size - read_all(client->fd, samples, size) / sizeof(*samples) * sizeof(*samples);
+
+done:
+	close(client->fd);
+	waitpid(client->pid, NULL, 0);
+}
+
+/* }}} */
+
+/* Report {{{ */
+
+static int
+compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int
+compare_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double
+seconds(struct timeval *tv)
+{
+	return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+static void
+report(FILE *file, double elapsed)
+{
+	uint64_t *composite = composite_times.data, total = 0;
+	uint32_t *latency = latencies.data;
+	size_t num_composite = composite_times.size / sizeof(*composite);
+	size_t num_latency = latencies.size / sizeof(*latency), i;
+	struct rusage self, children;
+
+	getrusage(RUSAGE_SELF, &self);
+	getrusage(RUSAGE_CHILDREN, &children);
+	qsort(composite, num_composite, sizeof(*composite), &compare_u64);
+	qsort(latency, num_latency, sizeof(*latency), &compare_u32);
+	for (i = 0; i < num_composite; ++i)
+		total += composite[i];
+
+#define PERCENTILE(array, n, p) ((n) ? (array)[((n) - 1) * (p) / 100] : 0)
+	fprintf(file, "{\n");
+	fprintf(file, "  \"config\": {\"shm_clients\": %u, \"dmabuf_clients\": %u, \"commit_rate\": %u, "
+	              "\"damage_size\": \"%s\", \"move_rate\": %u, \"resize_rate\": %u, \"motion_rate\": %u, \"duration\": %u},\n",
+	        config.shm_clients, config.dmabuf_clients, config.commit_rate, config.damage_size,
+	        config.move_rate, config.resize_rate, config.motion_rate, config.duration);
+	fprintf(file, "  \"frames\": %zu,\n", num_composite);
+	fprintf(file, "  \"fps\": %.2f,\n", num_composite / elapsed);
+	fprintf(file, "  \"composite_us\": {\"mean\": %.2f, \"p50\": %.2f, \"p99\": %.2f, \"max\": %.2f},\n",
+	        num_composite ? total / 1e3 / num_composite : 0,
+	        PERCENTILE(composite, num_composite, 50) / 1e3,
+	        PERCENTILE(composite, num_composite, 99) / 1e3,
+	        num_composite ? composite[num_composite - 1] / 1e3 : 0);
+	fprintf(file, "  \"frame_latency_ms\": {\"samples\": %zu, \"p50\": %.3f, \"p99\": %.3f},\n",
+	        num_latency, PERCENTILE(latency, num_latency, 50) / 1e3, PERCENTILE(latency, num_latency, 99) / 1e3);
+	fprintf(file, "  \"missed_frames\": %" PRIu32 ",\n", missed_frames);
+	fprintf(file, "  \"cpu_seconds\": {\"server_user\": %.3f, \"server_system\": %.3f, \"clients_user\": %.3f, \"clients_system\": %.3f},\n",
+	        seconds(&self.ru_utime), seconds(&self.ru_stime), seconds(&children.ru_utime), seconds(&children.ru_stime));
+	fprintf(file, "  \"max_rss_kb\": {\"server\": %ld, \"clients\": %ld}\n", self.ru_maxrss, children.ru_maxrss);
+	fprintf(file, "}\n");
+#undef PERCENTILE
+}
+
+/* }}} */
+
+static void
+usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-c client] [-s shm-clients] [-b dmabuf-clients] [-r commit-rate]\n"
+	                "       [-a damage-WxH] [-m move-rate] [-z resize-rate] [-p motion-rate]\n"
+	                "       [-d seconds] [-o output]\n", name);
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct bench_client *client;
+	struct wl_event_source *finish_timer;
+	const char *socket;
+	FILE *output = stdout;
+	unsigned i;
+	int option;
+
+	while ((option = getopt(argc, argv, "c:s:b:r:a:m:z:p:d:o:")) != -1) {
+		switch (option) {
+		case 'c':
+			config.client_path = optarg;
+			break;
+		case 's':
+			config.shm_clients = strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			config.dmabuf_clients = strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			config.commit_rate = strtoul(optarg, NULL, 10);
+			break;
+		case 'a':
+			config.damage_size = optarg;
+			break;
+		case 'm':
+			config.move_rate = strtoul(optarg, NULL, 10);
+			break;
+		case 'z':
+			config.resize_rate = strtoul(optarg, NULL, 10);
+			break;
+		case 'p':
+			config.motion_rate = strtoul(optarg, NULL, 10);
+			break;
+		case 'd':
+			config.duration = strtoul(optarg, NULL, 10);
+			break;
+		case 'o':
+			config.output = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (config.commit_rate == 0 || config.duration == 0)
+		usage(argv[0]);
+
+	/* Benchmarks run without a display unless told otherwise. */
+	setenv("SWC_BACKEND", "headless", 0);
+	signal(SIGPIPE, SIG_IGN);
+	wl_list_init(&windows);
+	wl_array_init(&composite_times);
+	wl_array_init(&latencies);
+	wl_array_init(&clients);
+
+	if (!(display = wl_display_create()))
+		return EXIT_FAILURE;
+	if (!(socket = wl_display_add_socket_auto(display)))
+		return EXIT_FAILURE;
+	setenv("WAYLAND_DISPLAY", socket, 1);
+	if (!swc_initialize(display, NULL, &manager))
+		return EXIT_FAILURE;
+	if (!screen) {
+		fprintf(stderr, "No screens\n");
+		return EXIT_FAILURE;
+	}
+	wl_signal_add(&swc.compositor->signal.repaint, &repaint_listener);
+
+	for (i = 0; i < config.shm_clients; ++i) {
+		if (!spawn_client("shm"))
+			fprintf(stderr, "Could not start SHM client\n");
+	}
+	for (i = 0; i < config.dmabuf_clients; ++i) {
+		if (!spawn_client("dmabuf"))
+			fprintf(stderr, "Could not start dmabuf client\n");
+	}
+
+	move_timer = add_timer(&move_window, config.move_rate);
+	resize_timer = add_timer(&resize_window, config.resize_rate);
+	motion_timer = add_timer(&move_pointer, config.motion_rate);
+	finish_timer = wl_event_loop_add_timer(wl_display_get_event_loop(display), &finish, &finish_timer);
+	wl_event_source_timer_update(finish_timer, config.duration * 1000);
+
+	start_time = get_monotonic_ns();
+	wl_display_run(display);
+
+	wl_array_for_each (client, &clients)
+		collect_client(client);
+	if (config.output && !(output = fopen(config.output, "w"))) {
+		fprintf(stderr, "Could not open %s: %s\n", config.output, strerror(errno));
+		output = stdout;
+	}
+	report(output, elapsed);
+	if (output != stdout)
+		fclose(output);
+
+	swc_finalize();
+	wl_display_destroy(display);
+
+	return EXIT_SUCCESS;
+}
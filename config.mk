@@ -18,4 +18,5 @@ ENABLE_STATIC   = 1
 ENABLE_SHARED   = 1
 ENABLE_LIBUDEV  = 1
 ENABLE_XWAYLAND = 1
+ENABLE_WAYLAND_BACKEND = 1
 
@@ -30,21 +30,30 @@
 #include "swc.h"
 #include "compositor.h"
 #include "data_device_manager.h"
+#include "dispatch.h"
+#include "dmabuf.h"
 #include "drm.h"
 #include "event.h"
 #include "internal.h"
+#include "latency.h"
 #include "launch.h"
 #include "output.h"
+#include "plane.h"
 #include "pointer.h"
 #include "region.h"
 #include "screen.h"
+#include "screencopy.h"
 #include "seat.h"
 #include "shm.h"
+#include "stats.h"
 #include "surface.h"
+#include "trace.h"
 #include "util.h"
 #include "view.h"
+#include "wayland_buffer.h"
 
 #include <errno.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
@@ -53,8 +62,15 @@
 #include <xkbcommon/xkbcommon-keysyms.h>
 
 struct target {
+	struct screen *screen;
 	struct wld_surface *surface;
 	struct wld_buffer *next_buffer, *current_buffer;
+	uint32_t format;
+
+	/* The surface used before a format change, kept until its last buffer is
+	 * no longer being scanned out. */
+	struct wld_surface *old_surface;
+
 	struct view *view;
 	struct view_handler view_handler;
 	uint32_t mask;
@@ -64,11 +80,28 @@ struct target {
 
 static bool handle_motion(struct pointer_handler *handler, uint32_t time, wl_fixed_t x, wl_fixed_t y);
 static void perform_update(void *data);
+static void schedule_updates(uint32_t screens);
 
 static struct pointer_handler pointer_handler = {
 	.motion = handle_motion,
 };
 
+enum damage_kind {
+	DAMAGE_REPAINT,
+	DAMAGE_UPLOAD,
+	DAMAGE_BORDER,
+	NUM_DAMAGE_KINDS,
+};
+
+/* The number of frames over which damage marks fade out. */
+#define DAMAGE_FRAMES 10
+
+static const uint32_t damage_colors[NUM_DAMAGE_KINDS] = {
+	[DAMAGE_REPAINT] = 0xffff00ff,
+	[DAMAGE_UPLOAD] = 0xff00ff00,
+	[DAMAGE_BORDER] = 0xffffff00,
+};
+
 static struct {
 	struct wl_list views;
 	pixman_region32_t damage, opaque;
@@ -82,17 +115,46 @@ static struct {
 
 	bool updating;
 	struct wl_global *global;
+
+	struct {
+		bool enabled;
+
+		/* The damage of each kind in the last few frames, in global
+		 * coordinates, indexed by frame modulo DAMAGE_FRAMES. */
+		pixman_region32_t frames[DAMAGE_FRAMES][NUM_DAMAGE_KINDS];
+		unsigned current;
+
+		/* The region covered by marks in the last repaint, which must be
+		 * repainted again to erase them. */
+		pixman_region32_t marked;
+	} show_damage;
 } compositor;
 
 struct swc_compositor swc_compositor = {
 	.pointer_handler = &pointer_handler,
 };
 
+static uint64_t
+region_area(pixman_region32_t *region)
+{
+	pixman_box32_t *boxes;
+	int i, num_boxes;
+	uint64_t area = 0;
+
+	boxes = pixman_region32_rectangles(region, &num_boxes);
+	for (i = 0; i < num_boxes; ++i)
+		area += (uint64_t)(boxes[i].x2 - boxes[i].x1) * (boxes[i].y2 - boxes[i].y1);
+
+	return area;
+}
+
 static void
 handle_screen_destroy(struct wl_listener *listener, void *data)
 {
 	struct target *target = wl_container_of(listener, target, screen_destroy_listener);
 
+	if (target->old_surface)
+		wld_destroy_surface(target->old_surface);
 	wld_destroy_surface(target->surface);
 	free(target);
 }
@@ -110,17 +172,38 @@ static void
 handle_screen_frame(struct view_handler *handler, uint32_t time)
 {
 	struct target *target = wl_container_of(handler, target, view_handler);
+	struct screen_stats *stats = &target->screen->stats;
 	struct compositor_view *view;
+	uint64_t period, missed;
 
 	compositor.pending_flips &= ~target->mask;
 
+	++stats->frames;
+	++stats_totals.frames;
+	period = target->screen->planes.primary.mode.refresh ? 1000000000000ull / target->screen->planes.primary.mode.refresh : 0;
+	if (stats->submit_time && period) {
+		missed = (get_monotonic_ns() - stats->submit_time) / period;
+		stats->missed_vblanks += missed;
+		stats_totals.missed_vblanks += missed;
+	}
+	stats->submit_time = 0;
+	stats_publish();
+	latency_present(target->screen);
+
 	wl_list_for_each (view, &compositor.views, link) {
 		if (view->visible && view->base.screens & target->mask)
 			view_frame(&view->base, time);
 	}
 
-	if (target->current_buffer)
+	if (target->old_surface) {
+		/* The current buffer belonged to the old surface. */
+		wld_destroy_surface(target->old_surface);
+		target->old_surface = NULL;
+		if (target->format != target->screen->planes.primary.format)
+			schedule_updates(target->mask);
+	} else if (target->current_buffer) {
 		wld_surface_release(target->surface, target->current_buffer);
+	}
 
 	target->current_buffer = target->next_buffer;
 
@@ -152,7 +235,15 @@ target_new(struct screen *screen)
 	if (!(target = malloc(sizeof(*target))))
 		goto error0;
 
-	target->surface = wld_create_surface(swc.drm->context, geom->width, geom->height, WLD_FORMAT_XRGB8888, WLD_DRM_FLAG_SCANOUT);
+	target->screen = screen;
+	target->format = screen->planes.primary.format;
+	target->surface = wld_create_surface(swc.drm->context, geom->width, geom->height, target->format, WLD_DRM_FLAG_SCANOUT);
+
+	if (!target->surface && target->format != WLD_FORMAT_XRGB8888) {
+		WARNING("Could not create target with format %#" PRIx32 ", falling back to XRGB8888\n", target->format);
+		target->format = screen->planes.primary.format = WLD_FORMAT_XRGB8888;
+		target->surface = wld_create_surface(swc.drm->context, geom->width, geom->height, target->format, WLD_DRM_FLAG_SCANOUT);
+	}
 
 	if (!target->surface)
 		goto error1;
@@ -160,7 +251,9 @@ target_new(struct screen *screen)
 	target->view = &screen->planes.primary.view;
 	target->view_handler.impl = &screen_view_handler;
 	wl_list_insert(&target->view->handlers, &target->view_handler.link);
+	target->next_buffer = NULL;
 	target->current_buffer = NULL;
+	target->old_surface = NULL;
 	target->mask = screen_mask(screen);
 
 	target->screen_destroy_listener.notify = &handle_screen_destroy;
@@ -174,6 +267,152 @@ error0:
 	return NULL;
 }
 
+static void
+target_update_format(struct target *target, struct screen *screen)
+{
+	const struct swc_rectangle *geom = &screen->base.geometry;
+	struct wld_surface *surface;
+	uint32_t format = screen->planes.primary.format;
+
+	surface = wld_create_surface(swc.drm->context, geom->width, geom->height, format, WLD_DRM_FLAG_SCANOUT);
+	if (!surface) {
+		WARNING("Could not create target with format %#" PRIx32 "\n", format);
+		screen->planes.primary.format = target->format;
+		return;
+	}
+
+	target->old_surface = target->surface;
+	target->surface = surface;
+	target->format = format;
+	/* Page flips can't change the framebuffer format, so the first frame in
+	 * the new format must set the CRTC. */
+	screen->planes.primary.need_modeset = true;
+	pixman_region32_union_rect(&compositor.damage, &compositor.damage, geom->x, geom->y, geom->width, geom->height);
+}
+
+bool
+compositor_prepare_capture(struct screen *screen)
+{
+	struct plane *plane = screen->planes.overlay;
+
+	if (!plane || !plane->view.buffer)
+		return true;
+	/* assign_overlay keeps views off the plane while a capture is pending. */
+	schedule_updates(screen_mask(screen));
+	return false;
+}
+
+void
+compositor_update_screen_format(struct screen *screen)
+{
+	struct target *target;
+
+	/* Screens without a target yet pick up the format when it is created. */
+	if (!(target = target_get(screen)) || target->format == screen->planes.primary.format)
+		return;
+	schedule_updates(screen_mask(screen));
+}
+
+struct wld_buffer *
+compositor_get_screen_buffer(struct screen *screen)
+{
+	struct target *target = target_get(screen);
+
+	return target ? target->next_buffer : NULL;
+}
+
+/* Damage visualization {{{ */
+
+static void
+mark_damage(enum damage_kind kind, pixman_region32_t *damage, int32_t x, int32_t y)
+{
+	pixman_region32_t *frame = &compositor.show_damage.frames[compositor.show_damage.current][kind];
+
+	if (!compositor.show_damage.enabled)
+		return;
+
+	pixman_region32_translate(damage, x, y);
+	pixman_region32_union(frame, frame, damage);
+	pixman_region32_translate(damage, -x, -y);
+}
+
+static void
+begin_damage_frame(void)
+{
+	unsigned kind;
+
+	if (!compositor.show_damage.enabled)
+		return;
+
+	compositor.show_damage.current = (compositor.show_damage.current + 1) % DAMAGE_FRAMES;
+	for (kind = 0; kind < NUM_DAMAGE_KINDS; ++kind)
+		pixman_region32_clear(&compositor.show_damage.frames[compositor.show_damage.current][kind]);
+}
+
+/**
+ * Draws the recent damage over a target as horizontal lines, which become
+ * sparser as the damage gets older.
+ */
+static void
+draw_damage_marks(struct target *target)
+{
+	const struct swc_rectangle *geom = &target->view->geometry;
+	pixman_region32_t region;
+	pixman_box32_t *boxes;
+	unsigned age, frame, kind, spacing;
+	int i, num_boxes;
+	int32_t y;
+
+	pixman_region32_init(&region);
+
+	/* Draw the oldest marks first, so that the newest are on top. */
+	for (age = DAMAGE_FRAMES; age-- > 0;) {
+		frame = (compositor.show_damage.current + DAMAGE_FRAMES - age) % DAMAGE_FRAMES;
+		spacing = age + 2;
+
+		for (kind = 0; kind < NUM_DAMAGE_KINDS; ++kind) {
+			pixman_region32_intersect_rect(&region, &compositor.show_damage.frames[frame][kind],
+			                               geom->x, geom->y, geom->width, geom->height);
+			pixman_region32_union(&compositor.show_damage.marked, &compositor.show_damage.marked, &region);
+			boxes = pixman_region32_rectangles(&region, &num_boxes);
+
+			for (i = 0; i < num_boxes; ++i) {
+				/* Keep the lines aligned to the screen as they fade, and
+				 * offset each kind so that they interleave. */
+				y = boxes[i].y1 + (spacing - (boxes[i].y1 - geom->y + kind) % spacing) % spacing;
+				for (; y < boxes[i].y2; y += spacing) {
+					wld_fill_rectangle(swc.drm->renderer, damage_colors[kind],
+					                   boxes[i].x1 - geom->x, y - geom->y, boxes[i].x2 - boxes[i].x1, 1);
+				}
+			}
+		}
+	}
+
+	pixman_region32_fini(&region);
+}
+
+EXPORT void
+swc_show_damage(bool show)
+{
+	unsigned frame, kind;
+
+	if (compositor.show_damage.enabled == show)
+		return;
+
+	compositor.show_damage.enabled = show;
+	if (!show) {
+		for (frame = 0; frame < DAMAGE_FRAMES; ++frame) {
+			for (kind = 0; kind < NUM_DAMAGE_KINDS; ++kind)
+				pixman_region32_clear(&compositor.show_damage.frames[frame][kind]);
+		}
+		pixman_region32_union(&compositor.damage, &compositor.damage, &compositor.show_damage.marked);
+		pixman_region32_clear(&compositor.show_damage.marked);
+		schedule_updates(-1);
+	}
+}
+
+/* }}} */
+
 /* Rendering {{{ */
 
 static void
@@ -182,7 +421,7 @@ repaint_view(struct target *target, struct compositor_view *view, pixman_region3
 	pixman_region32_t view_region, view_damage, border_damage;
 	const struct swc_rectangle *geom = &view->base.geometry, *target_geom = &target->view->geometry;
 
-	if (!view->base.buffer)
+	if (!view->base.buffer || view->plane)
 		return;
 
 	pixman_region32_init_rect(&view_region, geom->x, geom->y, geom->width, geom->height);
@@ -205,6 +444,7 @@ repaint_view(struct target *target, struct compositor_view *view, pixman_region3
 
 	/* Draw border */
 	if (pixman_region32_not_empty(&border_damage)) {
+		mark_damage(DAMAGE_BORDER, &border_damage, 0, 0);
 		pixman_region32_translate(&border_damage, -target_geom->x, -target_geom->y);
 		wld_fill_region(swc.drm->renderer, view->border.color, &border_damage);
 	}
@@ -234,6 +474,9 @@ renderer_repaint(struct target *target, pixman_region32_t *damage, pixman_region
 			repaint_view(target, view, damage);
 	}
 
+	if (compositor.show_damage.enabled)
+		draw_damage_marks(target);
+
 	wld_flush(swc.drm->renderer);
 }
 
@@ -241,20 +484,35 @@ static int
 renderer_attach(struct compositor_view *view, struct wld_buffer *client_buffer)
 {
 	struct wld_buffer *buffer;
+	uint64_t size;
 	bool was_proxy = view->buffer != view->base.buffer;
-	bool needs_proxy = client_buffer && !(wld_capabilities(swc.drm->renderer, client_buffer) & WLD_CAPABILITY_READ);
+	bool is_yuv = client_buffer && dmabuf_format_is_yuv(client_buffer->format);
+	bool needs_proxy = client_buffer && (is_yuv || !(wld_capabilities(swc.drm->renderer, client_buffer) & WLD_CAPABILITY_READ));
 	bool resized = view->buffer && client_buffer && (view->buffer->width != client_buffer->width || view->buffer->height != client_buffer->height);
 
 	if (client_buffer) {
 		/* Create a proxy buffer if necessary (for example a hardware buffer backing
-		 * a SHM buffer). */
+		 * a SHM buffer, or an RGB copy of a YUV buffer). */
 		if (needs_proxy) {
 			if (!was_proxy || resized) {
 				DEBUG("Creating a proxy buffer\n");
-				buffer = wld_create_buffer(swc.drm->context, client_buffer->width, client_buffer->height, client_buffer->format, WLD_FLAG_MAP);
+				buffer = wld_create_buffer(swc.drm->context, client_buffer->width, client_buffer->height,
+				                           is_yuv ? WLD_FORMAT_XRGB8888 : client_buffer->format, WLD_FLAG_MAP);
 
 				if (!buffer)
 					return -ENOMEM;
+
+				/* A replaced proxy keeps its charge, so that the client is not
+				 * briefly charged for both. */
+				size = (uint64_t)buffer->pitch * buffer->height;
+				if (was_proxy ? !stats_recharge(&view->proxy_charge, size)
+				              : !stats_charge(&view->proxy_charge, wl_resource_get_client(view->surface->resource), STATS_PROXY, size))
+				{
+					wld_buffer_unreference(buffer);
+					wl_resource_post_no_memory(view->surface->resource);
+					return -ENOMEM;
+				}
+				stats_totals.buffer_bytes += size;
 			} else {
 				/* Otherwise we can keep the original proxy buffer. */
 				buffer = view->buffer;
@@ -268,8 +526,12 @@ renderer_attach(struct compositor_view *view, struct wld_buffer *client_buffer)
 
 	/* If we no longer need a proxy buffer, or the original buffer is of a
 	 * different size, destroy the old proxy image. */
-	if (view->buffer && ((!needs_proxy && was_proxy) || (needs_proxy && resized)))
+	if (view->buffer && ((!needs_proxy && was_proxy) || (needs_proxy && resized))) {
+		stats_totals.buffer_bytes -= (uint64_t)view->buffer->pitch * view->buffer->height;
+		if (!needs_proxy)
+			stats_uncharge(&view->proxy_charge);
 		wld_buffer_unreference(view->buffer);
+	}
 
 	view->buffer = buffer;
 
@@ -277,14 +539,35 @@ renderer_attach(struct compositor_view *view, struct wld_buffer *client_buffer)
 }
 
 static void
-renderer_flush_view(struct compositor_view *view)
+renderer_flush_view(struct compositor_view *view, pixman_region32_t *damage)
 {
+	struct client_stats *stats;
+	uint64_t start, bytes;
+
 	if (view->buffer == view->base.buffer)
 		return;
 
+	TRACE_BEGIN("renderer_flush_view");
+	start = get_monotonic_ns();
+	mark_damage(DAMAGE_UPLOAD, damage, view->base.geometry.x, view->base.geometry.y);
+	if (dmabuf_format_is_yuv(view->base.buffer->format)) {
+		if (!dmabuf_convert(view->buffer, view->base.buffer, damage))
+			WARNING("Could not convert YUV buffer\n");
+		stats_totals.flush_time += get_monotonic_ns() - start;
+		TRACE_END();
+		return;
+	}
+
 	wld_set_target_buffer(swc.shm->renderer, view->buffer);
-	wld_copy_region(swc.shm->renderer, view->base.buffer, 0, 0, &view->surface->state.damage);
+	wld_copy_region(swc.shm->renderer, view->base.buffer, 0, 0, damage);
 	wld_flush(swc.shm->renderer);
+
+	bytes = region_area(damage) * (view->base.buffer->pitch / view->base.buffer->width);
+	stats_totals.shm_bytes += bytes;
+	if ((stats = stats_client(wl_resource_get_client(view->surface->resource))))
+		stats->shm_bytes += bytes;
+	stats_totals.flush_time += get_monotonic_ns() - start;
+	TRACE_END();
 }
 
 /* }}} */
@@ -332,7 +615,7 @@ static void
 schedule_updates(uint32_t screens)
 {
 	if (compositor.scheduled_updates == 0)
-		wl_event_loop_add_idle(swc.event_loop, &perform_update, NULL);
+		dispatch_add_idle("perform_update", &perform_update, NULL);
 
 	if (screens == -1) {
 		struct screen *screen;
@@ -434,6 +717,38 @@ static const struct view_impl view_impl = {
 	.move = move,
 };
 
+static void
+handle_held_buffer_destroy(struct wl_listener *listener, void *data)
+{
+	struct compositor_view *view = wl_container_of(listener, view, held_buffer_destroy_listener);
+
+	view->held_buffer = NULL;
+}
+
+static void
+release_held_buffer(struct compositor_view *view)
+{
+	if (!view->held_buffer)
+		return;
+	wl_list_remove(&view->held_buffer_destroy_listener.link);
+	wl_buffer_send_release(view->held_buffer);
+	view->held_buffer = NULL;
+}
+
+void
+compositor_view_release_buffer(struct compositor_view *view, struct wl_resource *buffer)
+{
+	if (!view->plane || view->plane->view.buffer != wayland_buffer_get(buffer)) {
+		wl_buffer_send_release(buffer);
+		return;
+	}
+
+	/* Any buffer held before this one has already left the plane. */
+	release_held_buffer(view);
+	view->held_buffer = buffer;
+	wl_resource_add_destroy_listener(buffer, &view->held_buffer_destroy_listener);
+}
+
 struct compositor_view *
 compositor_create_view(struct surface *surface)
 {
@@ -447,8 +762,12 @@ compositor_create_view(struct surface *surface)
 	view_initialize(&view->base, &view_impl);
 	view->surface = surface;
 	view->buffer = NULL;
+	view->proxy_charge = (struct stats_charge){0};
 	view->window = NULL;
 	view->parent = NULL;
+	view->plane = NULL;
+	view->held_buffer = NULL;
+	view->held_buffer_destroy_listener.notify = &handle_held_buffer_destroy;
 	view->visible = false;
 	view->extents.x1 = 0;
 	view->extents.y1 = 0;
@@ -459,8 +778,9 @@ compositor_create_view(struct surface *surface)
 	view->border.damaged = false;
 	pixman_region32_init(&view->clip);
 	wl_signal_init(&view->destroy_signal);
-	surface_set_view(surface, &view->base);
+	wl_signal_init(&view->commit_signal);
 	wl_list_insert(&compositor.views, &view->link);
+	surface_set_view(surface, &view->base);
 
 	return view;
 }
@@ -468,9 +788,20 @@ compositor_create_view(struct surface *surface)
 void
 compositor_view_destroy(struct compositor_view *view)
 {
+	struct compositor_view *other;
+
 	wl_signal_emit(&view->destroy_signal, NULL);
 	compositor_view_hide(view);
+
+	wl_list_for_each (other, &compositor.views, link) {
+		if (other->parent == view)
+			other->parent = NULL;
+	}
+
 	surface_set_view(view->surface, NULL);
+	release_held_buffer(view);
+	/* Release the proxy buffer, if there is one. */
+	renderer_attach(view, NULL);
 	view_finalize(&view->base);
 	pixman_region32_fini(&view->clip);
 	wl_list_remove(&view->link);
@@ -486,7 +817,10 @@ compositor_view(struct view *view)
 void
 compositor_view_set_parent(struct compositor_view *view, struct compositor_view *parent)
 {
-	view->parent = view;
+	view->parent = parent;
+
+	if (!parent)
+		return;
 
 	if (parent->visible)
 		compositor_view_show(view);
@@ -494,6 +828,39 @@ compositor_view_set_parent(struct compositor_view *view, struct compositor_view
 		compositor_view_hide(view);
 }
 
+static void
+restack_view(struct compositor_view *view, struct wl_list *position)
+{
+	wl_list_remove(&view->link);
+	wl_list_insert(position, &view->link);
+
+	if (view->visible) {
+		/* The parts of the view that were previously covered may now be
+		 * visible, so damage the whole view. */
+		pixman_region32_clear(&view->clip);
+		damage_view(view);
+		update(&view->base);
+	}
+}
+
+void
+compositor_view_place_above(struct compositor_view *view, struct compositor_view *sibling)
+{
+	if (view == sibling || view->link.next == &sibling->link)
+		return;
+
+	restack_view(view, sibling->link.prev);
+}
+
+void
+compositor_view_place_below(struct compositor_view *view, struct compositor_view *sibling)
+{
+	if (view == sibling || sibling->link.next == &view->link)
+		return;
+
+	restack_view(view, &sibling->link);
+}
+
 void
 compositor_view_show(struct compositor_view *view)
 {
@@ -529,6 +896,11 @@ compositor_view_hide(struct compositor_view *view)
 	update(&view->base);
 	damage_below_view(view);
 
+	if (view->plane) {
+		view_attach(&view->plane->view, NULL);
+		view_update(&view->plane->view);
+		view->plane = NULL;
+	}
 	view_set_screens(&view->base, 0);
 	view->visible = false;
 
@@ -538,6 +910,42 @@ compositor_view_hide(struct compositor_view *view)
 	}
 }
 
+void
+compositor_view_commit(struct compositor_view *view)
+{
+	pixman_region32_t damage;
+
+	if (wl_list_empty(&view->commit_signal.listener_list))
+		return;
+
+	pixman_region32_init(&damage);
+	if (compositor_view_flush(view, &damage) && pixman_region32_not_empty(&damage))
+		wl_signal_emit(&view->commit_signal, &damage);
+	pixman_region32_fini(&damage);
+}
+
+struct wld_buffer *
+compositor_view_flush(struct compositor_view *view, pixman_region32_t *damage)
+{
+	pixman_region32_t *surface_damage = &view->surface->state.damage;
+
+	pixman_region32_union(damage, damage, surface_damage);
+	if (view->visible && !view->plane) {
+		pixman_region32_translate(surface_damage, view->base.geometry.x, view->base.geometry.y);
+		pixman_region32_union(&compositor.damage, &compositor.damage, surface_damage);
+	}
+	/* Hidden views are completely damaged when they are shown. */
+	pixman_region32_clear(surface_damage);
+
+	if (!view->buffer)
+		return NULL;
+	/* Views on a plane are scanned out from the client's buffer, but the
+	 * caller still wants the proxy, if there is one, to be up to date. */
+	if (pixman_region32_not_empty(damage))
+		renderer_flush_view(view, damage);
+	return view->buffer;
+}
+
 void
 compositor_view_set_border_width(struct compositor_view *view, uint32_t width)
 {
@@ -569,6 +977,108 @@ compositor_view_set_border_color(struct compositor_view *view, uint32_t color)
 
 /* }}} */
 
+/* Planes {{{ */
+
+/**
+ * Returns whether the view can be scanned out directly on the given plane. The
+ * overlay sits above everything the renderer draws, so the view must be opaque
+ * and not overlapped by any view above it, given in 'above'.
+ */
+static bool
+can_scan_out(struct compositor_view *view, struct screen *screen, struct plane *plane, pixman_region32_t *above)
+{
+	const struct swc_rectangle *geom = &view->base.geometry, *screen_geom = &screen->base.geometry;
+	struct wld_buffer *buffer = view->base.buffer;
+	const struct dmabuf_attributes *attributes;
+	pixman_box32_t box = {0, 0, geom->width, geom->height};
+
+	if (!buffer || !(attributes = dmabuf_get_attributes(buffer)))
+		return false;
+	if (buffer->format != WLD_FORMAT_XRGB8888 && !dmabuf_format_is_yuv(buffer->format)
+	 && pixman_region32_contains_rectangle(&view->surface->state.opaque, &box) != PIXMAN_REGION_IN)
+		return false;
+	if (view->border.width > 0 || view->base.screens != screen_mask(screen))
+		return false;
+	if (geom->x < screen_geom->x || geom->y < screen_geom->y
+	 || geom->x + geom->width > screen_geom->x + screen_geom->width
+	 || geom->y + geom->height > screen_geom->y + screen_geom->height)
+		return false;
+	if (!plane_supports_modifier(plane, buffer->format, attributes->modifier))
+		return false;
+
+	return pixman_region32_contains_rectangle(above, &view->extents) == PIXMAN_REGION_OUT;
+}
+
+static void
+assign_overlay(struct screen *screen)
+{
+	struct plane *plane = screen->planes.overlay;
+	struct compositor_view *view, *current = NULL, *next = NULL;
+	pixman_region32_t above;
+	bool capturing;
+
+	if (!plane)
+		return;
+
+	/* Captures are copied from the rendered buffer, so everything must be
+	 * composited while one is pending. */
+	capturing = screencopy_is_pending(screen);
+
+	pixman_region32_init(&above);
+	wl_list_for_each (view, &compositor.views, link) {
+		if (view->plane == plane)
+			current = view;
+		if (!view->visible || !(view->base.screens & screen_mask(screen)))
+			continue;
+		if (!next && !capturing && can_scan_out(view, screen, plane, &above))
+			next = view;
+		pixman_region32_union_rect(&above, &above, view->extents.x1, view->extents.y1,
+		                           view->extents.x2 - view->extents.x1, view->extents.y2 - view->extents.y1);
+	}
+	pixman_region32_fini(&above);
+
+	if (next) {
+		bool changed = false;
+
+		if (plane->view.buffer != next->base.buffer) {
+			view_attach(&plane->view, next->base.buffer);
+			changed = true;
+		}
+		if (plane->view.geometry.x != next->base.geometry.x || plane->view.geometry.y != next->base.geometry.y) {
+			view_move(&plane->view, next->base.geometry.x, next->base.geometry.y);
+			changed = true;
+		}
+		/* If the plane can't take the buffer, let the renderer draw the view. */
+		if (!plane->fb || (changed && !view_update(&plane->view)))
+			next = NULL;
+	}
+
+	if (current && current != next) {
+		pixman_region32_t region;
+
+		/* The renderer needs to draw the view again, so bring its proxy up to date. */
+		current->plane = NULL;
+		pixman_region32_init_rect(&region, 0, 0, current->base.geometry.width, current->base.geometry.height);
+		renderer_flush_view(current, &region);
+		pixman_region32_fini(&region);
+		damage_view(current);
+	}
+
+	if (next) {
+		next->plane = plane;
+	} else if (plane->view.buffer) {
+		view_attach(&plane->view, NULL);
+		view_update(&plane->view);
+	}
+
+	/* Once the plane has switched to another framebuffer, the client may
+	 * reuse the buffer it was showing. */
+	if (current && current->held_buffer && wayland_buffer_get(current->held_buffer) != plane->view.buffer)
+		release_held_buffer(current);
+}
+
+/* }}} */
+
 static void
 calculate_damage(void)
 {
@@ -576,6 +1086,7 @@ calculate_damage(void)
 	struct swc_rectangle *geom;
 	pixman_region32_t surface_opaque, *surface_damage;
 
+	TRACE_BEGIN("calculate_damage");
 	pixman_region32_clear(&compositor.opaque);
 	pixman_region32_init(&surface_opaque);
 
@@ -598,8 +1109,11 @@ calculate_damage(void)
 
 		surface_damage = &view->surface->state.damage;
 
-		if (pixman_region32_not_empty(surface_damage)) {
-			renderer_flush_view(view);
+		if (view->plane) {
+			/* The view is scanned out directly, so there is nothing to render. */
+			pixman_region32_clear(surface_damage);
+		} else if (pixman_region32_not_empty(surface_damage)) {
+			renderer_flush_view(view, surface_damage);
 
 			/* Translate surface damage to global coordinates. */
 			pixman_region32_translate(surface_damage, geom->x, geom->y);
@@ -627,6 +1141,7 @@ calculate_damage(void)
 	}
 
 	pixman_region32_fini(&surface_opaque);
+	TRACE_END();
 }
 
 static void
@@ -635,6 +1150,7 @@ update_screen(struct screen *screen)
 	struct target *target;
 	const struct swc_rectangle *geom = &screen->base.geometry;
 	pixman_region32_t damage, *total_damage;
+	uint64_t start, duration;
 
 	if (!(compositor.scheduled_updates & screen_mask(screen)))
 		return;
@@ -642,6 +1158,14 @@ update_screen(struct screen *screen)
 	if (!(target = target_get(screen)))
 		return;
 
+	TRACE_BEGIN("update_screen");
+	start = get_monotonic_ns();
+
+	/* Wait for the buffers of any previous format to be released first. */
+	if (target->format != screen->planes.primary.format && !target->old_surface
+	 && !(compositor.pending_flips & screen_mask(screen)))
+		target_update_format(target, screen);
+
 	pixman_region32_init(&damage);
 	pixman_region32_intersect_rect(&damage, &compositor.damage, geom->x, geom->y, geom->width, geom->height);
 	pixman_region32_translate(&damage, -geom->x, -geom->y);
@@ -650,9 +1174,12 @@ update_screen(struct screen *screen)
 	/* Don't repaint the screen if it is waiting for a page flip. */
 	if (compositor.pending_flips & screen_mask(screen)) {
 		pixman_region32_fini(&damage);
+		TRACE_END();
 		return;
 	}
 
+	screencopy_add_damage(screen, &damage);
+
 	pixman_region32_t base_damage;
 	pixman_region32_copy(&damage, total_damage);
 	pixman_region32_translate(&damage, geom->x, geom->y);
@@ -667,11 +1194,23 @@ update_screen(struct screen *screen)
 		/* If we get an EACCES, it is because this session is being deactivated, but
 		 * we haven't yet received the deactivate signal from swc-launch. */
 		swc_deactivate();
+		/* fallthrough */
+	default:
+		/* Nothing will show the buffer we took, so give it back. */
+		wld_surface_release(target->surface, target->next_buffer);
+		target->next_buffer = target->current_buffer;
 		break;
 	case 0:
 		compositor.pending_flips |= screen_mask(screen);
+		screencopy_handle_repaint(screen);
+		latency_submit(screen);
+		screen->stats.submit_time = get_monotonic_ns();
 		break;
 	}
+	duration = get_monotonic_ns() - start;
+	screen->stats.composite_time += duration;
+	stats_totals.repaint_time += duration;
+	TRACE_END();
 }
 
 static void
@@ -679,14 +1218,35 @@ perform_update(void *data)
 {
 	struct screen *screen;
 	uint32_t updates = compositor.scheduled_updates & ~compositor.pending_flips;
+	uint64_t start, damage_start, duration;
 
 	if (!swc.active || !updates)
 		return;
 
 	DEBUG("Performing update\n");
+	TRACE_BEGIN("perform_update");
+	start = get_monotonic_ns();
 
 	compositor.updating = true;
+	begin_damage_frame();
+
+	wl_list_for_each (screen, &swc.screens, link) {
+		if (updates & screen_mask(screen))
+			assign_overlay(screen);
+	}
+
+	damage_start = get_monotonic_ns();
 	calculate_damage();
+	stats_totals.damage_time += get_monotonic_ns() - damage_start;
+	stats_totals.damage_pixels += region_area(&compositor.damage);
+	TRACE_COUNTER("damage_rects", pixman_region32_n_rects(&compositor.damage));
+
+	if (compositor.show_damage.enabled) {
+		mark_damage(DAMAGE_REPAINT, &compositor.damage, 0, 0);
+		/* Erase the marks drawn in the last repaint. */
+		pixman_region32_union(&compositor.damage, &compositor.damage, &compositor.show_damage.marked);
+		pixman_region32_clear(&compositor.show_damage.marked);
+	}
 
 	wl_list_for_each (screen, &swc.screens, link)
 		update_screen(screen);
@@ -695,6 +1255,16 @@ perform_update(void *data)
 	pixman_region32_clear(&compositor.damage);
 	compositor.scheduled_updates &= ~updates;
 	compositor.updating = false;
+
+	/* Keep repainting until the damage marks have faded. */
+	if (pixman_region32_not_empty(&compositor.show_damage.marked))
+		schedule_updates(-1);
+
+	duration = get_monotonic_ns() - start;
+	stats_totals.update_time += duration;
+	stats_publish();
+	wl_signal_emit(&swc_compositor.signal.repaint, &duration);
+	TRACE_END();
 }
 
 bool
@@ -803,6 +1373,7 @@ compositor_initialize(void)
 {
 	struct screen *screen;
 	uint32_t keysym;
+	unsigned frame, kind;
 
 	compositor.global = wl_global_create(swc.display, &wl_compositor_interface, 4, NULL, &bind_compositor);
 
@@ -814,8 +1385,16 @@ compositor_initialize(void)
 	compositor.updating = false;
 	pixman_region32_init(&compositor.damage);
 	pixman_region32_init(&compositor.opaque);
+	for (frame = 0; frame < DAMAGE_FRAMES; ++frame) {
+		for (kind = 0; kind < NUM_DAMAGE_KINDS; ++kind)
+			pixman_region32_init(&compositor.show_damage.frames[frame][kind]);
+	}
+	pixman_region32_init(&compositor.show_damage.marked);
+	compositor.show_damage.current = 0;
+	compositor.show_damage.enabled = getenv("SWC_SHOW_DAMAGE") != NULL;
 	wl_list_init(&compositor.views);
 	wl_signal_init(&swc_compositor.signal.new_surface);
+	wl_signal_init(&swc_compositor.signal.repaint);
 	compositor.swc_listener.notify = &handle_swc_event;
 	wl_signal_add(&swc.event_signal, &compositor.swc_listener);
 
@@ -835,6 +1414,13 @@ compositor_initialize(void)
 void
 compositor_finalize(void)
 {
+	unsigned frame, kind;
+
+	for (frame = 0; frame < DAMAGE_FRAMES; ++frame) {
+		for (kind = 0; kind < NUM_DAMAGE_KINDS; ++kind)
+			pixman_region32_fini(&compositor.show_damage.frames[frame][kind]);
+	}
+	pixman_region32_fini(&compositor.show_damage.marked);
 	pixman_region32_fini(&compositor.damage);
 	pixman_region32_fini(&compositor.opaque);
 	wl_global_destroy(compositor.global);
@@ -24,6 +24,7 @@
 #ifndef SWC_COMPOSITOR_H
 #define SWC_COMPOSITOR_H
 
+#include "stats.h"
 #include "view.h"
 
 #include <stdbool.h>
@@ -40,19 +41,55 @@ struct swc_compositor {
 		 * created.
 		 */
 		struct wl_signal new_surface;
+
+		/**
+		 * Emitted after each repaint.
+		 *
+		 * The data argument of the signal points to the time spent
+		 * compositing, in nanoseconds, as a uint64_t.
+		 */
+		struct wl_signal repaint;
 	} signal;
 };
 
 bool compositor_initialize(void);
 void compositor_finalize(void);
 
+struct screen;
+
+/**
+ * Switch the screen's target buffers to the format of its primary plane.
+ */
+void compositor_update_screen_format(struct screen *screen);
+
+/**
+ * Returns the most recently rendered buffer of a screen, if any.
+ */
+struct wld_buffer *compositor_get_screen_buffer(struct screen *screen);
+
+/**
+ * Returns whether the most recently rendered buffer of a screen shows all of
+ * its views. If some are scanned out on a plane instead, a repaint that
+ * composites them is scheduled, and false is returned.
+ */
+bool compositor_prepare_capture(struct screen *screen);
+
 struct compositor_view {
 	struct view base;
 	struct surface *surface;
 	struct wld_buffer *buffer;
+	/* The charge to the client for buffer, if it is a proxy. */
+	struct stats_charge proxy_charge;
 	struct window *window;
 	struct compositor_view *parent;
 
+	/* The hardware plane the view is being scanned out on, if any. */
+	struct plane *plane;
+	/* A buffer the surface replaced while the plane was still scanning it
+	 * out, which is released once the plane shows another. */
+	struct wl_resource *held_buffer;
+	struct wl_listener held_buffer_destroy_listener;
+
 	/* Whether or not the view is visible (mapped). */
 	bool visible;
 
@@ -71,6 +108,9 @@ struct compositor_view {
 
 	struct wl_list link;
 	struct wl_signal destroy_signal;
+	/* Emitted when the view's surface commits damage, with the damaged
+	 * region of the buffer the view is composited from. */
+	struct wl_signal commit_signal;
 };
 
 struct compositor_view *compositor_create_view(struct surface *surface);
@@ -84,9 +124,36 @@ struct compositor_view *compositor_view(struct view *view);
 
 void compositor_view_set_parent(struct compositor_view *view, struct compositor_view *parent);
 
+/**
+ * Move view directly above or below sibling in the stacking order.
+ */
+void compositor_view_place_above(struct compositor_view *view, struct compositor_view *sibling);
+void compositor_view_place_below(struct compositor_view *view, struct compositor_view *sibling);
+
 void compositor_view_show(struct compositor_view *view);
 void compositor_view_hide(struct compositor_view *view);
 
+/**
+ * Called after the view's surface commits, to report its damage through the
+ * commit signal.
+ */
+void compositor_view_commit(struct compositor_view *view);
+
+/**
+ * Bring the buffer the view is composited from up to date within the given
+ * region and the surface damage not yet rendered, and return it.
+ *
+ * The surface damage is added to the region and handed to the compositor, so
+ * it is not copied again when the view is repainted.
+ */
+struct wld_buffer *compositor_view_flush(struct compositor_view *view, pixman_region32_t *damage);
+
+/**
+ * Send a release for a buffer the view's surface no longer uses, or hold it
+ * while the buffer is still being scanned out.
+ */
+void compositor_view_release_buffer(struct compositor_view *view, struct wl_resource *buffer);
+
 void compositor_view_set_border_color(struct compositor_view *view, uint32_t color);
 void compositor_view_set_border_width(struct compositor_view *view, uint32_t width);
 
@@ -0,0 +1,312 @@
+/* swc: libswc/dispatch.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "dispatch.h"
+#include "internal.h"
+#include "stats.h"
+#include "util.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Bucket i counts the dispatches that took less than 2^(i+1) microseconds,
+ * except for the last, which counts the rest. */
+#define NUM_BUCKETS 16
+
+struct profile {
+	const char *name;
+	uint64_t dispatches, total_time, max_time;
+	uint64_t buckets[NUM_BUCKETS];
+	struct wl_list link;
+};
+
+struct source {
+	struct wl_event_source *source;
+	struct profile *profile;
+	union {
+		wl_event_loop_fd_func_t fd;
+		wl_event_loop_timer_func_t timer;
+		wl_event_loop_signal_func_t signal;
+		wl_event_loop_idle_func_t idle;
+	} func;
+	void *data;
+	struct wl_list link;
+};
+
+static struct {
+	struct wl_list profiles;
+	struct wl_list sources;
+	uint64_t threshold;
+} dispatch;
+
+static struct profile *
+get_profile(const char *name)
+{
+	struct profile *profile;
+
+	wl_list_for_each (profile, &dispatch.profiles, link) {
+		if (strcmp(profile->name, name) == 0)
+			return profile;
+	}
+
+	if (!(profile = calloc(1, sizeof(*profile))))
+		return NULL;
+	profile->name = name;
+	wl_list_insert(dispatch.profiles.prev, &profile->link);
+
+	return profile;
+}
+
+static void
+record(struct profile *profile, uint64_t start)
+{
+	uint64_t time = get_monotonic_ns() - start;
+	unsigned bucket;
+
+	++profile->dispatches;
+	profile->total_time += time;
+	if (time > profile->max_time)
+		profile->max_time = time;
+	for (bucket = 0; bucket < NUM_BUCKETS - 1 && time >= 2000ull << bucket; ++bucket)
+		;
+	++profile->buckets[bucket];
+
+	if (dispatch.threshold && time >= dispatch.threshold)
+		WARNING("Dispatching %s took %" PRIu64 ".%03" PRIu64 " ms\n", profile->name, time / 1000000, time / 1000 % 1000);
+}
+
+static uint64_t
+begin_dispatch(void)
+{
+	/* Any client request being handled has finished by now. */
+	stats_end_request();
+
+	return get_monotonic_ns();
+}
+
+/* The callbacks may remove their own source, so the profile is looked up
+ * before calling them. */
+
+static int
+dispatch_fd(int fd, uint32_t mask, void *data)
+{
+	struct source *source = data;
+	struct profile *profile = source->profile;
+	uint64_t start = begin_dispatch();
+	int ret;
+
+	ret = source->func.fd(fd, mask, source->data);
+	record(profile, start);
+
+	return ret;
+}
+
+static int
+dispatch_timer(void *data)
+{
+	struct source *source = data;
+	struct profile *profile = source->profile;
+	uint64_t start = begin_dispatch();
+	int ret;
+
+	ret = source->func.timer(source->data);
+	record(profile, start);
+
+	return ret;
+}
+
+static int
+dispatch_signal(int signal, void *data)
+{
+	struct source *source = data;
+	struct profile *profile = source->profile;
+	uint64_t start = begin_dispatch();
+	int ret;
+
+	ret = source->func.signal(signal, source->data);
+	record(profile, start);
+
+	return ret;
+}
+
+static void
+dispatch_idle(void *data)
+{
+	struct source *source = data;
+	uint64_t start = begin_dispatch();
+
+	/* Idle sources are destroyed after they are dispatched. */
+	wl_list_remove(&source->link);
+	source->func.idle(source->data);
+	record(source->profile, start);
+	free(source);
+}
+
+static struct source *
+new_source(const char *name, void *data)
+{
+	struct source *source;
+
+	if (!(source = malloc(sizeof(*source))))
+		goto error0;
+	if (!(source->profile = get_profile(name)))
+		goto error1;
+	source->data = data;
+
+	return source;
+
+error1:
+	free(source);
+error0:
+	return NULL;
+}
+
+static struct wl_event_source *
+add_source(struct source *source)
+{
+	if (!source->source) {
+		free(source);
+		return NULL;
+	}
+	wl_list_insert(&dispatch.sources, &source->link);
+
+	return source->source;
+}
+
+struct wl_event_source *
+dispatch_add_fd(const char *name, int fd, uint32_t mask, wl_event_loop_fd_func_t func, void *data)
+{
+	struct source *source;
+
+	if (!(source = new_source(name, data)))
+		return NULL;
+	source->func.fd = func;
+	source->source = wl_event_loop_add_fd(swc.event_loop, fd, mask, &dispatch_fd, source);
+
+	return add_source(source);
+}
+
+struct wl_event_source *
+dispatch_add_timer(const char *name, wl_event_loop_timer_func_t func, void *data)
+{
+	struct source *source;
+
+	if (!(source = new_source(name, data)))
+		return NULL;
+	source->func.timer = func;
+	source->source = wl_event_loop_add_timer(swc.event_loop, &dispatch_timer, source);
+
+	return add_source(source);
+}
+
+struct wl_event_source *
+dispatch_add_signal(const char *name, int signal, wl_event_loop_signal_func_t func, void *data)
+{
+	struct source *source;
+
+	if (!(source = new_source(name, data)))
+		return NULL;
+	source->func.signal = func;
+	source->source = wl_event_loop_add_signal(swc.event_loop, signal, &dispatch_signal, source);
+
+	return add_source(source);
+}
+
+struct wl_event_source *
+dispatch_add_idle(const char *name, wl_event_loop_idle_func_t func, void *data)
+{
+	struct source *source;
+
+	if (!(source = new_source(name, data)))
+		return NULL;
+	source->func.idle = func;
+	source->source = wl_event_loop_add_idle(swc.event_loop, &dispatch_idle, source);
+
+	return add_source(source);
+}
+
+void
+dispatch_remove(struct wl_event_source *event_source)
+{
+	struct source *source;
+
+	/* Sources not on the list were already removed by dispatch_finalize. */
+	wl_list_for_each (source, &dispatch.sources, link) {
+		if (source->source == event_source) {
+			wl_list_remove(&source->link);
+			free(source);
+			wl_event_source_remove(event_source);
+			break;
+		}
+	}
+}
+
+EXPORT void
+swc_dispatch_dump(int fd)
+{
+	struct profile *profile;
+	unsigned bucket;
+
+	dprintf(fd, "%-16s %10s %12s %10s  %s\n", "source", "dispatches", "total (ms)", "max (ms)",
+	        "histogram (<2us, <4us, ..., <32ms, more)");
+	wl_list_for_each (profile, &dispatch.profiles, link) {
+		dprintf(fd, "%-16s %10" PRIu64 " %12.3f %10.3f ", profile->name, profile->dispatches,
+		        profile->total_time / 1e6, profile->max_time / 1e6);
+		for (bucket = 0; bucket < NUM_BUCKETS; ++bucket)
+			dprintf(fd, " %" PRIu64, profile->buckets[bucket]);
+		dprintf(fd, "\n");
+	}
+}
+
+void
+dispatch_initialize(void)
+{
+	const char *threshold;
+
+	wl_list_init(&dispatch.profiles);
+	wl_list_init(&dispatch.sources);
+	dispatch.threshold = 16000000;
+	if ((threshold = getenv("SWC_DISPATCH_WARN")))
+		dispatch.threshold = strtoull(threshold, NULL, 10) * 1000000;
+}
+
+void
+dispatch_finalize(void)
+{
+	struct source *source, *next_source;
+	struct profile *profile, *next_profile;
+
+	/* Any sources left are idle sources that were never dispatched, or
+	 * belong to objects that outlive swc_finalize. */
+	wl_list_for_each_safe (source, next_source, &dispatch.sources, link) {
+		wl_event_source_remove(source->source);
+		free(source);
+	}
+	wl_list_init(&dispatch.sources);
+	wl_list_for_each_safe (profile, next_profile, &dispatch.profiles, link)
+		free(profile);
+	wl_list_init(&dispatch.profiles);
+}
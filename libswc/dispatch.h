@@ -0,0 +1,52 @@
+/* swc: libswc/dispatch.h
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SWC_DISPATCH_H
+#define SWC_DISPATCH_H
+
+#include <wayland-server.h>
+
+/* Event sources added through these functions are profiled. The number of
+ * dispatches, and the total, longest and distribution of the time spent in
+ * them, are kept by source name, so sources sharing a name are counted
+ * together. Dispatches longer than SWC_DISPATCH_WARN milliseconds (16 by
+ * default, or never if 0) are reported as warnings.
+ *
+ * The name must be a string literal, or otherwise outlive the source. */
+
+struct wl_event_source *dispatch_add_fd(const char *name, int fd, uint32_t mask, wl_event_loop_fd_func_t func, void *data);
+struct wl_event_source *dispatch_add_timer(const char *name, wl_event_loop_timer_func_t func, void *data);
+struct wl_event_source *dispatch_add_signal(const char *name, int signal, wl_event_loop_signal_func_t func, void *data);
+struct wl_event_source *dispatch_add_idle(const char *name, wl_event_loop_idle_func_t func, void *data);
+
+/**
+ * Remove a source added with one of the functions above, other than an idle
+ * source that has already been dispatched.
+ */
+void dispatch_remove(struct wl_event_source *source);
+
+void dispatch_initialize(void);
+void dispatch_finalize(void);
+
+#endif
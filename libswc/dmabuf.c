@@ -24,17 +24,34 @@
 #include "dmabuf.h"
 #include "drm.h"
 #include "internal.h"
+#include "plane.h"
+#include "screen.h"
+#include "stats.h"
+#include "surface.h"
 #include "util.h"
 #include "wayland_buffer.h"
 
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <drm_fourcc.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <wld/wld.h>
 #include <wld/drm.h>
+#ifdef __linux__
+# include <linux/dma-buf.h>
+#endif
 #include "linux-dmabuf-unstable-v1-server-protocol.h"
 
+enum {
+	/* WLD_USER_ID is used by drm.c for framebuffers. */
+	WLD_USER_OBJECT_DMABUF = WLD_USER_ID + 1
+};
+
 struct params {
 	struct wl_resource *resource;
 	int fd[4];
@@ -44,6 +61,111 @@ struct params {
 	bool created;
 };
 
+struct feedback {
+	struct wl_resource *resource;
+	struct surface *surface;
+	/* The plane whose formats were last sent in the scanout tranche. */
+	struct plane *plane;
+	struct wl_listener surface_destroy_listener;
+	struct wl_list link;
+};
+
+struct format_table_entry {
+	uint32_t format;
+	uint32_t pad;
+	uint64_t modifier;
+};
+
+static struct {
+	struct wl_array entries;
+	int fd;
+	dev_t device;
+} format_table = {.fd = -1};
+
+static struct wl_list feedbacks = {&feedbacks, &feedbacks};
+
+struct dmabuf_buffer {
+	struct wld_exporter exporter;
+	struct wld_destructor destructor;
+	struct dmabuf_attributes attributes;
+	struct stats_charge charge;
+};
+
+static const struct {
+	uint32_t format;
+	int num_planes;
+} formats[] = {
+	{DRM_FORMAT_XRGB8888, 1},
+	{DRM_FORMAT_ARGB8888, 1},
+	{DRM_FORMAT_NV12, 2},
+	{DRM_FORMAT_P010, 2},
+	{DRM_FORMAT_YUV420, 3},
+};
+
+static int
+format_num_planes(uint32_t format)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_LENGTH(formats); ++i) {
+		if (formats[i].format == format)
+			return formats[i].num_planes;
+	}
+	return 0;
+}
+
+bool
+dmabuf_format_is_yuv(uint32_t format)
+{
+	switch (format) {
+	case DRM_FORMAT_NV12:
+	case DRM_FORMAT_P010:
+	case DRM_FORMAT_YUV420:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool
+dmabuf_export(struct wld_exporter *exporter, struct wld_buffer *buffer, uint32_t type, union wld_object *object)
+{
+	struct dmabuf_buffer *dmabuf = wl_container_of(exporter, dmabuf, exporter);
+
+	switch (type) {
+	case WLD_USER_OBJECT_DMABUF:
+		object->ptr = &dmabuf->attributes;
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+static void
+dmabuf_destroy(struct wld_destructor *destructor)
+{
+	struct dmabuf_buffer *dmabuf = wl_container_of(destructor, dmabuf, destructor);
+	int i;
+
+	for (i = 0; i < dmabuf->attributes.num_planes; ++i)
+		close(dmabuf->attributes.fd[i]);
+	stats_uncharge(&dmabuf->charge);
+	free(dmabuf);
+}
+
+const struct dmabuf_attributes *
+dmabuf_get_attributes(struct wld_buffer *buffer)
+{
+	union wld_object object;
+
+	if (!wld_export(buffer, WLD_USER_OBJECT_DMABUF, &object))
+		return NULL;
+
+	return object.ptr;
+}
+
 static void
 add(struct wl_client *client, struct wl_resource *resource, int32_t fd, uint32_t i, uint32_t offset, uint32_t stride, uint32_t modifier_hi, uint32_t modifier_lo)
 {
@@ -51,14 +173,17 @@ add(struct wl_client *client, struct wl_resource *resource, int32_t fd, uint32_t
 
 	if (params->created) {
 		wl_resource_post_error(resource, ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_ALREADY_USED, "buffer already created");
+		close(fd);
 		return;
 	}
-	if (i > ARRAY_LENGTH(params->fd)) {
+	if (i >= ARRAY_LENGTH(params->fd)) {
 		wl_resource_post_error(resource, ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_PLANE_IDX, "plane index too large");
+		close(fd);
 		return;
 	}
 	if (params->fd[i] != -1) {
 		wl_resource_post_error(resource, ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_PLANE_SET, "buffer plane already set");
+		close(fd);
 		return;
 	}
 	params->fd[i] = fd;
@@ -72,50 +197,97 @@ create_immed(struct wl_client *client, struct wl_resource *resource, uint32_t id
              int32_t width, int32_t height, uint32_t format, uint32_t flags)
 {
 	struct params *params = wl_resource_get_user_data(resource);
+	struct dmabuf_buffer *dmabuf;
 	struct wld_buffer *buffer;
 	struct wl_resource *buffer_resource;
 	union wld_object object;
 	int num_planes, i;
+	off_t size;
 
 	if (params->created) {
 		wl_resource_post_error(resource, ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_ALREADY_USED, "buffer already created");
 		return;
 	}
 	params->created = true;
-	switch (format) {
-	case DRM_FORMAT_XRGB8888:
-	case DRM_FORMAT_ARGB8888:
-		num_planes = 1;
-		break;
-	default:
+	num_planes = format_num_planes(format);
+	if (num_planes == 0) {
 		wl_resource_post_error(resource, ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INVALID_FORMAT, "unsupported format %#" PRIx32, format);
 		return;
 	}
 	for (i = 0; i < num_planes; ++i) {
-		if (params->fd[i] == -1)
+		if (params->fd[i] == -1) {
 			wl_resource_post_error(resource, ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INCOMPLETE, "missing plane %d", i);
+			return;
+		}
 	}
 	for (; i < ARRAY_LENGTH(params->fd); ++i) {
-		if (params->fd[i] != -1)
+		if (params->fd[i] != -1) {
 			wl_resource_post_error(resource, ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INCOMPLETE, "too many planes");
+			return;
+		}
+	}
+	for (i = 1; i < num_planes; ++i) {
+		if (params->modifier[i] != params->modifier[0]) {
+			wl_resource_post_error(resource, ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INVALID_FORMAT, "plane modifiers do not match");
+			return;
+		}
+	}
+	if (!drm_supports_modifier(format, params->modifier[0])) {
+		wl_resource_post_error(resource, ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INVALID_FORMAT, "unsupported modifier %#" PRIx64, params->modifier[0]);
+		return;
+	}
+	if (width <= 0 || height <= 0) {
+		wl_resource_post_error(resource, ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INVALID_DIMENSIONS, "invalid dimensions %" PRId32 "x%" PRId32, width, height);
+		return;
+	}
+	if (!(dmabuf = malloc(sizeof(*dmabuf)))) {
+		wl_resource_post_no_memory(resource);
+		return;
 	}
+	/* The size of a dmabuf can be found by seeking to its end. */
+	size = lseek(params->fd[0], 0, SEEK_END);
+	if (size > 0)
+		lseek(params->fd[0], 0, SEEK_SET);
+	else
+		size = (off_t)params->stride[0] * height;
+	if (!stats_charge(&dmabuf->charge, client, STATS_DMABUF, size)) {
+		free(dmabuf);
+		wl_resource_post_no_memory(resource);
+		return;
+	}
+	/* wld only knows about the first plane, so the rest of the planes are
+	 * tracked alongside the buffer. */
 	object.i = params->fd[0];
 	buffer = wld_import_buffer(swc.drm->context, WLD_DRM_OBJECT_PRIME_FD, object, width, height, format, params->stride[0]);
+	if (!buffer) {
+		stats_uncharge(&dmabuf->charge);
+		free(dmabuf);
+		if (id == 0)
+			zwp_linux_buffer_params_v1_send_failed(resource);
+		else
+			wl_resource_post_error(resource, ZWP_LINUX_BUFFER_PARAMS_V1_ERROR_INVALID_WL_BUFFER, "could not import buffer");
+		return;
+	}
+	dmabuf->attributes.num_planes = num_planes;
+	dmabuf->attributes.modifier = params->modifier[0];
 	for (i = 0; i < num_planes; ++i) {
-		close(params->fd[i]);
+		dmabuf->attributes.fd[i] = params->fd[i];
+		dmabuf->attributes.offset[i] = params->offset[i];
+		dmabuf->attributes.stride[i] = params->stride[i];
 		params->fd[i] = -1;
 	}
-	if (!buffer)
-		zwp_linux_buffer_params_v1_send_failed(resource);
+	dmabuf->exporter.export = &dmabuf_export;
+	wld_buffer_add_exporter(buffer, &dmabuf->exporter);
+	dmabuf->destructor.destroy = &dmabuf_destroy;
+	wld_buffer_add_destructor(buffer, &dmabuf->destructor);
 
 	buffer_resource = wayland_buffer_create_resource(client, 1, id, buffer);
 	if (!buffer_resource) {
-		if (buffer)
-			wld_buffer_unreference(buffer);
+		wld_buffer_unreference(buffer);
 		wl_resource_post_no_memory(resource);
 		return;
 	}
-	if (id == 0 && buffer)
+	if (id == 0)
 		zwp_linux_buffer_params_v1_send_created(resource, buffer_resource);
 }
 
@@ -139,8 +311,11 @@ params_destroy(struct wl_resource *resource)
 	struct params *params = wl_resource_get_user_data(resource);
 	int i;
 
-	for (i = 0; i < ARRAY_LENGTH(params->fd); ++i)
-		close(params->fd[i]);
+	for (i = 0; i < ARRAY_LENGTH(params->fd); ++i) {
+		if (params->fd[i] != -1)
+			close(params->fd[i]);
+	}
+	free(params);
 }
 
 static void
@@ -167,20 +342,230 @@ error0:
 	wl_resource_post_no_memory(resource);
 }
 
+static bool
+add_table_entry(uint32_t format, uint64_t modifier)
+{
+	struct format_table_entry *entry;
+
+	if (!(entry = wl_array_add(&format_table.entries, sizeof(*entry))))
+		return false;
+	entry->format = format;
+	entry->pad = 0;
+	entry->modifier = modifier;
+	return true;
+}
+
+/* The table is built on first use since the modifiers are only known once the
+ * screens have been created. */
+static bool
+create_format_table(void)
+{
+	struct wl_array modifiers;
+	struct stat st;
+	uint64_t *modifier;
+	size_t i;
+	int fd;
+
+	if (format_table.fd != -1)
+		return true;
+	if (fstat(swc.drm->fd, &st) < 0)
+		goto error0;
+	format_table.device = st.st_rdev;
+	wl_array_init(&format_table.entries);
+	for (i = 0; i < ARRAY_LENGTH(formats); ++i) {
+		if (!add_table_entry(formats[i].format, DRM_FORMAT_MOD_INVALID))
+			goto error1;
+		wl_array_init(&modifiers);
+		if (!drm_get_modifiers(formats[i].format, &modifiers)) {
+			wl_array_release(&modifiers);
+			goto error1;
+		}
+		wl_array_for_each (modifier, &modifiers) {
+			if (!add_table_entry(formats[i].format, *modifier)) {
+				wl_array_release(&modifiers);
+				goto error1;
+			}
+		}
+		wl_array_release(&modifiers);
+	}
+
+	fd = memfd_create("swc-dmabuf-formats", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0)
+		goto error1;
+	if (write(fd, format_table.entries.data, format_table.entries.size) != (ssize_t)format_table.entries.size)
+		goto error2;
+	/* Clients map the table themselves, so make sure it can't change. */
+	fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+	format_table.fd = fd;
+
+	return true;
+
+error2:
+	close(fd);
+error1:
+	wl_array_release(&format_table.entries);
+error0:
+	ERROR("Could not create dmabuf format table\n");
+	return false;
+}
+
+static struct plane *
+scanout_plane(struct surface *surface)
+{
+	struct screen *screen;
+
+	if (!surface || !surface->view)
+		return NULL;
+	wl_list_for_each (screen, &swc.screens, link) {
+		if (surface->view->screens == screen_mask(screen))
+			return screen->planes.overlay;
+	}
+	return NULL;
+}
+
+static void
+send_tranche(struct wl_resource *resource, struct wl_array *device, struct wl_array *indices, uint32_t flags)
+{
+	zwp_linux_dmabuf_feedback_v1_send_tranche_target_device(resource, device);
+	zwp_linux_dmabuf_feedback_v1_send_tranche_formats(resource, indices);
+	zwp_linux_dmabuf_feedback_v1_send_tranche_flags(resource, flags);
+	zwp_linux_dmabuf_feedback_v1_send_tranche_done(resource);
+}
+
+static void
+send_feedback(struct feedback *feedback)
+{
+	struct format_table_entry *entry;
+	struct wl_array device, scanout, all;
+	dev_t *dev;
+	uint16_t i, *index;
+
+	wl_array_init(&device);
+	wl_array_init(&scanout);
+	wl_array_init(&all);
+	if (!(dev = wl_array_add(&device, sizeof(*dev))))
+		goto error;
+	*dev = format_table.device;
+
+	feedback->plane = scanout_plane(feedback->surface);
+	i = 0;
+	wl_array_for_each (entry, &format_table.entries) {
+		if (feedback->plane && plane_supports_modifier(feedback->plane, entry->format, entry->modifier)) {
+			if (!(index = wl_array_add(&scanout, sizeof(*index))))
+				goto error;
+			*index = i;
+		}
+		if (!(index = wl_array_add(&all, sizeof(*index))))
+			goto error;
+		*index = i++;
+	}
+
+	zwp_linux_dmabuf_feedback_v1_send_format_table(feedback->resource, format_table.fd, format_table.entries.size);
+	zwp_linux_dmabuf_feedback_v1_send_main_device(feedback->resource, &device);
+	/* Buffers in the preferred tranche can be put directly on the plane the
+	 * surface would be scanned out on. */
+	if (scanout.size > 0)
+		send_tranche(feedback->resource, &device, &scanout, ZWP_LINUX_DMABUF_FEEDBACK_V1_TRANCHE_FLAGS_SCANOUT);
+	send_tranche(feedback->resource, &device, &all, 0);
+	zwp_linux_dmabuf_feedback_v1_send_done(feedback->resource);
+	goto done;
+
+error:
+	wl_resource_post_no_memory(feedback->resource);
+done:
+	wl_array_release(&device);
+	wl_array_release(&scanout);
+	wl_array_release(&all);
+}
+
+static const struct zwp_linux_dmabuf_feedback_v1_interface feedback_impl = {
+	.destroy = destroy_resource,
+};
+
+static void
+handle_surface_destroy(struct wl_listener *listener, void *data)
+{
+	struct feedback *feedback = wl_container_of(listener, feedback, surface_destroy_listener);
+
+	wl_list_remove(&feedback->surface_destroy_listener.link);
+	feedback->surface = NULL;
+}
+
+static void
+feedback_destroy(struct wl_resource *resource)
+{
+	struct feedback *feedback = wl_resource_get_user_data(resource);
+
+	if (feedback->surface)
+		wl_list_remove(&feedback->surface_destroy_listener.link);
+	wl_list_remove(&feedback->link);
+	free(feedback);
+}
+
+static void
+create_feedback(struct wl_client *client, struct wl_resource *resource, uint32_t id, struct surface *surface)
+{
+	struct feedback *feedback;
+
+	if (!create_format_table())
+		goto error0;
+	if (!(feedback = malloc(sizeof(*feedback))))
+		goto error0;
+	feedback->resource = wl_resource_create(client, &zwp_linux_dmabuf_feedback_v1_interface, wl_resource_get_version(resource), id);
+	if (!feedback->resource)
+		goto error1;
+	wl_resource_set_implementation(feedback->resource, &feedback_impl, feedback, &feedback_destroy);
+	feedback->surface = surface;
+	if (surface) {
+		feedback->surface_destroy_listener.notify = &handle_surface_destroy;
+		wl_resource_add_destroy_listener(surface->resource, &feedback->surface_destroy_listener);
+	}
+	wl_list_insert(&feedbacks, &feedback->link);
+	send_feedback(feedback);
+	return;
+
+error1:
+	free(feedback);
+error0:
+	wl_resource_post_no_memory(resource);
+}
+
+static void
+get_default_feedback(struct wl_client *client, struct wl_resource *resource, uint32_t id)
+{
+	create_feedback(client, resource, id, NULL);
+}
+
+static void
+get_surface_feedback(struct wl_client *client, struct wl_resource *resource, uint32_t id, struct wl_resource *surface_resource)
+{
+	create_feedback(client, resource, id, wl_resource_get_user_data(surface_resource));
+}
+
+void
+dmabuf_update_surface_feedback(struct surface *surface)
+{
+	struct feedback *feedback;
+
+	wl_list_for_each (feedback, &feedbacks, link) {
+		if (feedback->surface == surface && feedback->plane != scanout_plane(surface))
+			send_feedback(feedback);
+	}
+}
+
 static const struct zwp_linux_dmabuf_v1_interface dmabuf_impl = {
 	.destroy = destroy_resource,
 	.create_params = create_params,
+	.get_default_feedback = get_default_feedback,
+	.get_surface_feedback = get_surface_feedback,
 };
 
 static void
 bind_dmabuf(struct wl_client *client, void *data, uint32_t version, uint32_t id)
 {
-	static const uint32_t formats[] = {
-		DRM_FORMAT_XRGB8888,
-		DRM_FORMAT_ARGB8888,
-	};
-	uint64_t modifier = DRM_FORMAT_MOD_INVALID;
 	struct wl_resource *resource;
+	struct wl_array modifiers;
+	uint64_t *modifier;
 	size_t i;
 
 	resource = wl_resource_create(client, &zwp_linux_dmabuf_v1_interface, version, id);
@@ -189,18 +574,144 @@ bind_dmabuf(struct wl_client *client, void *data, uint32_t version, uint32_t id)
 		return;
 	}
 	wl_resource_set_implementation(resource, &dmabuf_impl, NULL, NULL);
+	/* Version 4 clients get formats through feedback objects instead. */
+	if (version >= 4)
+		return;
 	for (i = 0; i < ARRAY_LENGTH(formats); ++i) {
-		if (version >= 3) {
-			/* TODO: need a way to query DRM modifiers of wld */
-			zwp_linux_dmabuf_v1_send_modifier(resource, formats[i], modifier >> 32, modifier & 0xffffffff);
-		} else {
-			zwp_linux_dmabuf_v1_send_format(resource, formats[i]);
+		if (version < 3) {
+			zwp_linux_dmabuf_v1_send_format(resource, formats[i].format);
+			continue;
+		}
+		/* Implicit modifiers are always accepted. */
+		zwp_linux_dmabuf_v1_send_modifier(resource, formats[i].format, DRM_FORMAT_MOD_INVALID >> 32, DRM_FORMAT_MOD_INVALID & 0xffffffff);
+		wl_array_init(&modifiers);
+		if (drm_get_modifiers(formats[i].format, &modifiers)) {
+			wl_array_for_each (modifier, &modifiers)
+				zwp_linux_dmabuf_v1_send_modifier(resource, formats[i].format, *modifier >> 32, *modifier & 0xffffffff);
+		}
+		wl_array_release(&modifiers);
+	}
+}
+
+/* YUV conversion {{{ */
+
+static inline uint8_t
+clamp_component(int value)
+{
+	return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+/* BT.601, limited range */
+static inline uint32_t
+yuv_to_xrgb(int y, int u, int v)
+{
+	int c = 298 * (y - 16) + 128, d = u - 128, e = v - 128;
+
+	return 0xff000000
+	     | clamp_component((c + 409 * e) >> 8) << 16
+	     | clamp_component((c - 100 * d - 208 * e) >> 8) << 8
+	     | clamp_component((c + 516 * d) >> 8);
+}
+
+static void
+convert_row(uint32_t format, const uint8_t *const *plane, const uint32_t *stride, int32_t y, int32_t x1, int32_t x2, uint32_t *dst)
+{
+	const uint8_t *luma = plane[0] + y * stride[0];
+	const uint8_t *chroma = plane[1] + y / 2 * stride[1];
+	int32_t x;
+
+	switch (format) {
+	case DRM_FORMAT_NV12:
+		for (x = x1; x < x2; ++x)
+			dst[x] = yuv_to_xrgb(luma[x], chroma[x & ~1], chroma[x | 1]);
+		break;
+	case DRM_FORMAT_P010:
+		/* The samples are stored in the high 10 bits of each 16-bit word, so we
+		 * just use the top 8. */
+		for (x = x1; x < x2; ++x)
+			dst[x] = yuv_to_xrgb(luma[2 * x + 1], chroma[2 * (x & ~1) + 1], chroma[2 * (x | 1) + 1]);
+		break;
+	case DRM_FORMAT_YUV420: {
+		const uint8_t *cr = plane[2] + y / 2 * stride[2];
+
+		for (x = x1; x < x2; ++x)
+			dst[x] = yuv_to_xrgb(luma[x], chroma[x / 2], cr[x / 2]);
+		break;
+	}
+	}
+}
+
+static void
+sync_plane(int fd, bool start)
+{
+#ifdef DMA_BUF_IOCTL_SYNC
+	struct dma_buf_sync sync = {
+		.flags = DMA_BUF_SYNC_READ | (start ? DMA_BUF_SYNC_START : DMA_BUF_SYNC_END),
+	};
+
+	ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+#endif
+}
+
+bool
+dmabuf_convert(struct wld_buffer *dst, struct wld_buffer *src, pixman_region32_t *region)
+{
+	const struct dmabuf_attributes *attributes;
+	const uint8_t *plane[4];
+	void *map[4];
+	size_t size[4];
+	pixman_box32_t *boxes, box;
+	int num_boxes, i, j;
+	int32_t y;
+	bool ret = false;
+
+	if (!(attributes = dmabuf_get_attributes(src)) || !dmabuf_format_is_yuv(src->format))
+		return false;
+	if (attributes->modifier != DRM_FORMAT_MOD_INVALID && attributes->modifier != DRM_FORMAT_MOD_LINEAR)
+		return false;
+
+	for (i = 0; i < attributes->num_planes; ++i) {
+		/* All of the supported formats are subsampled vertically by 2. */
+		size[i] = attributes->offset[i] + (size_t)attributes->stride[i] * (i == 0 ? src->height : (src->height + 1) / 2);
+		map[i] = mmap(NULL, size[i], PROT_READ, MAP_SHARED, attributes->fd[i], 0);
+		if (map[i] == MAP_FAILED) {
+			WARNING("Could not map dmabuf plane %d\n", i);
+			goto unmap;
 		}
+		sync_plane(attributes->fd[i], true);
+		plane[i] = (const uint8_t *)map[i] + attributes->offset[i];
+	}
+
+	if (!wld_map(dst))
+		goto unmap;
+
+	boxes = pixman_region32_rectangles(region, &num_boxes);
+	for (j = 0; j < num_boxes; ++j) {
+		box.x1 = MAX(boxes[j].x1, 0);
+		box.y1 = MAX(boxes[j].y1, 0);
+		box.x2 = MIN(boxes[j].x2, (int32_t)MIN(src->width, dst->width));
+		box.y2 = MIN(boxes[j].y2, (int32_t)MIN(src->height, dst->height));
+
+		for (y = box.y1; y < box.y2; ++y)
+			convert_row(src->format, plane, attributes->stride, y, box.x1, box.x2, (uint32_t *)((uint8_t *)dst->map + y * dst->pitch));
+	}
+
+	wld_unmap(dst);
+	ret = true;
+
+unmap:
+	while (i-- > 0) {
+		sync_plane(attributes->fd[i], false);
+		munmap(map[i], size[i]);
 	}
+
+	return ret;
 }
 
+/* }}} */
+
 struct wl_global *
 swc_dmabuf_create(struct wl_display *display)
 {
-	return wl_global_create(display, &zwp_linux_dmabuf_v1_interface, 3, NULL, &bind_dmabuf);
+	return wl_global_create(display, &zwp_linux_dmabuf_v1_interface, 4, NULL, &bind_dmabuf);
 }
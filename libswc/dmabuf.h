@@ -24,8 +24,46 @@
 #ifndef SWC_DMABUF_H
 #define SWC_DMABUF_H
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <pixman.h>
+
+struct surface;
 struct wl_display;
+struct wld_buffer;
+
+struct dmabuf_attributes {
+	int num_planes;
+	int fd[4];
+	uint32_t offset[4];
+	uint32_t stride[4];
+	uint64_t modifier;
+};
 
 struct wl_global *swc_dmabuf_create(struct wl_display *display);
 
+/**
+ * Resend the feedback for a surface if the plane it could be scanned out on
+ * has changed.
+ */
+void dmabuf_update_surface_feedback(struct surface *surface);
+
+/**
+ * Returns the attributes a buffer was imported with, or NULL if the buffer
+ * was not created through linux-dmabuf.
+ */
+const struct dmabuf_attributes *dmabuf_get_attributes(struct wld_buffer *buffer);
+
+/**
+ * Whether format is one of the YUV formats that the renderer can not read
+ * directly.
+ */
+bool dmabuf_format_is_yuv(uint32_t format);
+
+/**
+ * Convert a region of a YUV dmabuf to RGB, writing the result to a mappable
+ * XRGB8888 buffer of the same size.
+ */
+bool dmabuf_convert(struct wld_buffer *dst, struct wld_buffer *src, pixman_region32_t *region);
+
 #endif
@@ -22,6 +22,7 @@
  */
 
 #include "drm.h"
+#include "dispatch.h"
 #include "dmabuf.h"
 #include "event.h"
 #include "internal.h"
@@ -29,6 +30,7 @@
 #include "output.h"
 #include "plane.h"
 #include "screen.h"
+#include "trace.h"
 #include "util.h"
 #include "wayland_buffer.h"
 
@@ -40,8 +42,10 @@
 #include <string.h>
 #include <strings.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <unistd.h>
 #include <drm.h>
+#include <drm_fourcc.h>
 #include <xf86drm.h>
 #include <wld/wld.h>
 #include <wld/drm.h>
@@ -56,8 +60,22 @@ static struct {
 	struct wl_global *global;
 	struct wl_global *dmabuf;
 	struct wl_event_source *event_source;
+
+	/* Whether framebuffers can be created with explicit modifiers. */
+	bool fb_modifiers;
+	/* Format/modifier pairs usable for client buffers, other than linear. */
+	struct wl_array modifiers;
 } drm;
 
+/* Modifiers that wld's renderer can read, by kernel driver. Compressed
+ * layouts can be added here once wld knows how to sample them. */
+static const struct {
+	const char *driver;
+	uint64_t modifier;
+} render_modifiers[] = {
+	{"i915", I915_FORMAT_MOD_X_TILED},
+};
+
 static void
 authenticate(struct wl_client *client, struct wl_resource *resource, uint32_t magic)
 {
@@ -205,13 +223,26 @@ handle_page_flip(int fd, unsigned int sequence, unsigned int sec, unsigned int u
 {
 	struct drm_handler *handler = data;
 
+	TRACE_BEGIN("page_flip");
 	handler->page_flip(handler, sec * 1000 + usec / 1000);
+	TRACE_END();
+}
+
+static void
+handle_sequence(int fd, uint64_t sequence, uint64_t ns, uint64_t user_data)
+{
+	struct drm_handler *handler = (void *)(uintptr_t)user_data;
+
+	TRACE_BEGIN("vblank");
+	handler->vblank(handler, ns / 1000000);
+	TRACE_END();
 }
 
 static drmEventContext event_context = {
 	.version = DRM_EVENT_CONTEXT_VERSION,
 	.vblank_handler = handle_vblank,
 	.page_flip_handler2 = handle_page_flip,
+	.sequence_handler = handle_sequence,
 };
 
 static int
@@ -267,6 +298,8 @@ drm_initialize(void)
 	if (drmGetCap(swc.drm->fd, DRM_CAP_CURSOR_HEIGHT, &val) < 0)
 		val = 64;
 	swc.drm->cursor_h = val;
+	drm.fb_modifiers = drmGetCap(swc.drm->fd, DRM_CAP_ADDFB2_MODIFIERS, &val) == 0 && val;
+	wl_array_init(&drm.modifiers);
 
 	drm.path = drmGetRenderDeviceNameFromFd(swc.drm->fd);
 	if (!drm.path) {
@@ -284,7 +317,7 @@ drm_initialize(void)
 		goto error2;
 	}
 
-	drm.event_source = wl_event_loop_add_fd(swc.event_loop, swc.drm->fd, WL_EVENT_READABLE, &handle_data, NULL);
+	drm.event_source = dispatch_add_fd("drm", swc.drm->fd, WL_EVENT_READABLE, &handle_data, NULL);
 
 	if (!drm.event_source) {
 		ERROR("Could not create DRM event source\n");
@@ -307,7 +340,7 @@ drm_initialize(void)
 	return true;
 
 error4:
-	wl_event_source_remove(drm.event_source);
+	dispatch_remove(drm.event_source);
 error3:
 	wld_destroy_renderer(swc.drm->renderer);
 error2:
@@ -323,20 +356,98 @@ drm_finalize(void)
 {
 	if (drm.global)
 		wl_global_destroy(drm.global);
-	wl_event_source_remove(drm.event_source);
+	dispatch_remove(drm.event_source);
 	wld_destroy_renderer(swc.drm->renderer);
 	wld_destroy_context(swc.drm->context);
 	free(drm.path);
+	wl_array_release(&drm.modifiers);
 	close(swc.drm->fd);
 }
 
+static bool
+can_render_modifier(const char *driver, uint64_t modifier)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_LENGTH(render_modifiers); ++i) {
+		if (strcmp(render_modifiers[i].driver, driver) == 0 && render_modifiers[i].modifier == modifier)
+			return true;
+	}
+	return false;
+}
+
+/* Collects the modifiers that both some plane can scan out and the renderer
+ * can read. */
+static void
+find_modifiers(struct wl_list *planes)
+{
+	drmVersion *version;
+	struct plane *plane;
+	struct plane_modifier *entry, *modifier;
+
+	if (!drm.fb_modifiers || !(version = drmGetVersion(swc.drm->fd)))
+		return;
+	wl_list_for_each (plane, planes, link) {
+		if (plane->type == DRM_PLANE_TYPE_CURSOR)
+			continue;
+		wl_array_for_each (entry, &plane->modifiers) {
+			/* YUV buffers that can't be scanned out are converted on the CPU,
+			 * which only understands linear layouts. */
+			if (dmabuf_format_is_yuv(entry->format)
+			 || !can_render_modifier(version->name, entry->modifier)
+			 || drm_supports_modifier(entry->format, entry->modifier))
+				continue;
+			if (!(modifier = wl_array_add(&drm.modifiers, sizeof(*modifier))))
+				goto done;
+			*modifier = *entry;
+			DEBUG("Using modifier %#" PRIx64 " for format %#" PRIx32 "\n", entry->modifier, entry->format);
+		}
+	}
+
+done:
+	drmFreeVersion(version);
+}
+
+bool
+drm_supports_modifier(uint32_t format, uint64_t modifier)
+{
+	struct plane_modifier *entry;
+
+	if (modifier == DRM_FORMAT_MOD_INVALID || modifier == DRM_FORMAT_MOD_LINEAR)
+		return true;
+	wl_array_for_each (entry, &drm.modifiers) {
+		if (entry->format == format && entry->modifier == modifier)
+			return true;
+	}
+	return false;
+}
+
+bool
+drm_get_modifiers(uint32_t format, struct wl_array *modifiers)
+{
+	struct plane_modifier *entry;
+	uint64_t *modifier;
+
+	if (!(modifier = wl_array_add(modifiers, sizeof(*modifier))))
+		return false;
+	*modifier = DRM_FORMAT_MOD_LINEAR;
+	wl_array_for_each (entry, &drm.modifiers) {
+		if (entry->format != format)
+			continue;
+		if (!(modifier = wl_array_add(modifiers, sizeof(*modifier))))
+			return false;
+		*modifier = entry->modifier;
+	}
+	return true;
+}
+
 bool
 drm_create_screens(struct wl_list *screens)
 {
 	drmModePlaneRes *plane_ids;
 	drmModeRes *resources;
 	drmModeConnector *connector;
-	struct plane *plane, *cursor_plane;
+	struct plane *plane, *tmp, *primary_plane, *cursor_plane, *overlay_plane;
 	struct output *output;
 	uint32_t i, taken_crtcs = 0;
 	struct wl_list planes;
@@ -353,6 +464,7 @@ drm_create_screens(struct wl_list *screens)
 			wl_list_insert(&planes, &plane->link);
 	}
 	drmModeFreePlaneResources(plane_ids);
+	find_modifiers(&planes);
 
 	resources = drmModeGetResources(swc.drm->fd);
 	if (!resources) {
@@ -370,6 +482,16 @@ drm_create_screens(struct wl_list *screens)
 				continue;
 			}
 
+			/* The primary plane is driven through the CRTC, we only need to know
+			 * which formats it supports. */
+			primary_plane = NULL;
+			wl_list_for_each (plane, &planes, link) {
+				if (plane->type == DRM_PLANE_TYPE_PRIMARY && plane->possible_crtcs & 1 << crtc_index) {
+					primary_plane = plane;
+					break;
+				}
+			}
+
 			cursor_plane = NULL;
 			wl_list_for_each (plane, &planes, link) {
 				if (plane->type == DRM_PLANE_TYPE_CURSOR && plane->possible_crtcs & 1 << crtc_index) {
@@ -382,10 +504,26 @@ drm_create_screens(struct wl_list *screens)
 				WARNING("Could not find cursor plane for CRTC %d\n", crtc_index);
 			}
 
+			/* Prefer an overlay plane that can scan out YUV buffers so that video
+			 * does not need to be converted by the renderer. */
+			overlay_plane = NULL;
+			wl_list_for_each (plane, &planes, link) {
+				if (plane->type != DRM_PLANE_TYPE_OVERLAY || !(plane->possible_crtcs & 1 << crtc_index))
+					continue;
+				if (!overlay_plane)
+					overlay_plane = plane;
+				if (plane_supports_format(plane, DRM_FORMAT_NV12)) {
+					overlay_plane = plane;
+					break;
+				}
+			}
+			if (overlay_plane)
+				wl_list_remove(&overlay_plane->link);
+
 			if (!(output = output_new(connector)))
 				continue;
 
-			output->screen = screen_new(resources->crtcs[crtc_index], output, cursor_plane);
+			output->screen = screen_new(resources->crtcs[crtc_index], output, primary_plane, cursor_plane, overlay_plane);
 			output->screen->id = crtc_index;
 			taken_crtcs |= 1 << crtc_index;
 
@@ -394,6 +532,9 @@ drm_create_screens(struct wl_list *screens)
 	}
 	drmModeFreeResources(resources);
 
+	wl_list_for_each_safe (plane, tmp, &planes, link)
+		plane_destroy(plane);
+
 	return true;
 }
 
@@ -432,12 +573,23 @@ framebuffer_destroy(struct wld_destructor *destructor)
 	free(framebuffer);
 }
 
+static void
+close_handle(uint32_t handle)
+{
+	struct drm_gem_close args = {.handle = handle};
+
+	drmIoctl(swc.drm->fd, DRM_IOCTL_GEM_CLOSE, &args);
+}
+
 uint32_t
 drm_get_framebuffer(struct wld_buffer *buffer)
 {
+	const struct dmabuf_attributes *attributes;
 	struct framebuffer *framebuffer;
 	union wld_object object;
-	int ret;
+	uint32_t handles[4] = {0}, pitches[4] = {0}, offsets[4] = {0}, id = 0;
+	uint64_t modifier = DRM_FORMAT_MOD_INVALID, modifiers[4] = {0};
+	int i, j, num_planes = 1, ret;
 
 	if (!buffer)
 		return 0;
@@ -449,22 +601,56 @@ drm_get_framebuffer(struct wld_buffer *buffer)
 		ERROR("Could not get buffer handle\n");
 		return 0;
 	}
+	handles[0] = object.u32;
+	pitches[0] = buffer->pitch;
+
+	/* Multi-planar dmabufs have their remaining planes tracked by dmabuf.c. */
+	if ((attributes = dmabuf_get_attributes(buffer))) {
+		num_planes = attributes->num_planes;
+		modifier = attributes->modifier;
+		offsets[0] = attributes->offset[0];
+		for (i = 1; i < num_planes; ++i) {
+			if (drmPrimeFDToHandle(swc.drm->fd, attributes->fd[i], &handles[i]) < 0) {
+				ERROR("Could not import dmabuf plane %d: %s\n", i, strerror(errno));
+				goto close;
+			}
+			pitches[i] = attributes->stride[i];
+			offsets[i] = attributes->offset[i];
+		}
+	}
 
 	if (!(framebuffer = malloc(sizeof(*framebuffer))))
-		return 0;
-
-	ret = drmModeAddFB2(swc.drm->fd, buffer->width, buffer->height, buffer->format,
-	                    (uint32_t[4]){object.u32}, (uint32_t[4]){buffer->pitch}, (uint32_t[4]){0},
-	                    &framebuffer->id, 0);
+		goto close;
+
+	if (modifier != DRM_FORMAT_MOD_INVALID && drm.fb_modifiers) {
+		for (i = 0; i < num_planes; ++i)
+			modifiers[i] = modifier;
+		ret = drmModeAddFB2WithModifiers(swc.drm->fd, buffer->width, buffer->height, buffer->format,
+		                                 handles, pitches, offsets, modifiers, &framebuffer->id, DRM_MODE_FB_MODIFIERS);
+	} else {
+		ret = drmModeAddFB2(swc.drm->fd, buffer->width, buffer->height, buffer->format,
+		                    handles, pitches, offsets, &framebuffer->id, 0);
+	}
 	if (ret < 0) {
 		free(framebuffer);
-		return 0;
+		goto close;
 	}
 
 	framebuffer->exporter.export = &framebuffer_export;
 	wld_buffer_add_exporter(buffer, &framebuffer->exporter);
 	framebuffer->destructor.destroy = &framebuffer_destroy;
 	wld_buffer_add_destructor(buffer, &framebuffer->destructor);
+	id = framebuffer->id;
+
+close:
+	/* The framebuffer holds its own references, so drop any handles we created
+	 * that are not owned by wld. Planes sharing a buffer object share a handle. */
+	for (i = 1; i < num_planes && handles[i]; ++i) {
+		for (j = 0; j < i && handles[j] != handles[i]; ++j)
+			;
+		if (j == i)
+			close_handle(handles[i]);
+	}
 
-	return framebuffer->id;
+	return id;
 }
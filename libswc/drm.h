@@ -4,11 +4,14 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+struct wl_array;
 struct wl_list;
 struct wld_buffer;
 
 struct drm_handler {
 	void (*page_flip)(struct drm_handler *handler, uint32_t time);
+	/* Called for a vblank queued with drmCrtcQueueSequence. */
+	void (*vblank)(struct drm_handler *handler, uint32_t time);
 };
 
 struct swc_drm {
@@ -24,4 +27,7 @@ void drm_finalize(void);
 bool drm_create_screens(struct wl_list *screens);
 uint32_t drm_get_framebuffer(struct wld_buffer *buffer);
 
+bool drm_supports_modifier(uint32_t format, uint64_t modifier);
+bool drm_get_modifiers(uint32_t format, struct wl_array *modifiers);
+
 #endif
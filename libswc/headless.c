@@ -0,0 +1,157 @@
+/* swc: libswc/headless.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "headless.h"
+#include "drm.h"
+#include "internal.h"
+#include "output.h"
+#include "screen.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wld/wld.h>
+#include <wld/pixman.h>
+#include <xf86drmMode.h>
+
+#define DEFAULT_SCREENS "1920x1080@60"
+
+/* screen_mask() gives each screen one bit of a 32-bit mask. */
+#define MAX_SCREENS 32
+
+bool
+headless_initialize(void)
+{
+	/* The rest of swc renders through the DRM context, so put the pixman
+	 * context in its place. */
+	swc.drm->fd = -1;
+	swc.drm->cursor_w = 64;
+	swc.drm->cursor_h = 64;
+
+	if (!(swc.drm->context = wld_pixman_create_context())) {
+		ERROR("Could not create WLD pixman context\n");
+		goto error0;
+	}
+
+	if (!(swc.drm->renderer = wld_create_renderer(swc.drm->context))) {
+		ERROR("Could not create WLD pixman renderer\n");
+		goto error1;
+	}
+
+	return true;
+
+error1:
+	wld_destroy_context(swc.drm->context);
+error0:
+	return false;
+}
+
+void
+headless_finalize(void)
+{
+	wld_destroy_renderer(swc.drm->renderer);
+	wld_destroy_context(swc.drm->context);
+}
+
+static struct screen *
+create_screen(uint8_t id, uint16_t width, uint16_t height, uint32_t refresh)
+{
+	drmModeModeInfo mode = {
+		.hdisplay = width,
+		.vdisplay = height,
+		.vrefresh = refresh,
+		.type = DRM_MODE_TYPE_PREFERRED,
+	};
+	drmModeConnector connector = {
+		.connector_type = DRM_MODE_CONNECTOR_VIRTUAL,
+		.connector_type_id = id + 1,
+		.connection = DRM_MODE_CONNECTED,
+		.count_modes = 1,
+		.modes = &mode,
+	};
+	struct output *output;
+	struct screen *screen;
+
+	snprintf(mode.name, sizeof(mode.name), "%ux%u", width, height);
+
+	if (!(output = output_new(&connector)))
+		goto error0;
+
+	/* Without a CRTC, the primary plane simulates page flips at the refresh
+	 * rate of the mode. */
+	if (!(screen = screen_new(0, output, NULL, NULL, NULL)))
+		goto error1;
+
+	output->screen = screen;
+	screen->id = id;
+
+	return screen;
+
+error1:
+	output_destroy(output);
+error0:
+	return NULL;
+}
+
+bool
+headless_create_screens(struct wl_list *screens)
+{
+	const char *spec;
+	char *specs, *token;
+	unsigned width, height, refresh;
+	struct screen *screen;
+	uint8_t id = 0;
+
+	if (!(spec = getenv("SWC_HEADLESS_SCREENS")))
+		spec = DEFAULT_SCREENS;
+	if (!(specs = strdup(spec)))
+		return false;
+
+	for (token = strtok(specs, ","); token; token = strtok(NULL, ",")) {
+		if (id == MAX_SCREENS) {
+			WARNING("Ignoring headless screens after the first %d\n", MAX_SCREENS);
+			break;
+		}
+
+		refresh = 60;
+		if (sscanf(token, "%ux%u@%u", &width, &height, &refresh) < 2
+		 || width == 0 || width > UINT16_MAX
+		 || height == 0 || height > UINT16_MAX
+		 || refresh == 0)
+		{
+			WARNING("Invalid headless screen \"%s\"\n", token);
+			continue;
+		}
+
+		if (!(screen = create_screen(id, width, height, refresh)))
+			continue;
+		DEBUG("Created headless screen %ux%u@%u\n", width, height, refresh);
+		wl_list_insert(screens, &screen->link);
+		++id;
+	}
+	free(specs);
+
+	return true;
+}
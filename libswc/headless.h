@@ -0,0 +1,44 @@
+/* swc: libswc/headless.h
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SWC_HEADLESS_H
+#define SWC_HEADLESS_H
+
+#include <stdbool.h>
+
+struct wl_list;
+
+/**
+ * Set up rendering into memory buffers, for use without a DRM device.
+ */
+bool headless_initialize(void);
+void headless_finalize(void);
+
+/**
+ * Create the virtual screens described by SWC_HEADLESS_SCREENS, a
+ * comma-separated list of WIDTHxHEIGHT[@REFRESH] specifications.
+ */
+bool headless_create_screens(struct wl_list *screens);
+
+#endif
@@ -0,0 +1,324 @@
+/* swc: libswc/input_record.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "input_record.h"
+#include "dispatch.h"
+#include "internal.h"
+#include "keyboard.h"
+#include "pointer.h"
+#include "seat.h"
+#include "util.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum input_type {
+	INPUT_KEY,
+	INPUT_MOTION,
+	INPUT_BUTTON,
+	INPUT_AXIS,
+	INPUT_FRAME,
+};
+
+struct input_event {
+	uint64_t time;
+	enum input_type type;
+	union {
+		struct {
+			uint32_t value, state;
+		} key, button;
+		struct {
+			wl_fixed_t x, y;
+		} motion;
+		struct {
+			enum wl_pointer_axis axis;
+			enum wl_pointer_axis_source source;
+			wl_fixed_t value;
+			int value120;
+		} axis;
+	};
+};
+
+static struct {
+	FILE *file;
+	uint64_t start;
+} recording;
+
+static struct {
+	struct input_event *events;
+	size_t num_events, next;
+	uint64_t start;
+	struct wl_event_source *timer;
+} replay;
+
+static uint64_t
+get_time_us(void)
+{
+	return get_monotonic_ns() / 1000;
+}
+
+/* Recording {{{ */
+
+void
+input_record_key(uint32_t key, uint32_t state)
+{
+	if (recording.file)
+		fprintf(recording.file, "%" PRIu64 " key %" PRIu32 " %" PRIu32 "\n", get_time_us() - recording.start, key, state);
+}
+
+void
+input_record_motion(wl_fixed_t x, wl_fixed_t y)
+{
+	if (recording.file)
+		fprintf(recording.file, "%" PRIu64 " motion %.10g %.10g\n", get_time_us() - recording.start, wl_fixed_to_double(x), wl_fixed_to_double(y));
+}
+
+void
+input_record_button(uint32_t button, uint32_t state)
+{
+	if (recording.file)
+		fprintf(recording.file, "%" PRIu64 " button %" PRIu32 " %" PRIu32 "\n", get_time_us() - recording.start, button, state);
+}
+
+void
+input_record_axis(enum wl_pointer_axis axis, enum wl_pointer_axis_source source, wl_fixed_t value, int value120)
+{
+	if (recording.file)
+		fprintf(recording.file, "%" PRIu64 " axis %d %d %.10g %d\n", get_time_us() - recording.start, axis, source, wl_fixed_to_double(value), value120);
+}
+
+void
+input_record_frame(void)
+{
+	if (recording.file)
+		fprintf(recording.file, "%" PRIu64 " frame\n", get_time_us() - recording.start);
+}
+
+/* }}} */
+
+/* Replay {{{ */
+
+static bool
+parse_event(const char *line, struct input_event *event)
+{
+	char type[8];
+	double x, y;
+	unsigned axis, source;
+	int n;
+
+	if (sscanf(line, "%" SCNu64 " %7s %n", &event->time, type, &n) != 2)
+		return false;
+	line += n;
+
+	if (strcmp(type, "key") == 0) {
+		event->type = INPUT_KEY;
+		return sscanf(line, "%" SCNu32 " %" SCNu32, &event->key.value, &event->key.state) == 2;
+	} else if (strcmp(type, "motion") == 0) {
+		event->type = INPUT_MOTION;
+		if (sscanf(line, "%lf %lf", &x, &y) != 2)
+			return false;
+		event->motion.x = wl_fixed_from_double(x);
+		event->motion.y = wl_fixed_from_double(y);
+		return true;
+	} else if (strcmp(type, "button") == 0) {
+		event->type = INPUT_BUTTON;
+		return sscanf(line, "%" SCNu32 " %" SCNu32, &event->button.value, &event->button.state) == 2;
+	} else if (strcmp(type, "axis") == 0) {
+		event->type = INPUT_AXIS;
+		if (sscanf(line, "%u %u %lf %d", &axis, &source, &x, &event->axis.value120) != 4)
+			return false;
+		event->axis.axis = axis;
+		event->axis.source = source;
+		event->axis.value = wl_fixed_from_double(x);
+		return true;
+	} else if (strcmp(type, "frame") == 0) {
+		event->type = INPUT_FRAME;
+		return true;
+	}
+
+	return false;
+}
+
+static bool
+load_events(const char *path)
+{
+	FILE *file;
+	char *line = NULL;
+	size_t size = 0, alloc = 0, number = 0;
+	struct input_event *events;
+
+	if (!(file = fopen(path, "re"))) {
+		ERROR("Could not open %s: %s\n", path, strerror(errno));
+		return false;
+	}
+
+	while (getline(&line, &size, file) != -1) {
+		++number;
+		if (line[strspn(line, " \t\n")] == '\0' || line[0] == '#')
+			continue;
+		if (replay.num_events == alloc) {
+			alloc = alloc ? alloc * 2 : 256;
+			if (!(events = realloc(replay.events, alloc * sizeof(*events))))
+				goto error;
+			replay.events = events;
+		}
+		if (!parse_event(line, &replay.events[replay.num_events])) {
+			ERROR("%s:%zu: Invalid input event\n", path, number);
+			goto error;
+		}
+		++replay.num_events;
+	}
+
+	free(line);
+	fclose(file);
+	return true;
+
+error:
+	free(line);
+	fclose(file);
+	free(replay.events);
+	replay.events = NULL;
+	replay.num_events = 0;
+	return false;
+}
+
+static void
+inject(struct input_event *event, uint32_t time)
+{
+	struct pointer *pointer = swc.seat->pointer;
+
+	switch (event->type) {
+	case INPUT_KEY:
+		keyboard_handle_key(swc.seat->keyboard, time, event->key.value, event->key.state);
+		break;
+	case INPUT_MOTION:
+		pointer_handle_absolute_motion(pointer, time, event->motion.x, event->motion.y);
+		break;
+	case INPUT_BUTTON:
+		pointer_handle_button(pointer, time, event->button.value, event->button.state);
+		break;
+	case INPUT_AXIS:
+		pointer_handle_axis(pointer, time, event->axis.axis, event->axis.source, event->axis.value, event->axis.value120);
+		break;
+	case INPUT_FRAME:
+		pointer_handle_frame(pointer);
+		break;
+	}
+}
+
+static int
+handle_timer(void *data)
+{
+	uint64_t now = get_time_us(), elapsed = now - replay.start;
+	struct input_event *event;
+
+	while (replay.next < replay.num_events) {
+		event = &replay.events[replay.next];
+		if (event->time > elapsed) {
+			wl_event_source_timer_update(replay.timer, MAX((event->time - elapsed) / 1000, 1));
+			return 0;
+		}
+		++replay.next;
+
+		/* Input is ignored while the session is inactive. */
+		if (swc.active)
+			inject(event, now / 1000);
+	}
+
+	DEBUG("Finished replaying %zu input events\n", replay.num_events);
+	return 0;
+}
+
+static bool
+initialize_replay(const char *path)
+{
+	if (!load_events(path))
+		goto error0;
+
+	replay.timer = dispatch_add_timer("input_replay", &handle_timer, NULL);
+	if (!replay.timer) {
+		ERROR("Could not create input replay timer\n");
+		goto error1;
+	}
+
+	/* The replayed events may come from devices the seat doesn't have. */
+	seat_add_capabilities(swc.seat, WL_SEAT_CAPABILITY_KEYBOARD | WL_SEAT_CAPABILITY_POINTER);
+	replay.start = get_time_us();
+	wl_event_source_timer_update(replay.timer, 1);
+
+	return true;
+
+error1:
+	free(replay.events);
+	replay.events = NULL;
+error0:
+	return false;
+}
+
+/* }}} */
+
+bool
+input_record_initialize(void)
+{
+	const char *path;
+
+	if ((path = getenv("SWC_INPUT_RECORD"))) {
+		if (!(recording.file = fopen(path, "we"))) {
+			ERROR("Could not open %s: %s\n", path, strerror(errno));
+			goto error0;
+		}
+		recording.start = get_time_us();
+	}
+
+	if ((path = getenv("SWC_INPUT_REPLAY")) && !initialize_replay(path))
+		goto error1;
+
+	return true;
+
+error1:
+	if (recording.file) {
+		fclose(recording.file);
+		recording.file = NULL;
+	}
+error0:
+	return false;
+}
+
+void
+input_record_finalize(void)
+{
+	if (replay.timer) {
+		dispatch_remove(replay.timer);
+		replay.timer = NULL;
+		free(replay.events);
+		replay.events = NULL;
+	}
+	if (recording.file) {
+		fclose(recording.file);
+		recording.file = NULL;
+	}
+}
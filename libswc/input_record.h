@@ -0,0 +1,56 @@
+/* swc: libswc/input_record.h
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SWC_INPUT_RECORD_H
+#define SWC_INPUT_RECORD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wayland-server.h>
+
+/**
+ * Start recording input events to the file named by SWC_INPUT_RECORD, and
+ * replaying them from the file named by SWC_INPUT_REPLAY, if they are set.
+ *
+ * Both files have one event per line, starting with the time in microseconds
+ * since the start of recording or replay:
+ *
+ *   TIME key KEY STATE
+ *   TIME motion X Y
+ *   TIME button BUTTON STATE
+ *   TIME axis AXIS SOURCE VALUE VALUE120
+ *   TIME frame
+ *
+ * Empty lines and lines starting with '#' are ignored.
+ */
+bool input_record_initialize(void);
+void input_record_finalize(void);
+
+void input_record_key(uint32_t key, uint32_t state);
+void input_record_motion(wl_fixed_t x, wl_fixed_t y);
+void input_record_button(uint32_t button, uint32_t state);
+void input_record_axis(enum wl_pointer_axis axis, enum wl_pointer_axis_source source, wl_fixed_t value, int value120);
+void input_record_frame(void);
+
+#endif
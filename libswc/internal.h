@@ -32,12 +32,24 @@ enum {
 	SWC_EVENT_DEACTIVATED,
 };
 
+enum swc_backend {
+	/* Display on a DRM device, with swc-launch granting access to devices. */
+	SWC_BACKEND_DRM,
+	/* Render into memory for virtual screens, without any devices. */
+	SWC_BACKEND_HEADLESS,
+#ifdef ENABLE_WAYLAND_BACKEND
+	/* Show each screen as a window of another Wayland compositor. */
+	SWC_BACKEND_WAYLAND,
+#endif
+};
+
 struct swc {
 	struct wl_display *display;
 	struct wl_event_loop *event_loop;
 	const struct swc_manager *manager;
 	struct wl_signal event_signal;
 	bool active;
+	enum swc_backend backend;
 
 	struct swc_seat *seat;
 	const struct swc_bindings *const bindings;
@@ -48,6 +60,8 @@ struct swc {
 	struct wl_global *data_device_manager;
 	struct wl_global *kde_decoration_manager;
 	struct wl_global *panel_manager;
+	struct wl_global *relative_pointer_manager;
+	struct wl_global *screencopy_manager;
 	struct wl_global *shell;
 	struct wl_global *subcompositor;
 	struct wl_global *xdg_decoration_manager;
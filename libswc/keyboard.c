@@ -27,8 +27,10 @@
 
 #include "swc.h"
 #include "compositor.h"
+#include "input_record.h"
 #include "internal.h"
 #include "keyboard.h"
+#include "latency.h"
 #include "surface.h"
 #include "util.h"
 
@@ -90,6 +92,7 @@ client_handle_key(struct keyboard *keyboard, uint32_t time, struct key *key, uin
 		}
 	}
 
+	latency_send_input(keyboard->focus.client, LATENCY_KEY);
 	wl_resource_for_each (resource, &keyboard->focus.active)
 		wl_keyboard_send_key(resource, key->press.serial, time, key->press.value, state);
 	return true;
@@ -343,6 +346,7 @@ keyboard_handle_key(struct keyboard *keyboard, uint32_t time, uint32_t value, ui
 	struct keyboard_handler *handler;
 	uint32_t serial;
 
+	input_record_key(value, state);
 	serial = wl_display_next_serial(swc.display);
 
 	/* First handle key release events associated with a particular handler. */
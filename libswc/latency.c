@@ -0,0 +1,150 @@
+/* swc: libswc/latency.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "latency.h"
+#include "screen.h"
+#include "stats.h"
+#include "util.h"
+
+#include <wayland-server.h>
+
+/* Inputs that have not been shown after this long, in nanoseconds, are
+ * assumed never to be, and are dropped. */
+#define MAX_AGE 1000000000ull
+
+/* The most inputs kept waiting for a client's commit. */
+#define MAX_PENDING 256
+
+struct sample {
+	uint64_t time;
+	uint32_t screens;
+	uint32_t input;
+};
+
+static struct {
+	uint64_t input_time;
+
+	/* Inputs committed by a client but not yet repainted, and those submitted
+	 * to a screen but not yet shown. */
+	struct wl_array committed, submitted;
+} latency;
+
+uint32_t latency_histograms[NUM_LATENCY_INPUTS][LATENCY_BUCKETS];
+
+void
+latency_set_input_time(uint64_t usec)
+{
+	latency.input_time = usec * 1000;
+}
+
+void
+latency_send_input(struct wl_client *client, enum latency_input input)
+{
+	struct client_stats *stats;
+	struct sample *sample;
+
+	if (!latency.input_time || !client || !(stats = stats_client(client)))
+		return;
+	if (stats->pending_input.size >= MAX_PENDING * sizeof(*sample))
+		return;
+	if (!(sample = wl_array_add(&stats->pending_input, sizeof(*sample))))
+		return;
+	sample->time = latency.input_time;
+	sample->screens = 0;
+	sample->input = input;
+}
+
+void
+latency_commit(struct wl_client *client, uint32_t screens)
+{
+	struct client_stats *stats;
+	struct sample *sample, *committed;
+	uint64_t now = get_monotonic_ns();
+
+	if (!screens || !(stats = stats_client(client)))
+		return;
+
+	wl_array_for_each (sample, &stats->pending_input) {
+		if (now - sample->time > MAX_AGE)
+			continue;
+		if (!(committed = wl_array_add(&latency.committed, sizeof(*committed))))
+			break;
+		*committed = *sample;
+		committed->screens = screens;
+	}
+	stats->pending_input.size = 0;
+}
+
+void
+latency_submit(struct screen *screen)
+{
+	struct sample *sample, *submitted, *kept = latency.committed.data;
+	uint32_t mask = screen_mask(screen);
+	uint64_t now = get_monotonic_ns();
+
+	/* The first screen to be repainted after a commit is the one that shows
+	 * it. The rest are kept in place. */
+	wl_array_for_each (sample, &latency.committed) {
+		if (sample->screens & mask) {
+			if ((submitted = wl_array_add(&latency.submitted, sizeof(*submitted)))) {
+				*submitted = *sample;
+				submitted->screens = mask;
+			}
+		} else if (now - sample->time <= MAX_AGE) {
+			*kept++ = *sample;
+		}
+	}
+	latency.committed.size = (char *)kept - (char *)latency.committed.data;
+}
+
+void
+latency_present(struct screen *screen)
+{
+	struct sample *sample, *kept = latency.submitted.data;
+	uint32_t mask = screen_mask(screen);
+	uint64_t now = get_monotonic_ns(), age;
+
+	wl_array_for_each (sample, &latency.submitted) {
+		age = now > sample->time ? now - sample->time : 0;
+		if (sample->screens == mask)
+			++latency_histograms[sample->input][MIN(age / 1000000, LATENCY_BUCKETS - 1)];
+		else if (age <= MAX_AGE)
+			*kept++ = *sample;
+	}
+	latency.submitted.size = (char *)kept - (char *)latency.submitted.data;
+}
+
+void
+latency_initialize(void)
+{
+	wl_array_init(&latency.committed);
+	wl_array_init(&latency.submitted);
+}
+
+void
+latency_finalize(void)
+{
+	wl_array_release(&latency.committed);
+	wl_array_release(&latency.submitted);
+}
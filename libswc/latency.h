@@ -0,0 +1,77 @@
+/* swc: libswc/latency.h
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SWC_LATENCY_H
+#define SWC_LATENCY_H
+
+#include <stdint.h>
+
+/* Input latency is measured from the kernel's timestamp of an input event,
+ * through the client event it causes and that client's next commit with
+ * damage, to the completion of the page flip that shows it. Only input from
+ * libinput has kernel timestamps. */
+
+struct screen;
+struct wl_client;
+
+enum latency_input {
+	LATENCY_MOTION,
+	LATENCY_BUTTON,
+	LATENCY_KEY,
+	LATENCY_AXIS,
+	NUM_LATENCY_INPUTS,
+};
+
+/* Each bucket counts the inputs shown within one millisecond, except for the
+ * last, which counts the rest. */
+#define LATENCY_BUCKETS 64
+
+extern uint32_t latency_histograms[NUM_LATENCY_INPUTS][LATENCY_BUCKETS];
+
+/**
+ * Set the CLOCK_MONOTONIC time, in microseconds, of the input event being
+ * handled, or 0 after it has been handled.
+ */
+void latency_set_input_time(uint64_t usec);
+
+/**
+ * Note that the input event being handled was sent to a client.
+ */
+void latency_send_input(struct wl_client *client, enum latency_input input);
+
+/**
+ * Note that a client committed damage to a view on the given screens.
+ */
+void latency_commit(struct wl_client *client, uint32_t screens);
+
+/**
+ * Note that a frame was submitted to a screen, and that the frame was shown.
+ */
+void latency_submit(struct screen *screen);
+void latency_present(struct screen *screen);
+
+void latency_initialize(void);
+void latency_finalize(void);
+
+#endif
@@ -22,6 +22,7 @@
  */
 
 #include "launch.h"
+#include "dispatch.h"
 #include "event.h"
 #include "internal.h"
 #include "launch/protocol.h"
@@ -36,7 +37,7 @@ static struct {
 	int socket;
 	struct wl_event_source *source;
 	uint32_t next_serial;
-} launch;
+} launch = {.socket = -1};
 
 static bool
 handle_event(struct swc_launch_event *event)
@@ -84,7 +85,7 @@ launch_initialize(void)
 	if (fcntl(launch.socket, F_SETFD, FD_CLOEXEC) < 0)
 		return false;
 
-	launch.source = wl_event_loop_add_fd(swc.event_loop, launch.socket, WL_EVENT_READABLE, &handle_data, NULL);
+	launch.source = dispatch_add_fd("launch", launch.socket, WL_EVENT_READABLE, &handle_data, NULL);
 	if (!launch.source)
 		return false;
 
@@ -94,7 +95,7 @@ launch_initialize(void)
 void
 launch_finalize(void)
 {
-	wl_event_source_remove(launch.source);
+	dispatch_remove(launch.source);
 	close(launch.socket);
 }
 
@@ -109,6 +110,10 @@ send_request(struct swc_launch_request *request, const void *data, size_t size,
 		{.iov_base = event, .iov_len = sizeof(*event)},
 	};
 
+	/* Running without swc-launch (e.g. on the headless backend). */
+	if (launch.socket == -1)
+		return false;
+
 	request->serial = ++launch.next_serial;
 
 	if (send_fd(launch.socket, out_fd, request_iov, 1 + (size > 0)) == -1)
@@ -27,12 +27,17 @@ SWC_SOURCES =                       \
     libswc/data.c                   \
     libswc/data_device.c            \
     libswc/data_device_manager.c    \
+    libswc/dispatch.c               \
     libswc/dmabuf.c                 \
     libswc/drm.c                    \
+    libswc/headless.c               \
     libswc/input.c                  \
+    libswc/input_record.c           \
     libswc/kde_decoration.c         \
     libswc/keyboard.c               \
+    libswc/latency.c                \
     libswc/launch.c                 \
+    libswc/log.c                    \
     libswc/mode.c                   \
     libswc/output.c                 \
     libswc/panel.c                  \
@@ -40,15 +45,20 @@ SWC_SOURCES =                       \
     libswc/plane.c                  \
     libswc/pointer.c                \
     libswc/primary_plane.c          \
+    libswc/record.c                 \
     libswc/region.c                 \
+    libswc/relative_pointer.c       \
     libswc/screen.c                 \
+    libswc/screencopy.c             \
     libswc/shell.c                  \
     libswc/shell_surface.c          \
     libswc/shm.c                    \
+    libswc/stats.c                  \
     libswc/subcompositor.c          \
     libswc/subsurface.c             \
     libswc/surface.c                \
     libswc/swc.c                    \
+    libswc/trace.c                  \
     libswc/util.c                   \
     libswc/view.c                   \
     libswc/wayland_buffer.c         \
@@ -57,9 +67,11 @@ SWC_SOURCES =                       \
     libswc/xdg_output.c             \
     libswc/xdg_shell.c              \
     protocol/linux-dmabuf-unstable-v1-protocol.c \
+    protocol/relative-pointer-unstable-v1-protocol.c \
     protocol/server-decoration-protocol.c \
     protocol/swc-protocol.c         \
     protocol/wayland-drm-protocol.c \
+    protocol/wlr-screencopy-unstable-v1-protocol.c \
     protocol/xdg-decoration-unstable-v1-protocol.c \
     protocol/xdg-output-unstable-v1-protocol.c \
     protocol/xdg-shell-protocol.c
@@ -84,15 +96,25 @@ SWC_SOURCES +=                      \
     libswc/xwm.c
 endif
 
+ifeq ($(ENABLE_WAYLAND_BACKEND),1)
+$(dir)_CFLAGS += -DENABLE_WAYLAND_BACKEND
+$(dir)_PACKAGES += wayland-client
+
+SWC_SOURCES += libswc/nested.c
+endif
+
 SWC_STATIC_OBJECTS = $(SWC_SOURCES:%.c=%.o)
 SWC_SHARED_OBJECTS = $(SWC_SOURCES:%.c=%.lo)
 
 # Explicitly state dependencies on generated files
 objects = $(foreach obj,$(1),$(dir)/$(obj).o $(dir)/$(obj).lo)
-$(call objects,compositor panel_manager panel screen): protocol/swc-server-protocol.h
+$(call objects,compositor panel_manager panel screen stats): protocol/swc-server-protocol.h
 $(call objects,dmabuf): protocol/linux-dmabuf-unstable-v1-server-protocol.h
 $(call objects,drm drm_buffer): protocol/wayland-drm-server-protocol.h
 $(call objects,kde_decoration): protocol/server-decoration-server-protocol.h
+$(call objects,nested): protocol/xdg-shell-client-protocol.h
+$(call objects,relative_pointer): protocol/relative-pointer-unstable-v1-server-protocol.h
+$(call objects,screencopy): protocol/wlr-screencopy-unstable-v1-server-protocol.h
 $(call objects,xdg_decoration): protocol/xdg-decoration-unstable-v1-server-protocol.h
 $(call objects,xdg_output): protocol/xdg-output-unstable-v1-server-protocol.h
 $(call objects,xdg_shell): protocol/xdg-shell-server-protocol.h
@@ -134,3 +156,5 @@ install-$(dir): $($(dir)_TARGETS:$(dir)/%=install-%) | $(DESTDIR)$(INCLUDEDIR)
 CLEAN_FILES += $(SWC_SHARED_OBJECTS) $(SWC_STATIC_OBJECTS)
 
 include common.mk
+
+$(dir)_PACKAGE_LIBS += -lpthread
@@ -0,0 +1,386 @@
+/* swc: libswc/log.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "log.h"
+#include "util.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+/* Must be a power of two. */
+#define RING_SIZE 1024
+#define MAX_OVERRIDES 32
+
+/* Messages are written to stderr at most once per INTERVAL nanoseconds on
+ * average, with bursts of up to BURST messages. */
+#define INTERVAL (1000000000 / 50)
+#define BURST 200
+
+struct entry {
+	uint64_t time;
+	enum swc_log_level level;
+	int length;
+	char text[256];
+};
+
+struct override {
+	char name[32];
+	int level;
+};
+
+static const char *const level_names[] = {
+	[SWC_LOG_ERROR] = "ERROR",
+	[SWC_LOG_WARNING] = "WARNING",
+	[SWC_LOG_INFO] = "INFO",
+	[SWC_LOG_DEBUG] = "DEBUG",
+};
+
+static struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	pthread_t thread;
+	bool running, quit;
+
+	struct entry entries[RING_SIZE];
+	/* The number of messages ever recorded, and the index of the next one the
+	 * thread will consider printing. */
+	uint64_t head, printed;
+
+	bool configured;
+	int default_level, stderr_level;
+	struct override overrides[MAX_OVERRIDES];
+	unsigned num_overrides;
+	struct log_subsystem *subsystems;
+} logger = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static int
+parse_level(const char *string, size_t length)
+{
+	static const char *const names[] = {
+		[SWC_LOG_ERROR] = "error",
+		[SWC_LOG_WARNING] = "warning",
+		[SWC_LOG_INFO] = "info",
+		[SWC_LOG_DEBUG] = "debug",
+	};
+	unsigned level;
+
+	for (level = 0; level < ARRAY_LENGTH(names); ++level) {
+		if (strlen(names[level]) == length && strncmp(string, names[level], length) == 0)
+			return level;
+	}
+
+	return -1;
+}
+
+static void
+set_override(const char *name, size_t length, int level)
+{
+	struct override *override;
+	unsigned i;
+
+	if (length >= sizeof(override->name))
+		return;
+	for (i = 0; i < logger.num_overrides; ++i) {
+		override = &logger.overrides[i];
+		if (strlen(override->name) == length && strncmp(override->name, name, length) == 0)
+			goto found;
+	}
+	if (logger.num_overrides == ARRAY_LENGTH(logger.overrides))
+		return;
+	override = &logger.overrides[logger.num_overrides++];
+	memcpy(override->name, name, length);
+	override->name[length] = '\0';
+found:
+	override->level = level;
+}
+
+/* Must be called with the mutex held. */
+static void
+configure(void)
+{
+	const char *spec, *end, *equals;
+	int level;
+
+	logger.configured = true;
+#if ENABLE_DEBUG
+	logger.default_level = SWC_LOG_DEBUG;
+#else
+	logger.default_level = SWC_LOG_WARNING;
+#endif
+	logger.stderr_level = logger.default_level;
+
+	if ((spec = getenv("SWC_LOG_STDERR")) && (level = parse_level(spec, strlen(spec))) != -1)
+		logger.stderr_level = level;
+
+	if (!(spec = getenv("SWC_LOG")))
+		return;
+	for (; *spec; spec = *end ? end + 1 : end) {
+		end = spec + strcspn(spec, ",");
+		equals = memchr(spec, '=', end - spec);
+		if (equals) {
+			if ((level = parse_level(equals + 1, end - equals - 1)) != -1)
+				set_override(spec, equals - spec, level);
+		} else if ((level = parse_level(spec, end - spec)) != -1) {
+			logger.default_level = level;
+		}
+	}
+}
+
+static int
+subsystem_level(const char *name)
+{
+	unsigned i;
+
+	for (i = 0; i < logger.num_overrides; ++i) {
+		if (strcmp(logger.overrides[i].name, name) == 0)
+			return logger.overrides[i].level;
+	}
+
+	return logger.default_level;
+}
+
+void
+log_register(struct log_subsystem *subsystem, const char *file)
+{
+	const char *name;
+
+	pthread_mutex_lock(&logger.mutex);
+	if (subsystem->level != LOG_UNREGISTERED)
+		goto done;
+	if (!logger.configured)
+		configure();
+
+	name = strrchr(file, '/');
+	name = name ? name + 1 : file;
+	if (!(subsystem->name = strndup(name, strcspn(name, "."))))
+		subsystem->name = name;
+	subsystem->next = logger.subsystems;
+	logger.subsystems = subsystem;
+	subsystem->level = subsystem_level(subsystem->name);
+
+done:
+	pthread_mutex_unlock(&logger.mutex);
+}
+
+EXPORT void
+swc_log_set_level(const char *name, enum swc_log_level level)
+{
+	struct log_subsystem *subsystem;
+
+	pthread_mutex_lock(&logger.mutex);
+	if (!logger.configured)
+		configure();
+
+	if (name) {
+		set_override(name, strlen(name), level);
+	} else {
+		logger.default_level = level;
+		logger.num_overrides = 0;
+	}
+
+	for (subsystem = logger.subsystems; subsystem; subsystem = subsystem->next)
+		subsystem->level = subsystem_level(subsystem->name);
+	pthread_mutex_unlock(&logger.mutex);
+}
+
+static void
+write_all(int fd, const char *data, size_t size)
+{
+	ssize_t ret;
+
+	for (; size > 0; data += ret, size -= ret) {
+		if ((ret = write(fd, data, size)) <= 0)
+			break;
+	}
+}
+
+void
+log_message(enum swc_log_level level, struct log_subsystem *subsystem, const char *file, int line, const char *format, ...)
+{
+	struct entry entry;
+	va_list args;
+	int length;
+
+	entry.time = get_monotonic_ns();
+	entry.level = level;
+#if ENABLE_DEBUG
+	length = snprintf(entry.text, sizeof(entry.text), "[swc:%s:%d] %s: ", file, line, level_names[level]);
+#else
+	length = snprintf(entry.text, sizeof(entry.text), "%s: ", level_names[level]);
+#endif
+	if (length < sizeof(entry.text)) {
+		va_start(args, format);
+		length += vsnprintf(entry.text + length, sizeof(entry.text) - length, format, args);
+		va_end(args);
+	}
+	if (length >= sizeof(entry.text)) {
+		length = sizeof(entry.text) - 1;
+		entry.text[length - 1] = '\n';
+	}
+	entry.length = length;
+
+	pthread_mutex_lock(&logger.mutex);
+	logger.entries[logger.head++ & (RING_SIZE - 1)] = entry;
+	if (level <= logger.stderr_level) {
+		if (logger.running)
+			pthread_cond_signal(&logger.cond);
+		else
+			write_all(STDERR_FILENO, entry.text, entry.length);
+	}
+	if (!logger.running)
+		logger.printed = logger.head;
+	pthread_mutex_unlock(&logger.mutex);
+}
+
+EXPORT void
+swc_log_dump(int fd)
+{
+	struct entry *entries;
+	uint64_t start, index;
+	uint32_t count;
+	char prefix[32];
+	int length;
+
+	pthread_mutex_lock(&logger.mutex);
+	start = logger.head > RING_SIZE ? logger.head - RING_SIZE : 0;
+	count = logger.head - start;
+	if (!(entries = malloc(count * sizeof(*entries)))) {
+		pthread_mutex_unlock(&logger.mutex);
+		return;
+	}
+	for (index = 0; index < count; ++index)
+		entries[index] = logger.entries[(start + index) & (RING_SIZE - 1)];
+	pthread_mutex_unlock(&logger.mutex);
+
+	for (index = 0; index < count; ++index) {
+		length = snprintf(prefix, sizeof(prefix), "[%5" PRIu64 ".%06u] ",
+		                  entries[index].time / 1000000000, (unsigned)(entries[index].time / 1000 % 1000000));
+		write_all(fd, prefix, length);
+		write_all(fd, entries[index].text, entries[index].length);
+	}
+	free(entries);
+}
+
+static void *
+run(void *data)
+{
+	struct entry entry;
+	uint64_t now, last = get_monotonic_ns(), credit = (uint64_t)BURST * INTERVAL;
+	uint32_t suppressed = 0;
+	char message[64];
+	int length;
+
+	pthread_mutex_lock(&logger.mutex);
+	for (;;) {
+		while (logger.printed == logger.head && !logger.quit)
+			pthread_cond_wait(&logger.cond, &logger.mutex);
+		if (logger.printed == logger.head)
+			break;
+		if (logger.head - logger.printed > RING_SIZE) {
+			suppressed += logger.head - logger.printed - RING_SIZE;
+			logger.printed = logger.head - RING_SIZE;
+		}
+		entry = logger.entries[logger.printed++ & (RING_SIZE - 1)];
+		if (entry.level > logger.stderr_level)
+			continue;
+		pthread_mutex_unlock(&logger.mutex);
+
+		now = get_monotonic_ns();
+		credit = MIN(credit + (now - last), (uint64_t)BURST * INTERVAL);
+		last = now;
+
+		/* Errors are never suppressed. */
+		if (credit < INTERVAL && entry.level != SWC_LOG_ERROR) {
+			++suppressed;
+		} else {
+			if (credit >= INTERVAL)
+				credit -= INTERVAL;
+			if (suppressed > 0) {
+				length = snprintf(message, sizeof(message), "WARNING: %" PRIu32 " log messages suppressed\n", suppressed);
+				write_all(STDERR_FILENO, message, length);
+				suppressed = 0;
+			}
+			write_all(STDERR_FILENO, entry.text, entry.length);
+		}
+
+		pthread_mutex_lock(&logger.mutex);
+	}
+	pthread_mutex_unlock(&logger.mutex);
+
+	if (suppressed > 0) {
+		length = snprintf(message, sizeof(message), "WARNING: %" PRIu32 " log messages suppressed\n", suppressed);
+		write_all(STDERR_FILENO, message, length);
+	}
+
+	return NULL;
+}
+
+bool
+log_initialize(void)
+{
+	sigset_t mask, old_mask;
+	int ret;
+
+	/* The event loop receives signals through signalfd, which requires them to
+	 * be blocked in every thread. */
+	sigfillset(&mask);
+	pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+	ret = pthread_create(&logger.thread, NULL, &run, NULL);
+	pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+
+	if (ret != 0) {
+		WARNING("Could not create log thread: %s\n", strerror(ret));
+		return false;
+	}
+
+	pthread_mutex_lock(&logger.mutex);
+	logger.running = true;
+	logger.quit = false;
+	pthread_mutex_unlock(&logger.mutex);
+
+	return true;
+}
+
+void
+log_finalize(void)
+{
+	if (!logger.running)
+		return;
+
+	pthread_mutex_lock(&logger.mutex);
+	logger.quit = true;
+	pthread_cond_signal(&logger.cond);
+	pthread_mutex_unlock(&logger.mutex);
+
+	pthread_join(logger.thread, NULL);
+	pthread_mutex_lock(&logger.mutex);
+	logger.running = false;
+	pthread_mutex_unlock(&logger.mutex);
+}
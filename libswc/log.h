@@ -0,0 +1,68 @@
+/* swc: libswc/log.h
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SWC_LOG_H
+#define SWC_LOG_H
+
+#include "swc.h"
+
+#include <stdbool.h>
+
+/* Messages at or above a subsystem's level are formatted into an in-memory
+ * ring. Those at or above the level given by SWC_LOG_STDERR are then written
+ * to stderr by a background thread, at a limited rate, so that a slow stderr
+ * never stalls the compositor. The rest stay in the ring until they are
+ * overwritten or dumped with swc_log_dump. */
+
+/* Each source file that logs is its own subsystem. */
+struct log_subsystem {
+	const char *name;
+	int level;
+	struct log_subsystem *next;
+};
+
+#define LOG_UNREGISTERED (-1)
+
+static struct log_subsystem log_subsystem __attribute__((unused)) = {.level = LOG_UNREGISTERED};
+
+#define LOG(message_level, format, ...) \
+	do { \
+		if (log_subsystem.level == LOG_UNREGISTERED) \
+			log_register(&log_subsystem, __FILE__); \
+		if ((int)(message_level) <= log_subsystem.level) \
+			log_message(message_level, &log_subsystem, __FILE__, __LINE__, format, ##__VA_ARGS__); \
+	} while (false)
+
+void log_register(struct log_subsystem *subsystem, const char *file);
+void log_message(enum swc_log_level level, struct log_subsystem *subsystem, const char *file, int line, const char *format, ...)
+	__attribute__((format(printf, 5, 6)));
+
+/**
+ * Start the thread that writes messages to stderr. Until then, and after
+ * log_finalize, messages are written synchronously.
+ */
+bool log_initialize(void);
+void log_finalize(void);
+
+#endif
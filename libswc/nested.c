@@ -0,0 +1,665 @@
+/* swc: libswc/nested.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "nested.h"
+#include "dispatch.h"
+#include "event.h"
+#include "headless.h"
+#include "internal.h"
+#include "keyboard.h"
+#include "pointer.h"
+#include "screen.h"
+#include "seat.h"
+#include "util.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <wayland-client.h>
+#include <wld/wld.h>
+#include "xdg-shell-client-protocol.h"
+
+struct nested_buffer {
+	struct nested_screen *screen;
+	struct wl_buffer *buffer;
+	void *data;
+	bool busy;
+};
+
+struct nested_screen {
+	struct screen *screen;
+	struct wl_surface *surface;
+	struct xdg_surface *xdg_surface;
+	struct xdg_toplevel *toplevel;
+	struct wl_callback *frame;
+	bool configured;
+	/* A frame waiting for the parent to release one of our buffers. */
+	struct wld_buffer *pending;
+
+	struct nested_buffer buffers[2];
+	void *data;
+	size_t size;
+	uint32_t stride;
+
+	struct wl_listener destroy_listener;
+	struct wl_list link;
+};
+
+static struct {
+	struct wl_display *display;
+	struct wl_registry *registry;
+	struct wl_compositor *compositor;
+	struct wl_shm *shm;
+	struct xdg_wm_base *wm_base;
+	struct wl_event_source *source;
+
+	uint32_t seat_name;
+	struct wl_seat *seat;
+	struct wl_pointer *pointer;
+	struct wl_keyboard *keyboard;
+	enum wl_pointer_axis_source axis_source;
+	struct nested_screen *focus;
+
+	struct wl_listener swc_listener;
+	struct wl_list screens;
+} nested;
+
+static struct nested_screen *
+find_screen(struct wl_surface *surface)
+{
+	struct nested_screen *screen;
+
+	wl_list_for_each (screen, &nested.screens, link) {
+		if (screen->surface == surface)
+			return screen;
+	}
+
+	return NULL;
+}
+
+/* Pointer {{{ */
+
+static void
+pointer_enter(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface, wl_fixed_t x, wl_fixed_t y)
+{
+	nested.focus = find_screen(surface);
+}
+
+static void
+pointer_leave(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface)
+{
+	nested.focus = NULL;
+}
+
+static void
+pointer_motion(void *data, struct wl_pointer *pointer, uint32_t time, wl_fixed_t x, wl_fixed_t y)
+{
+	struct swc_rectangle *geom;
+
+	if (!nested.focus)
+		return;
+
+	geom = &nested.focus->screen->base.geometry;
+	pointer_handle_absolute_motion(swc.seat->pointer, time, x + wl_fixed_from_int(geom->x), y + wl_fixed_from_int(geom->y));
+}
+
+static void
+pointer_button(void *data, struct wl_pointer *pointer, uint32_t serial, uint32_t time, uint32_t button, uint32_t state)
+{
+	pointer_handle_button(swc.seat->pointer, time, button, state);
+}
+
+static void
+pointer_axis(void *data, struct wl_pointer *pointer, uint32_t time, uint32_t axis, wl_fixed_t value)
+{
+	pointer_handle_axis(swc.seat->pointer, time, axis, nested.axis_source, value, 0);
+}
+
+static void
+pointer_frame(void *data, struct wl_pointer *pointer)
+{
+	pointer_handle_frame(swc.seat->pointer);
+	nested.axis_source = WL_POINTER_AXIS_SOURCE_WHEEL;
+}
+
+static void
+pointer_axis_source(void *data, struct wl_pointer *pointer, uint32_t source)
+{
+	nested.axis_source = source;
+}
+
+static void
+pointer_axis_stop(void *data, struct wl_pointer *pointer, uint32_t time, uint32_t axis)
+{
+}
+
+static void
+pointer_axis_discrete(void *data, struct wl_pointer *pointer, uint32_t axis, int32_t discrete)
+{
+}
+
+static const struct wl_pointer_listener pointer_listener = {
+	.enter = pointer_enter,
+	.leave = pointer_leave,
+	.motion = pointer_motion,
+	.button = pointer_button,
+	.axis = pointer_axis,
+	.frame = pointer_frame,
+	.axis_source = pointer_axis_source,
+	.axis_stop = pointer_axis_stop,
+	.axis_discrete = pointer_axis_discrete,
+};
+
+/* }}} */
+
+/* Keyboard {{{ */
+
+static void
+keyboard_keymap(void *data, struct wl_keyboard *keyboard, uint32_t format, int32_t fd, uint32_t size)
+{
+	/* Keys are interpreted with swc's own keymap. */
+	close(fd);
+}
+
+static void
+keyboard_enter(void *data, struct wl_keyboard *keyboard, uint32_t serial, struct wl_surface *surface, struct wl_array *keys)
+{
+}
+
+static void
+keyboard_leave(void *data, struct wl_keyboard *keyboard, uint32_t serial, struct wl_surface *surface)
+{
+	keyboard_reset(swc.seat->keyboard);
+}
+
+static void
+keyboard_key(void *data, struct wl_keyboard *keyboard, uint32_t serial, uint32_t time, uint32_t key, uint32_t state)
+{
+	keyboard_handle_key(swc.seat->keyboard, time, key, state);
+}
+
+static void
+keyboard_modifiers(void *data, struct wl_keyboard *keyboard, uint32_t serial, uint32_t depressed, uint32_t latched, uint32_t locked, uint32_t group)
+{
+}
+
+static void
+keyboard_repeat_info(void *data, struct wl_keyboard *keyboard, int32_t rate, int32_t delay)
+{
+}
+
+static const struct wl_keyboard_listener keyboard_listener = {
+	.keymap = keyboard_keymap,
+	.enter = keyboard_enter,
+	.leave = keyboard_leave,
+	.key = keyboard_key,
+	.modifiers = keyboard_modifiers,
+	.repeat_info = keyboard_repeat_info,
+};
+
+/* }}} */
+
+/* Seat {{{ */
+
+static void
+seat_capabilities(void *data, struct wl_seat *seat, uint32_t capabilities)
+{
+	if (capabilities & WL_SEAT_CAPABILITY_POINTER && !nested.pointer) {
+		nested.pointer = wl_seat_get_pointer(seat);
+		wl_pointer_add_listener(nested.pointer, &pointer_listener, NULL);
+	}
+	if (capabilities & WL_SEAT_CAPABILITY_KEYBOARD && !nested.keyboard) {
+		nested.keyboard = wl_seat_get_keyboard(seat);
+		wl_keyboard_add_listener(nested.keyboard, &keyboard_listener, NULL);
+	}
+	seat_add_capabilities(swc.seat, capabilities & (WL_SEAT_CAPABILITY_POINTER | WL_SEAT_CAPABILITY_KEYBOARD));
+}
+
+static void
+seat_name(void *data, struct wl_seat *seat, const char *name)
+{
+}
+
+static const struct wl_seat_listener seat_listener = {
+	.capabilities = seat_capabilities,
+	.name = seat_name,
+};
+
+/* Input goes to swc's seat, so only bind the parent's once that exists. */
+static void
+handle_swc_event(struct wl_listener *listener, void *data)
+{
+	struct event *event = data;
+
+	switch (event->type) {
+	case SWC_EVENT_ACTIVATED:
+		if (nested.seat || !nested.seat_name)
+			break;
+		nested.seat = wl_registry_bind(nested.registry, nested.seat_name, &wl_seat_interface, 5);
+		wl_seat_add_listener(nested.seat, &seat_listener, NULL);
+		wl_display_flush(nested.display);
+		break;
+	}
+}
+
+/* }}} */
+
+/* Screens {{{ */
+
+static void
+handle_frame(void *data, struct wl_callback *callback, uint32_t time)
+{
+	struct nested_screen *screen = data;
+
+	wl_callback_destroy(callback);
+	screen->frame = NULL;
+	view_frame(&screen->screen->planes.primary.view, time);
+}
+
+static const struct wl_callback_listener frame_listener = {
+	.done = handle_frame,
+};
+
+static int
+show(struct nested_screen *screen, struct nested_buffer *target, struct wld_buffer *buffer)
+{
+	struct primary_plane *plane = &screen->screen->planes.primary;
+	uint32_t i, height, stride;
+
+	if (!wld_map(buffer)) {
+		ERROR("Could not map screen buffer\n");
+		return -EIO;
+	}
+	height = MIN(buffer->height, plane->mode.height);
+	stride = MIN(buffer->pitch, screen->stride);
+	for (i = 0; i < height; ++i)
+		memcpy((char *)target->data + i * screen->stride, (char *)buffer->map + i * buffer->pitch, stride);
+	wld_unmap(buffer);
+
+	wl_surface_attach(screen->surface, target->buffer, 0, 0);
+	wl_surface_damage(screen->surface, 0, 0, plane->mode.width, plane->mode.height);
+	screen->frame = wl_surface_frame(screen->surface);
+	wl_callback_add_listener(screen->frame, &frame_listener, screen);
+	wl_surface_commit(screen->surface);
+	target->busy = true;
+	wl_display_flush(nested.display);
+
+	return 0;
+}
+
+static void
+handle_buffer_release(void *data, struct wl_buffer *wl_buffer)
+{
+	struct nested_buffer *buffer = data;
+	struct nested_screen *screen = buffer->screen;
+	struct wld_buffer *pending = screen->pending;
+
+	buffer->busy = false;
+	if (!pending)
+		return;
+	screen->pending = NULL;
+	/* If this fails, the frame never completes, just as when a page flip
+	 * fails. */
+	show(screen, buffer, pending);
+	wld_buffer_unreference(pending);
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+	.release = handle_buffer_release,
+};
+
+/* Stands in for a page flip, completing when the parent asks for the next
+ * frame. */
+static int
+present(struct primary_plane *plane, struct wld_buffer *buffer)
+{
+	struct nested_screen *screen;
+	uint32_t i;
+
+	wl_list_for_each (screen, &nested.screens, link) {
+		if (&screen->screen->planes.primary == plane)
+			break;
+	}
+	for (i = 0; i < ARRAY_LENGTH(screen->buffers); ++i) {
+		if (!screen->buffers[i].busy)
+			return show(screen, &screen->buffers[i], buffer);
+	}
+
+	/* A slow parent may hold on to both buffers. Show the frame as soon as it
+	 * releases one, like a page flip that takes a while to complete. */
+	wld_buffer_reference(buffer);
+	screen->pending = buffer;
+
+	return 0;
+}
+
+static void
+xdg_surface_configure(void *data, struct xdg_surface *xdg_surface, uint32_t serial)
+{
+	struct nested_screen *screen = data;
+
+	xdg_surface_ack_configure(xdg_surface, serial);
+	screen->configured = true;
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+	.configure = xdg_surface_configure,
+};
+
+static void
+toplevel_configure(void *data, struct xdg_toplevel *toplevel, int32_t width, int32_t height, struct wl_array *states)
+{
+	/* The screen keeps its mode, whatever size the parent suggests. */
+}
+
+static void
+toplevel_close(void *data, struct xdg_toplevel *toplevel)
+{
+	wl_display_terminate(swc.display);
+}
+
+static const struct xdg_toplevel_listener toplevel_listener = {
+	.configure = toplevel_configure,
+	.close = toplevel_close,
+};
+
+static bool
+create_buffers(struct nested_screen *screen, uint32_t width, uint32_t height)
+{
+	struct wl_shm_pool *pool;
+	size_t size;
+	uint32_t i;
+	int fd;
+
+	screen->stride = width * 4;
+	size = screen->stride * height;
+	screen->size = size * ARRAY_LENGTH(screen->buffers);
+
+	if ((fd = memfd_create("swc-nested", MFD_CLOEXEC)) < 0)
+		goto error0;
+	if (ftruncate(fd, screen->size) < 0)
+		goto error1;
+	screen->data = mmap(NULL, screen->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (screen->data == MAP_FAILED)
+		goto error1;
+
+	pool = wl_shm_create_pool(nested.shm, fd, screen->size);
+	for (i = 0; i < ARRAY_LENGTH(screen->buffers); ++i) {
+		screen->buffers[i].buffer = wl_shm_pool_create_buffer(pool, i * size, width, height, screen->stride, WL_SHM_FORMAT_XRGB8888);
+		screen->buffers[i].data = (char *)screen->data + i * size;
+		screen->buffers[i].screen = screen;
+		screen->buffers[i].busy = false;
+		wl_buffer_add_listener(screen->buffers[i].buffer, &buffer_listener, &screen->buffers[i]);
+	}
+	wl_shm_pool_destroy(pool);
+	close(fd);
+
+	return true;
+
+error1:
+	close(fd);
+error0:
+	ERROR("Could not allocate nested screen buffers: %s\n", strerror(errno));
+	return false;
+}
+
+static void
+destroy_screen(struct nested_screen *screen)
+{
+	uint32_t i;
+
+	if (screen->frame)
+		wl_callback_destroy(screen->frame);
+	if (screen->pending)
+		wld_buffer_unreference(screen->pending);
+	for (i = 0; i < ARRAY_LENGTH(screen->buffers); ++i)
+		wl_buffer_destroy(screen->buffers[i].buffer);
+	munmap(screen->data, screen->size);
+	xdg_toplevel_destroy(screen->toplevel);
+	xdg_surface_destroy(screen->xdg_surface);
+	wl_surface_destroy(screen->surface);
+	wl_list_remove(&screen->destroy_listener.link);
+	wl_list_remove(&screen->link);
+	free(screen);
+}
+
+static void
+handle_screen_destroy(struct wl_listener *listener, void *data)
+{
+	struct nested_screen *screen = wl_container_of(listener, screen, destroy_listener);
+
+	destroy_screen(screen);
+}
+
+static bool
+create_window(struct screen *base)
+{
+	struct nested_screen *screen;
+	struct mode *mode = &base->planes.primary.mode;
+
+	if (!(screen = malloc(sizeof(*screen))))
+		goto error0;
+	screen->screen = base;
+	screen->frame = NULL;
+	screen->configured = false;
+	screen->pending = NULL;
+
+	if (!create_buffers(screen, mode->width, mode->height))
+		goto error1;
+
+	screen->surface = wl_compositor_create_surface(nested.compositor);
+	screen->xdg_surface = xdg_wm_base_get_xdg_surface(nested.wm_base, screen->surface);
+	xdg_surface_add_listener(screen->xdg_surface, &xdg_surface_listener, screen);
+	screen->toplevel = xdg_surface_get_toplevel(screen->xdg_surface);
+	xdg_toplevel_add_listener(screen->toplevel, &toplevel_listener, screen);
+	xdg_toplevel_set_title(screen->toplevel, "swc");
+	xdg_toplevel_set_app_id(screen->toplevel, "swc");
+	xdg_toplevel_set_min_size(screen->toplevel, mode->width, mode->height);
+	xdg_toplevel_set_max_size(screen->toplevel, mode->width, mode->height);
+	wl_surface_commit(screen->surface);
+
+	screen->destroy_listener.notify = &handle_screen_destroy;
+	wl_signal_add(&base->destroy_signal, &screen->destroy_listener);
+	wl_list_insert(&nested.screens, &screen->link);
+	base->planes.primary.present = &present;
+
+	/* Buffers can't be attached until the first configure. */
+	while (!screen->configured) {
+		if (wl_display_dispatch(nested.display) < 0) {
+			ERROR("Could not configure nested screen\n");
+			destroy_screen(screen);
+			base->planes.primary.present = NULL;
+			return false;
+		}
+	}
+
+	return true;
+
+error1:
+	free(screen);
+error0:
+	return false;
+}
+
+bool
+nested_create_screens(struct wl_list *screens)
+{
+	struct screen *screen, *tmp;
+
+	if (!headless_create_screens(screens))
+		return false;
+
+	wl_list_for_each_safe (screen, tmp, screens, link) {
+		if (!create_window(screen)) {
+			wl_list_remove(&screen->link);
+			screen_destroy(screen);
+		}
+	}
+
+	return true;
+}
+
+/* }}} */
+
+static void
+wm_base_ping(void *data, struct xdg_wm_base *wm_base, uint32_t serial)
+{
+	xdg_wm_base_pong(wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener wm_base_listener = {
+	.ping = wm_base_ping,
+};
+
+static void
+registry_global(void *data, struct wl_registry *registry, uint32_t name, const char *interface, uint32_t version)
+{
+	if (strcmp(interface, "wl_compositor") == 0) {
+		nested.compositor = wl_registry_bind(registry, name, &wl_compositor_interface, 1);
+	} else if (strcmp(interface, "wl_shm") == 0) {
+		nested.shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+	} else if (strcmp(interface, "xdg_wm_base") == 0) {
+		nested.wm_base = wl_registry_bind(registry, name, &xdg_wm_base_interface, 1);
+		xdg_wm_base_add_listener(nested.wm_base, &wm_base_listener, NULL);
+	} else if (strcmp(interface, "wl_seat") == 0 && version >= 5 && !nested.seat_name) {
+		nested.seat_name = name;
+	}
+}
+
+static void
+registry_global_remove(void *data, struct wl_registry *registry, uint32_t name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+	.global = registry_global,
+	.global_remove = registry_global_remove,
+};
+
+static int
+handle_data(int fd, uint32_t mask, void *data)
+{
+	if (mask & (WL_EVENT_HANGUP | WL_EVENT_ERROR))
+		goto error;
+
+	/* Events may have been queued while waiting for a roundtrip, without
+	 * leaving anything to read on the socket. */
+	while (wl_display_prepare_read(nested.display) != 0) {
+		if (wl_display_dispatch_pending(nested.display) < 0)
+			goto error;
+	}
+	if (mask & WL_EVENT_READABLE) {
+		if (wl_display_read_events(nested.display) < 0)
+			goto error;
+	} else {
+		wl_display_cancel_read(nested.display);
+	}
+	if (wl_display_dispatch_pending(nested.display) < 0)
+		goto error;
+	wl_display_flush(nested.display);
+
+	return 1;
+
+error:
+	ERROR("Lost connection to the parent compositor\n");
+	wl_display_terminate(swc.display);
+	return 0;
+}
+
+bool
+nested_initialize(void)
+{
+	const char *name;
+
+	if (!(name = getenv("SWC_WAYLAND_DISPLAY"))) {
+		ERROR("SWC_WAYLAND_DISPLAY is not set\n");
+		goto error0;
+	}
+	if (!(nested.display = wl_display_connect(name))) {
+		ERROR("Could not connect to Wayland display %s\n", name);
+		goto error0;
+	}
+
+	wl_list_init(&nested.screens);
+	nested.axis_source = WL_POINTER_AXIS_SOURCE_WHEEL;
+	nested.registry = wl_display_get_registry(nested.display);
+	wl_registry_add_listener(nested.registry, &registry_listener, NULL);
+	if (wl_display_roundtrip(nested.display) < 0)
+		goto error1;
+	if (!nested.compositor || !nested.shm || !nested.wm_base) {
+		ERROR("Parent compositor is missing wl_compositor, wl_shm or xdg_wm_base\n");
+		goto error1;
+	}
+
+	/* Screens are rendered into memory exactly as on the headless backend,
+	 * then copied to the parent. */
+	if (!headless_initialize())
+		goto error1;
+
+	nested.source = dispatch_add_fd("nested", wl_display_get_fd(nested.display), WL_EVENT_READABLE, &handle_data, NULL);
+	if (!nested.source) {
+		ERROR("Could not create event source for the parent compositor\n");
+		goto error2;
+	}
+
+	nested.swc_listener.notify = &handle_swc_event;
+	wl_signal_add(&swc.event_signal, &nested.swc_listener);
+
+	return true;
+
+error2:
+	headless_finalize();
+error1:
+	if (nested.wm_base)
+		xdg_wm_base_destroy(nested.wm_base);
+	if (nested.shm)
+		wl_shm_destroy(nested.shm);
+	if (nested.compositor)
+		wl_compositor_destroy(nested.compositor);
+	wl_registry_destroy(nested.registry);
+	wl_display_disconnect(nested.display);
+error0:
+	return false;
+}
+
+void
+nested_finalize(void)
+{
+	wl_list_remove(&nested.swc_listener.link);
+	if (nested.pointer)
+		wl_pointer_destroy(nested.pointer);
+	if (nested.keyboard)
+		wl_keyboard_destroy(nested.keyboard);
+	if (nested.seat)
+		wl_seat_destroy(nested.seat);
+	dispatch_remove(nested.source);
+	headless_finalize();
+	xdg_wm_base_destroy(nested.wm_base);
+	wl_shm_destroy(nested.shm);
+	wl_compositor_destroy(nested.compositor);
+	wl_registry_destroy(nested.registry);
+	wl_display_disconnect(nested.display);
+}
@@ -29,13 +29,18 @@
 #include "util.h"
 
 #include <errno.h>
+#include <inttypes.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wld/wld.h>
 #include <wld/drm.h>
+#include <drm_fourcc.h>
+#include <xf86drm.h>
 #include <xf86drmMode.h>
 
 enum plane_property {
 	PLANE_TYPE,
+	PLANE_IN_FORMATS,
 	PLANE_IN_FENCE_FD,
 	PLANE_CRTC_ID,
 	PLANE_CRTC_X,
@@ -49,25 +54,62 @@ enum plane_property {
 };
 
 static bool
-update(struct view *view)
+commit(struct plane *plane)
 {
-	struct plane *plane = wl_container_of(view, plane, view);
+	struct view *view = &plane->view;
 	uint32_t x, y, w, h;
 
-	if (!plane->screen)
-		return false;
 	x = view->geometry.x - plane->screen->base.geometry.x;
 	y = view->geometry.y - plane->screen->base.geometry.y;
 	w = view->geometry.width;
 	h = view->geometry.height;
-	if (swc.active && drmModeSetPlane(swc.drm->fd, plane->id, plane->screen->crtc, plane->fb, 0, x, y, w, h, 0, 0, w << 16, h << 16) < 0) {
-		ERROR("Could not set cursor: %s\n", strerror(errno));
+	if (drmModeSetPlane(swc.drm->fd, plane->id, plane->screen->crtc, plane->fb, 0, x, y, w, h, 0, 0, w << 16, h << 16) < 0) {
+		ERROR("Could not set %s plane: %s\n", plane->type == DRM_PLANE_TYPE_CURSOR ? "cursor" : "overlay", strerror(errno));
 		return false;
 	}
 
+	/* Only the cursor is batched. Overlays must fail synchronously, so
+	 * that the compositor can fall back to compositing the view. If the
+	 * vblank cannot be queued, later updates are just applied immediately. */
+	if (plane->type == DRM_PLANE_TYPE_CURSOR && drmCrtcQueueSequence(swc.drm->fd, plane->screen->crtc, DRM_CRTC_SEQUENCE_RELATIVE, 1, NULL, (uintptr_t)&plane->drm_handler) == 0)
+		plane->vblank_pending = true;
+
 	return true;
 }
 
+static bool
+update(struct view *view)
+{
+	struct plane *plane = wl_container_of(view, plane, view);
+
+	if (!plane->screen)
+		return false;
+	if (!swc.active)
+		return true;
+	if (plane->vblank_pending) {
+		plane->dirty = true;
+		return true;
+	}
+
+	return commit(plane);
+}
+
+static void
+handle_vblank(struct drm_handler *handler, uint32_t time)
+{
+	struct plane *plane = wl_container_of(handler, plane, drm_handler);
+
+	plane->vblank_pending = false;
+	if (plane->destroyed) {
+		free(plane);
+		return;
+	}
+	if (plane->dirty && swc.active && plane->screen) {
+		plane->dirty = false;
+		commit(plane);
+	}
+}
+
 static int
 attach(struct view *view, struct wld_buffer *buffer)
 {
@@ -96,6 +138,7 @@ find_prop(const char *name)
 {
 	static const char property_names[][16] = {
 		[PLANE_TYPE]        = "type",
+		[PLANE_IN_FORMATS]  = "IN_FORMATS",
 		[PLANE_IN_FENCE_FD] = "IN_FENCE_FD",
 		[PLANE_CRTC_ID]     = "CRTC_ID",
 		[PLANE_CRTC_X]      = "CRTC_X",
@@ -124,11 +167,46 @@ handle_swc_event(struct wl_listener *listener, void *data)
 
 	switch (event->type) {
 	case SWC_EVENT_ACTIVATED:
+		/* A vblank queued before we were deactivated is still delivered when
+		 * the CRTC's vblank is turned off, so if one is outstanding, this
+		 * leaves the update to it. */
 		update(&plane->view);
 		break;
 	}
 }
 
+static bool
+add_modifiers(struct plane *plane, uint32_t blob_id)
+{
+	drmModePropertyBlobRes *blob;
+	struct drm_format_modifier_blob *header;
+	struct drm_format_modifier *modifiers;
+	struct plane_modifier *entry;
+	uint32_t *formats, i, j;
+	bool ret = false;
+
+	if (!(blob = drmModeGetPropertyBlob(swc.drm->fd, blob_id)))
+		return false;
+	header = blob->data;
+	formats = (uint32_t *)((char *)header + header->formats_offset);
+	modifiers = (struct drm_format_modifier *)((char *)header + header->modifiers_offset);
+	for (i = 0; i < header->count_modifiers; ++i) {
+		for (j = 0; j < 64; ++j) {
+			if (!(modifiers[i].formats & (uint64_t)1 << j))
+				continue;
+			if (!(entry = wl_array_add(&plane->modifiers, sizeof(*entry))))
+				goto done;
+			entry->format = formats[modifiers[i].offset + j];
+			entry->modifier = modifiers[i].modifier;
+		}
+	}
+	ret = true;
+
+done:
+	drmModeFreePropertyBlob(blob);
+	return ret;
+}
+
 struct plane *
 plane_new(uint32_t id)
 {
@@ -147,15 +225,40 @@ plane_new(uint32_t id)
 	plane->id = id;
 	plane->fb = 0;
 	plane->screen = NULL;
+	plane->drm_handler.vblank = &handle_vblank;
+	plane->vblank_pending = false;
+	plane->dirty = false;
+	plane->destroyed = false;
 	plane->possible_crtcs = drm_plane->possible_crtcs;
+	wl_array_init(&plane->formats);
+	wl_array_init(&plane->modifiers);
+	if (drm_plane->count_formats > 0) {
+		if (!wl_array_add(&plane->formats, drm_plane->count_formats * sizeof(uint32_t))) {
+			drmModeFreePlane(drm_plane);
+			goto error1;
+		}
+		memcpy(plane->formats.data, drm_plane->formats, drm_plane->count_formats * sizeof(uint32_t));
+	}
 	drmModeFreePlane(drm_plane);
 	plane->type = -1;
 	props = drmModeObjectGetProperties(swc.drm->fd, id, DRM_MODE_OBJECT_PLANE);
 	for (i = 0; i < props->count_props; ++i, drmModeFreeProperty(prop)) {
 		prop = drmModeGetProperty(swc.drm->fd, props->props[i]);
-		if (prop && find_prop(prop->name) == PLANE_TYPE)
+		if (!prop)
+			continue;
+		switch (find_prop(prop->name)) {
+		case PLANE_TYPE:
 			plane->type = props->prop_values[i];
+			break;
+		case PLANE_IN_FORMATS:
+			if (!add_modifiers(plane, props->prop_values[i]))
+				WARNING("Could not read IN_FORMATS of plane %" PRIu32 "\n", id);
+			break;
+		default:
+			break;
+		}
 	}
+	drmModeFreeObjectProperties(props);
 	plane->swc_listener.notify = &handle_swc_event;
 	wl_signal_add(&swc.event_signal, &plane->swc_listener);
 	view_initialize(&plane->view, &view_impl);
@@ -170,5 +273,45 @@ error0:
 void
 plane_destroy(struct plane *plane)
 {
-	free(plane);
+	if (!plane)
+		return;
+	wl_list_remove(&plane->swc_listener.link);
+	wl_array_release(&plane->formats);
+	wl_array_release(&plane->modifiers);
+	/* The pending vblank refers to the plane, so free it once it arrives. */
+	if (plane->vblank_pending)
+		plane->destroyed = true;
+	else
+		free(plane);
+}
+
+bool
+plane_supports_format(struct plane *plane, uint32_t format)
+{
+	uint32_t *f;
+
+	wl_array_for_each (f, &plane->formats) {
+		if (*f == format)
+			return true;
+	}
+	return false;
+}
+
+bool
+plane_supports_modifier(struct plane *plane, uint32_t format, uint64_t modifier)
+{
+	struct plane_modifier *entry;
+
+	if (!plane_supports_format(plane, format))
+		return false;
+	if (modifier == DRM_FORMAT_MOD_INVALID)
+		return true;
+	/* Without IN_FORMATS, only linear buffers are known to work. */
+	if (plane->modifiers.size == 0)
+		return modifier == DRM_FORMAT_MOD_LINEAR;
+	wl_array_for_each (entry, &plane->modifiers) {
+		if (entry->format == format && entry->modifier == modifier)
+			return true;
+	}
+	return false;
 }
@@ -24,22 +24,47 @@
 #ifndef SWC_PLANE_H
 #define SWC_PLANE_H
 
-#include "plane.h"
+#include "drm.h"
 #include "view.h"
 
 #include <wayland-server.h>
 
+struct plane_modifier {
+	uint32_t format;
+	uint64_t modifier;
+};
+
 struct plane {
 	struct view view;
 	struct screen *screen;
 	uint32_t id, fb;
 	int type;
 	uint32_t possible_crtcs;
+	struct wl_array formats;
+	/* The format/modifier pairs from IN_FORMATS, if the driver exposes it. */
+	struct wl_array modifiers;
 	struct wl_listener swc_listener;
 	struct wl_list link;
+
+	/* Cursor updates are applied at most once per frame. While a vblank
+	 * is pending, changes are only recorded, and applied when it arrives. */
+	struct drm_handler drm_handler;
+	bool vblank_pending, dirty, destroyed;
 };
 
 struct plane *plane_new(uint32_t id);
 void plane_destroy(struct plane *plane);
 
+/**
+ * Returns whether the plane can scan out buffers of the given DRM format.
+ */
+bool plane_supports_format(struct plane *plane, uint32_t format);
+
+/**
+ * Returns whether the plane can scan out buffers of the given DRM format
+ * with the given modifier. DRM_FORMAT_MOD_INVALID matches any supported
+ * format.
+ */
+bool plane_supports_modifier(struct plane *plane, uint32_t format, uint64_t modifier);
+
 #endif
@@ -24,7 +24,9 @@
 #include "pointer.h"
 #include "compositor.h"
 #include "event.h"
+#include "input_record.h"
 #include "internal.h"
+#include "latency.h"
 #include "plane.h"
 #include "screen.h"
 #include "shm.h"
@@ -109,6 +111,8 @@ attach(struct view *view, struct wld_buffer *buffer)
 		view_update_screens(view);
 
 	wl_list_for_each (screen, &swc.screens, link) {
+		if (!screen->planes.cursor)
+			continue;
 		view_attach(&screen->planes.cursor->view, buffer ? pointer->cursor.buffer : NULL);
 		view_update(&screen->planes.cursor->view);
 	}
@@ -125,6 +129,8 @@ move(struct view *view, int32_t x, int32_t y)
 		view_update_screens(view);
 
 	wl_list_for_each (screen, &swc.screens, link) {
+		if (!screen->planes.cursor)
+			continue;
 		view_move(&screen->planes.cursor->view, view->geometry.x, view->geometry.y);
 		view_update(&screen->planes.cursor->view);
 	}
@@ -183,6 +189,7 @@ client_handle_motion(struct pointer_handler *handler, uint32_t time, wl_fixed_t
 	if (wl_list_empty(&pointer->focus.active))
 		return false;
 
+	latency_send_input(pointer->focus.client, LATENCY_MOTION);
 	sx = x - wl_fixed_from_int(pointer->focus.view->base.geometry.x);
 	sy = y - wl_fixed_from_int(pointer->focus.view->base.geometry.y);
 	wl_resource_for_each (resource, &pointer->focus.active)
@@ -199,6 +206,7 @@ client_handle_button(struct pointer_handler *handler, uint32_t time, struct butt
 	if (wl_list_empty(&pointer->focus.active))
 		return false;
 
+	latency_send_input(pointer->focus.client, LATENCY_BUTTON);
 	wl_resource_for_each (resource, &pointer->focus.active)
 		wl_pointer_send_button(resource, button->press.serial, time, button->press.value, state);
 	return true;
@@ -221,6 +229,7 @@ client_handle_axis(struct pointer_handler *handler, uint32_t time, enum wl_point
 		pointer->client_axis_source = source;
 	}
 
+	latency_send_input(pointer->focus.client, LATENCY_AXIS);
 	wl_resource_for_each (resource, &pointer->focus.active) {
 		ver = wl_resource_get_version(resource);
 		if (source != -1 && ver >= WL_POINTER_AXIS_SOURCE_SINCE_VERSION)
@@ -273,6 +282,7 @@ pointer_initialize(struct pointer *pointer)
 	wl_list_init(&pointer->handlers);
 	wl_list_insert(&pointer->handlers, &pointer->client_handler.link);
 	wl_array_init(&pointer->buttons);
+	wl_list_init(&pointer->relative_resources);
 
 	view_initialize(&pointer->cursor.view, &view_impl);
 	pointer->cursor.surface = NULL;
@@ -285,8 +295,10 @@ pointer_initialize(struct pointer *pointer)
 
 	pointer_set_cursor(pointer, cursor_left_ptr);
 
-	wl_list_for_each (screen, &swc.screens, link)
-		view_attach(&screen->planes.cursor->view, pointer->cursor.buffer);
+	wl_list_for_each (screen, &swc.screens, link) {
+		if (screen->planes.cursor)
+			view_attach(&screen->planes.cursor->view, pointer->cursor.buffer);
+	}
 
 	input_focus_initialize(&pointer->focus, &pointer->focus_handler);
 	pixman_region32_init(&pointer->region);
@@ -415,6 +427,7 @@ pointer_handle_button(struct pointer *pointer, uint32_t time, uint32_t value, ui
 	struct button *button;
 	uint32_t serial;
 
+	input_record_button(value, state);
 	serial = wl_display_next_serial(swc.display);
 
 	if (state == WL_POINTER_BUTTON_STATE_RELEASED) {
@@ -455,6 +468,8 @@ pointer_handle_axis(struct pointer *pointer, uint32_t time, enum wl_pointer_axis
 {
 	struct pointer_handler *handler;
 
+	input_record_axis(axis, source, value, value120);
+
 	wl_list_for_each (handler, &pointer->handlers, link) {
 		if (handler->axis && handler->axis(handler, time, axis, source, value, value120)) {
 			handler->pending = true;
@@ -474,6 +489,7 @@ pointer_handle_absolute_motion(struct pointer *pointer, uint32_t time, wl_fixed_
 {
 	struct pointer_handler *handler;
 
+	input_record_motion(x, y);
 	clip_position(pointer, x, y);
 
 	wl_list_for_each (handler, &pointer->handlers, link) {
@@ -491,6 +507,8 @@ pointer_handle_frame(struct pointer *pointer)
 {
 	struct pointer_handler *handler;
 
+	input_record_frame();
+
 	wl_list_for_each (handler, &pointer->handlers, link) {
 		if (handler->pending && handler->frame) {
 			handler->frame(handler);
@@ -68,6 +68,9 @@ struct pointer {
 	struct pointer_handler client_handler;
 	enum wl_pointer_axis_source client_axis_source;
 
+	/* zwp_relative_pointer_v1 resources made from our wl_pointers. */
+	struct wl_list relative_resources;
+
 	wl_fixed_t x, y;
 	pixman_region32_t region;
 };
@@ -22,13 +22,17 @@
  */
 
 #include "primary_plane.h"
+#include "dispatch.h"
 #include "drm.h"
 #include "event.h"
 #include "internal.h"
 #include "launch.h"
+#include "trace.h"
 #include "util.h"
 
 #include <errno.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
 #include <wld/wld.h>
 #include <wld/drm.h>
 #include <xf86drm.h>
@@ -48,6 +52,45 @@ send_frame(void *data)
 	view_frame(&plane->view, get_time());
 }
 
+/* Arm the timer for the first vblank after now, keeping to a fixed cadence
+ * like a real display would. */
+static int
+schedule_vblank(struct primary_plane *plane)
+{
+	struct itimerspec value = {0};
+	uint64_t period = 1000000000000ull / plane->mode.refresh, current, next;
+
+	current = get_monotonic_ns();
+	next = plane->vblank_time + period;
+	if (next <= current)
+		next = current + period - (current - plane->vblank_time) % period;
+
+	value.it_value.tv_sec = next / 1000000000;
+	value.it_value.tv_nsec = next % 1000000000;
+	if (timerfd_settime(plane->vblank_fd, TFD_TIMER_ABSTIME, &value, NULL) < 0) {
+		ERROR("Could not arm vblank timer: %s\n", strerror(errno));
+		return -errno;
+	}
+	plane->vblank_time = next;
+
+	return 0;
+}
+
+static int
+handle_vblank(int fd, uint32_t mask, void *data)
+{
+	struct primary_plane *plane = data;
+	uint64_t expirations;
+
+	if (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+		TRACE_BEGIN("vblank");
+		view_frame(&plane->view, plane->vblank_time / 1000000);
+		TRACE_END();
+	}
+
+	return 0;
+}
+
 static int
 attach(struct view *view, struct wld_buffer *buffer)
 {
@@ -55,12 +98,15 @@ attach(struct view *view, struct wld_buffer *buffer)
 	uint32_t fb;
 	int ret;
 
+	if (!plane->crtc)
+		return plane->present ? plane->present(plane, buffer) : schedule_vblank(plane);
+
 	fb = drm_get_framebuffer(buffer);
 	if (plane->need_modeset) {
 		ret = drmModeSetCrtc(swc.drm->fd, plane->crtc, fb, 0, 0, plane->connectors.data, plane->connectors.size / 4, &plane->mode.info);
 
 		if (ret == 0) {
-			wl_event_loop_add_idle(swc.event_loop, &send_frame, plane);
+			dispatch_add_idle("send_frame", &send_frame, plane);
 			plane->need_modeset = false;
 		} else {
 			ERROR("Could not set CRTC to next framebuffer: %s\n", strerror(-ret));
@@ -112,13 +158,30 @@ handle_swc_event(struct wl_listener *listener, void *data)
 }
 
 bool
-primary_plane_initialize(struct primary_plane *plane, uint32_t crtc, struct mode *mode, uint32_t *connectors, uint32_t num_connectors)
+primary_plane_initialize(struct primary_plane *plane, uint32_t crtc, struct mode *mode, uint32_t *connectors, uint32_t num_connectors, struct wl_array *formats)
 {
 	uint32_t *plane_connectors;
 
-	if (!(plane->original_crtc_state = drmModeGetCrtc(swc.drm->fd, crtc))) {
-		ERROR("Failed to get CRTC state for CRTC %u: %s\n", crtc, strerror(errno));
-		goto error0;
+	plane->original_crtc_state = NULL;
+	plane->present = NULL;
+	plane->vblank_source = NULL;
+	plane->vblank_time = 0;
+	if (crtc) {
+		if (!(plane->original_crtc_state = drmModeGetCrtc(swc.drm->fd, crtc))) {
+			ERROR("Failed to get CRTC state for CRTC %u: %s\n", crtc, strerror(errno));
+			goto error0;
+		}
+	} else {
+		if ((plane->vblank_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)) < 0) {
+			ERROR("Failed to create vblank timer: %s\n", strerror(errno));
+			goto error0;
+		}
+		plane->vblank_source = dispatch_add_fd("vblank", plane->vblank_fd, WL_EVENT_READABLE, &handle_vblank, plane);
+		if (!plane->vblank_source) {
+			ERROR("Failed to create vblank event source\n");
+			close(plane->vblank_fd);
+			goto error0;
+		}
 	}
 
 	wl_array_init(&plane->connectors);
@@ -130,6 +193,14 @@ primary_plane_initialize(struct primary_plane *plane, uint32_t crtc, struct mode
 	}
 
 	memcpy(plane_connectors, connectors, num_connectors * sizeof(connectors[0]));
+
+	wl_array_init(&plane->formats);
+	if (formats && wl_array_copy(&plane->formats, formats) < 0) {
+		ERROR("Failed to allocate format array\n");
+		goto error2;
+	}
+
+	plane->format = WLD_FORMAT_XRGB8888;
 	plane->crtc = crtc;
 	plane->need_modeset = true;
 	view_initialize(&plane->view, &view_impl);
@@ -142,7 +213,13 @@ primary_plane_initialize(struct primary_plane *plane, uint32_t crtc, struct mode
 
 	return true;
 
+error2:
+	wl_array_release(&plane->connectors);
 error1:
+	if (plane->vblank_source) {
+		dispatch_remove(plane->vblank_source);
+		close(plane->vblank_fd);
+	}
 	drmModeFreeCrtc(plane->original_crtc_state);
 error0:
 	return false;
@@ -152,7 +229,29 @@ void
 primary_plane_finalize(struct primary_plane *plane)
 {
 	wl_array_release(&plane->connectors);
+	wl_array_release(&plane->formats);
+	if (plane->vblank_source) {
+		dispatch_remove(plane->vblank_source);
+		close(plane->vblank_fd);
+	}
 	drmModeCrtcPtr crtc = plane->original_crtc_state;
-	drmModeSetCrtc(swc.drm->fd, crtc->crtc_id, crtc->buffer_id, crtc->x, crtc->y, NULL, 0, &crtc->mode);
-	drmModeFreeCrtc(crtc);
+	if (crtc) {
+		drmModeSetCrtc(swc.drm->fd, crtc->crtc_id, crtc->buffer_id, crtc->x, crtc->y, NULL, 0, &crtc->mode);
+		drmModeFreeCrtc(crtc);
+	}
+}
+
+bool
+primary_plane_supports_format(struct primary_plane *plane, uint32_t format)
+{
+	uint32_t *f;
+
+	/* Every driver can scan out XRGB8888, even if it doesn't say so. */
+	if (format == WLD_FORMAT_XRGB8888)
+		return true;
+	wl_array_for_each (f, &plane->formats) {
+		if (*f == format)
+			return true;
+	}
+	return false;
 }
@@ -38,12 +38,22 @@ struct primary_plane {
 	struct mode mode;
 	struct view view;
 	struct wl_array connectors;
+	/* The formats the plane can scan out, and the one used for the screen. */
+	struct wl_array formats;
+	uint32_t format;
 	bool need_modeset;
 	struct drm_handler drm_handler;
+	/* Screens without a CRTC either present through their backend, or flip
+	 * on a timer. */
+	int (*present)(struct primary_plane *plane, struct wld_buffer *buffer);
+	int vblank_fd;
+	struct wl_event_source *vblank_source;
+	uint64_t vblank_time;
 	struct wl_listener swc_listener;
 };
 
-bool primary_plane_initialize(struct primary_plane *plane, uint32_t crtc, struct mode *mode, uint32_t *connectors, uint32_t num_connectors);
+bool primary_plane_initialize(struct primary_plane *plane, uint32_t crtc, struct mode *mode, uint32_t *connectors, uint32_t num_connectors, struct wl_array *formats);
 void primary_plane_finalize(struct primary_plane *plane);
+bool primary_plane_supports_format(struct primary_plane *plane, uint32_t format);
 
 #endif
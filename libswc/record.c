@@ -0,0 +1,336 @@
+/* swc: libswc/record.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "record.h"
+#include "internal.h"
+#include "surface.h"
+#include "util.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <wayland-server.h>
+
+struct record_client {
+	uint32_t id;
+	struct wl_listener destroy_listener;
+	struct wl_list link;
+};
+
+static struct {
+	FILE *file;
+	struct wl_protocol_logger *logger;
+	struct wl_listener client_created_listener;
+	struct wl_list clients;
+	struct wl_array payload;
+	uint64_t start;
+	uint32_t next_client;
+} record;
+
+static void
+write_record(uint32_t type, uint32_t client)
+{
+	struct record_header header = {
+		.time = get_monotonic_ns() - record.start,
+		.type = type,
+		.client = client,
+		.size = record.payload.size,
+	};
+
+	fwrite(&header, sizeof(header), 1, record.file);
+	if (record.payload.size > 0)
+		fwrite(record.payload.data, record.payload.size, 1, record.file);
+	record.payload.size = 0;
+}
+
+static bool
+add(const void *data, size_t size)
+{
+	void *dst;
+
+	if (size == 0)
+		return true;
+	if (!(dst = wl_array_add(&record.payload, size)))
+		return false;
+	memcpy(dst, data, size);
+	return true;
+}
+
+/* Add data padded to 32 bits, as in the wire format. */
+static bool
+add_padded(const void *data, size_t size)
+{
+	static const char padding[4];
+
+	return add(data, size) && add(padding, -size & 3);
+}
+
+static bool
+add_uint(uint32_t value)
+{
+	return add(&value, sizeof(value));
+}
+
+/* Clients {{{ */
+
+static void
+handle_client_destroy(struct wl_listener *listener, void *data)
+{
+	struct record_client *client = wl_container_of(listener, client, destroy_listener);
+
+	write_record(RECORD_CLIENT_DESTROY, client->id);
+	fflush(record.file);
+	wl_list_remove(&client->link);
+	free(client);
+}
+
+static void
+handle_client_created(struct wl_listener *listener, void *data)
+{
+	struct wl_client *wl_client = data;
+	struct record_client *client;
+
+	if (!(client = malloc(sizeof(*client)))) {
+		WARNING("Could not record client\n");
+		return;
+	}
+	client->id = record.next_client++;
+	client->destroy_listener.notify = &handle_client_destroy;
+	wl_client_add_destroy_listener(wl_client, &client->destroy_listener);
+	wl_list_insert(&record.clients, &client->link);
+	write_record(RECORD_CLIENT_CREATE, client->id);
+}
+
+static struct record_client *
+get_client(struct wl_client *wl_client)
+{
+	struct wl_listener *listener = wl_client_get_destroy_listener(wl_client, &handle_client_destroy);
+	struct record_client *client;
+
+	return listener ? wl_container_of(listener, client, destroy_listener) : NULL;
+}
+
+/* }}} */
+
+/* Requests {{{ */
+
+static uint32_t
+bytes_per_pixel(uint32_t format)
+{
+	switch (format) {
+	case WL_SHM_FORMAT_ARGB8888:
+	case WL_SHM_FORMAT_XRGB8888:
+		return 4;
+	case WL_SHM_FORMAT_RGB565:
+		return 2;
+	default:
+		/* Record whole rows. */
+		return 0;
+	}
+}
+
+/**
+ * Record the damaged part of the SHM buffer used by a surface commit, since
+ * the replayed client has no other way of knowing what it contained.
+ */
+static void
+record_buffer(struct record_client *client, struct surface *surface)
+{
+	struct wl_resource *resource;
+	struct wl_shm_buffer *buffer;
+	struct record_buffer header;
+	pixman_box32_t box;
+	uint32_t bpp, row;
+	const char *data;
+
+	if (!(surface->pending.commit & SURFACE_COMMIT_DAMAGE))
+		return;
+	resource = surface->pending.commit & SURFACE_COMMIT_ATTACH ? surface->pending.state.buffer : surface->state.buffer;
+	if (!resource || !(buffer = wl_shm_buffer_get(resource)))
+		return;
+
+	box = *pixman_region32_extents(&surface->pending.state.damage);
+	box.x1 = MAX(box.x1, 0);
+	box.y1 = MAX(box.y1, 0);
+	box.x2 = MIN(box.x2, wl_shm_buffer_get_width(buffer));
+	box.y2 = MIN(box.y2, wl_shm_buffer_get_height(buffer));
+	if (box.x1 >= box.x2 || box.y1 >= box.y2)
+		return;
+
+	header.object = wl_resource_get_id(resource);
+	header.stride = wl_shm_buffer_get_stride(buffer);
+	header.rows = box.y2 - box.y1;
+	if ((bpp = bytes_per_pixel(wl_shm_buffer_get_format(buffer)))) {
+		header.offset = box.y1 * header.stride + box.x1 * bpp;
+		header.width = (box.x2 - box.x1) * bpp;
+	} else {
+		header.offset = box.y1 * header.stride;
+		header.width = header.stride;
+	}
+	if (!add(&header, sizeof(header)))
+		goto error;
+
+	wl_shm_buffer_begin_access(buffer);
+	data = wl_shm_buffer_get_data(buffer);
+	for (row = 0; row < header.rows; ++row) {
+		if (!add(data + header.offset + row * header.stride, header.width))
+			break;
+	}
+	wl_shm_buffer_end_access(buffer);
+	if (row < header.rows)
+		goto error;
+
+	write_record(RECORD_BUFFER, client->id);
+	return;
+
+error:
+	WARNING("Could not record buffer contents\n");
+	record.payload.size = 0;
+}
+
+static bool
+add_arguments(const char *signature, const union wl_argument *arg)
+{
+	struct stat st;
+	uint32_t length;
+
+	for (; *signature; ++signature) {
+		switch (*signature) {
+		case 'i':
+		case 'u':
+		case 'f':
+		case 'n':
+			if (!add_uint(arg->u))
+				return false;
+			break;
+		case 'o':
+			if (!add_uint(arg->o ? wl_resource_get_id((struct wl_resource *)arg->o) : 0))
+				return false;
+			break;
+		case 's':
+			length = arg->s ? strlen(arg->s) + 1 : 0;
+			if (!add_uint(length) || !add_padded(arg->s, length))
+				return false;
+			break;
+		case 'a':
+			if (!add_uint(arg->a->size) || !add_padded(arg->a->data, arg->a->size))
+				return false;
+			break;
+		case 'h':
+			if (!add_uint(fstat(arg->h, &st) == 0 ? st.st_size : 0))
+				return false;
+			break;
+		default:
+			/* A version or nullability marker. */
+			continue;
+		}
+		++arg;
+	}
+
+	return true;
+}
+
+static void
+log_request(void *data, enum wl_protocol_logger_type type, const struct wl_protocol_logger_message *message)
+{
+	struct record_client *client;
+	struct record_request request;
+
+	if (type != WL_PROTOCOL_LOGGER_REQUEST)
+		return;
+	if (!(client = get_client(wl_resource_get_client(message->resource))))
+		return;
+
+	if (message->message_opcode == WL_SURFACE_COMMIT && strcmp(wl_resource_get_class(message->resource), "wl_surface") == 0)
+		record_buffer(client, wl_resource_get_user_data(message->resource));
+
+	request.object = wl_resource_get_id(message->resource);
+	request.opcode = message->message_opcode;
+	if (!add(&request, sizeof(request)) || !add_arguments(message->message->signature, message->arguments)) {
+		WARNING("Could not record %s request\n", message->message->name);
+		record.payload.size = 0;
+		return;
+	}
+	write_record(RECORD_REQUEST, client->id);
+}
+
+/* }}} */
+
+bool
+record_initialize(void)
+{
+	const char *path;
+
+	if (!(path = getenv("SWC_RECORD")))
+		return true;
+
+	if (!(record.file = fopen(path, "we"))) {
+		ERROR("Could not open %s: %s\n", path, strerror(errno));
+		goto error0;
+	}
+	if (fwrite(RECORD_MAGIC, sizeof(RECORD_MAGIC) - 1, 1, record.file) != 1) {
+		ERROR("Could not write to %s\n", path);
+		goto error1;
+	}
+	if (!(record.logger = wl_display_add_protocol_logger(swc.display, &log_request, NULL))) {
+		ERROR("Could not add protocol logger\n");
+		goto error1;
+	}
+
+	wl_list_init(&record.clients);
+	wl_array_init(&record.payload);
+	record.start = get_monotonic_ns();
+	record.client_created_listener.notify = &handle_client_created;
+	wl_display_add_client_created_listener(swc.display, &record.client_created_listener);
+
+	return true;
+
+error1:
+	fclose(record.file);
+	record.file = NULL;
+error0:
+	return false;
+}
+
+void
+record_finalize(void)
+{
+	struct record_client *client, *next;
+
+	if (!record.file)
+		return;
+
+	wl_protocol_logger_destroy(record.logger);
+	wl_list_remove(&record.client_created_listener.link);
+	wl_list_for_each_safe (client, next, &record.clients, link) {
+		wl_list_remove(&client->destroy_listener.link);
+		free(client);
+	}
+	if (fclose(record.file) != 0)
+		WARNING("Could not finish recording: %s\n", strerror(errno));
+	wl_array_release(&record.payload);
+	record.file = NULL;
+}
@@ -0,0 +1,78 @@
+/* swc: libswc/record.h
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SWC_RECORD_H
+#define SWC_RECORD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Trace files start with RECORD_MAGIC, followed by a sequence of records, each
+ * a struct record_header and its payload. Values are in host byte order. */
+#define RECORD_MAGIC "swctrc01"
+
+enum record_type {
+	/* A client connected. There is no payload. */
+	RECORD_CLIENT_CREATE,
+	/* A client disconnected. There is no payload. */
+	RECORD_CLIENT_DESTROY,
+	/* A request, as a struct record_request followed by its arguments in wire
+	 * format, except that file descriptors are replaced by the size of the
+	 * file they refer to. */
+	RECORD_REQUEST,
+	/* Part of the contents of a wl_shm buffer, as a struct record_buffer
+	 * followed by the rows. It is written before the commit that used it. */
+	RECORD_BUFFER,
+};
+
+struct record_header {
+	/* Nanoseconds since recording started. */
+	uint64_t time;
+	uint32_t type;
+	uint32_t client;
+	uint32_t size;
+};
+
+struct record_request {
+	uint32_t object;
+	uint32_t opcode;
+};
+
+struct record_buffer {
+	uint32_t object;
+	/* The byte offset of the first row within the buffer. */
+	uint32_t offset;
+	uint32_t stride;
+	/* The size in bytes and number of the rows that follow. */
+	uint32_t width, rows;
+};
+
+/**
+ * Start recording the requests of all clients to the file named by
+ * SWC_RECORD, if it is set.
+ */
+bool record_initialize(void);
+void record_finalize(void);
+
+#endif
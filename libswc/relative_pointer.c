@@ -0,0 +1,88 @@
+/* swc: libswc/relative_pointer.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "relative_pointer.h"
+#include "pointer.h"
+#include "util.h"
+
+#include "relative-pointer-unstable-v1-server-protocol.h"
+
+static const struct zwp_relative_pointer_v1_interface relative_pointer_impl = {
+	.destroy = destroy_resource,
+};
+
+static void
+get_relative_pointer(struct wl_client *client, struct wl_resource *resource, uint32_t id, struct wl_resource *pointer_resource)
+{
+	struct pointer *pointer = wl_resource_get_user_data(pointer_resource);
+
+	resource = wl_resource_create(client, &zwp_relative_pointer_v1_interface, wl_resource_get_version(resource), id);
+	if (!resource) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &relative_pointer_impl, pointer, &remove_resource);
+	wl_list_insert(&pointer->relative_resources, wl_resource_get_link(resource));
+}
+
+static const struct zwp_relative_pointer_manager_v1_interface relative_pointer_manager_impl = {
+	.destroy = destroy_resource,
+	.get_relative_pointer = get_relative_pointer,
+};
+
+static void
+bind_relative_pointer_manager(struct wl_client *client, void *data, uint32_t version, uint32_t id)
+{
+	struct wl_resource *resource;
+
+	resource = wl_resource_create(client, &zwp_relative_pointer_manager_v1_interface, version, id);
+	if (!resource) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &relative_pointer_manager_impl, NULL, NULL);
+}
+
+struct wl_global *
+relative_pointer_manager_create(struct wl_display *display)
+{
+	return wl_global_create(display, &zwp_relative_pointer_manager_v1_interface, 1, NULL, &bind_relative_pointer_manager);
+}
+
+void
+relative_pointer_send_motion(struct pointer *pointer, uint64_t time, wl_fixed_t dx, wl_fixed_t dy, wl_fixed_t dx_unaccel, wl_fixed_t dy_unaccel)
+{
+	struct wl_resource *resource;
+
+	if (!pointer->focus.client)
+		return;
+
+	wl_resource_for_each (resource, &pointer->relative_resources) {
+		if (wl_resource_get_client(resource) != pointer->focus.client)
+			continue;
+		zwp_relative_pointer_v1_send_relative_motion(resource, time >> 32, time & 0xffffffff, dx, dy, dx_unaccel, dy_unaccel);
+		/* Relative motion is grouped with the rest of the frame. */
+		pointer->client_handler.pending = true;
+	}
+}
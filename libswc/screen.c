@@ -22,10 +22,15 @@
  */
 
 #include "screen.h"
+#include "compositor.h"
 #include "drm.h"
 #include "event.h"
+#include "headless.h"
 #include "internal.h"
 #include "mode.h"
+#ifdef ENABLE_WAYLAND_BACKEND
+# include "nested.h"
+#endif
 #include "output.h"
 #include "plane.h"
 #include "pointer.h"
@@ -45,6 +50,19 @@ struct pointer_handler screens_pointer_handler = {
 	.motion = handle_motion,
 };
 
+EXPORT bool
+swc_screen_set_format(struct swc_screen *base, uint32_t format)
+{
+	struct screen *screen = INTERNAL(base);
+
+	if (!primary_plane_supports_format(&screen->planes.primary, format))
+		return false;
+	screen->planes.primary.format = format;
+	compositor_update_screen_format(screen);
+
+	return true;
+}
+
 EXPORT void
 swc_screen_set_handler(struct swc_screen *base, const struct swc_screen_handler *handler, void *data)
 {
@@ -59,8 +77,22 @@ screens_initialize(void)
 {
 	wl_list_init(&swc.screens);
 
-	if (!drm_create_screens(&swc.screens))
-		return false;
+	switch (swc.backend) {
+	case SWC_BACKEND_DRM:
+		if (!drm_create_screens(&swc.screens))
+			return false;
+		break;
+	case SWC_BACKEND_HEADLESS:
+		if (!headless_create_screens(&swc.screens))
+			return false;
+		break;
+#ifdef ENABLE_WAYLAND_BACKEND
+	case SWC_BACKEND_WAYLAND:
+		if (!nested_create_screens(&swc.screens))
+			return false;
+		break;
+#endif
+	}
 
 	if (wl_list_empty(&swc.screens))
 		return false;
@@ -95,7 +127,7 @@ bind_screen(struct wl_client *client, void *data, uint32_t version, uint32_t id)
 }
 
 struct screen *
-screen_new(uint32_t crtc, struct output *output, struct plane *cursor_plane)
+screen_new(uint32_t crtc, struct output *output, struct plane *primary_plane, struct plane *cursor_plane, struct plane *overlay_plane)
 {
 	struct screen *screen;
 	int32_t x = 0;
@@ -116,15 +148,20 @@ screen_new(uint32_t crtc, struct output *output, struct plane *cursor_plane)
 
 	screen->crtc = crtc;
 
-	if (!primary_plane_initialize(&screen->planes.primary, crtc, output->preferred_mode, &output->connector, 1)) {
+	if (!primary_plane_initialize(&screen->planes.primary, crtc, output->preferred_mode, &output->connector, 1, primary_plane ? &primary_plane->formats : NULL)) {
 		ERROR("Failed to initialize primary plane\n");
 		goto error2;
 	}
 
-	cursor_plane->screen = screen;
+	if (cursor_plane)
+		cursor_plane->screen = screen;
 	screen->planes.cursor = cursor_plane;
+	if (overlay_plane)
+		overlay_plane->screen = screen;
+	screen->planes.overlay = overlay_plane;
 
 	screen->handler = &null_handler;
+	screen->stats = (struct screen_stats){0};
 	wl_signal_init(&screen->destroy_signal);
 	wl_list_init(&screen->resources);
 	wl_list_init(&screen->outputs);
@@ -161,6 +198,7 @@ screen_destroy(struct screen *screen)
 		output_destroy(output);
 	primary_plane_finalize(&screen->planes.primary);
 	plane_destroy(screen->planes.cursor);
+	plane_destroy(screen->planes.overlay);
 	free(screen);
 }
 
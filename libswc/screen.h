@@ -26,6 +26,7 @@
 
 #include "swc.h"
 #include "primary_plane.h"
+#include "stats.h"
 
 #include <wayland-util.h>
 
@@ -54,11 +55,14 @@ struct screen {
 	struct {
 		struct primary_plane primary;
 		struct plane *cursor;
+		struct plane *overlay;
 	} planes;
 
 	struct wl_global *global;
 	struct wl_list resources;
 
+	struct screen_stats stats;
+
 	struct wl_list outputs;
 	struct wl_list modifiers;
 	struct wl_list link;
@@ -67,7 +71,7 @@ struct screen {
 bool screens_initialize(void);
 void screens_finalize(void);
 
-struct screen *screen_new(uint32_t crtc, struct output *output, struct plane *cursor_plane);
+struct screen *screen_new(uint32_t crtc, struct output *output, struct plane *primary_plane, struct plane *cursor_plane, struct plane *overlay_plane);
 void screen_destroy(struct screen *screen);
 
 static inline uint32_t
@@ -0,0 +1,436 @@
+/* swc: libswc/screencopy.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "screencopy.h"
+#include "compositor.h"
+#include "drm.h"
+#include "internal.h"
+#include "output.h"
+#include "screen.h"
+#include "shm.h"
+#include "util.h"
+#include "wayland_buffer.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <drm_fourcc.h>
+#include <wld/wld.h>
+#include "wlr-screencopy-unstable-v1-server-protocol.h"
+
+/* The damage a client has not yet copied from a screen. */
+struct session {
+	struct wl_client *client;
+	struct screen *screen;
+	pixman_region32_t damage;
+	struct wl_listener client_destroy_listener;
+	struct wl_listener screen_destroy_listener;
+	struct wl_list link;
+};
+
+struct frame {
+	struct wl_resource *resource;
+	struct screen *screen;
+	/* The captured area, in screen coordinates. */
+	struct swc_rectangle box;
+	uint32_t format;
+
+	struct wl_resource *buffer;
+	bool with_damage;
+	struct wl_listener buffer_destroy_listener;
+	struct wl_listener screen_destroy_listener;
+	/* Link in the list of frames waiting for a repaint. */
+	struct wl_list link;
+};
+
+static struct wl_list sessions = {&sessions, &sessions};
+static struct wl_list frames = {&frames, &frames};
+
+static void
+session_destroy(struct session *session)
+{
+	wl_list_remove(&session->client_destroy_listener.link);
+	wl_list_remove(&session->screen_destroy_listener.link);
+	wl_list_remove(&session->link);
+	pixman_region32_fini(&session->damage);
+	free(session);
+}
+
+static void
+handle_session_client_destroy(struct wl_listener *listener, void *data)
+{
+	struct session *session = wl_container_of(listener, session, client_destroy_listener);
+
+	session_destroy(session);
+}
+
+static void
+handle_session_screen_destroy(struct wl_listener *listener, void *data)
+{
+	struct session *session = wl_container_of(listener, session, screen_destroy_listener);
+
+	session_destroy(session);
+}
+
+static struct session *
+session_get(struct wl_client *client, struct screen *screen)
+{
+	struct session *session;
+	const struct swc_rectangle *geom = &screen->base.geometry;
+
+	wl_list_for_each (session, &sessions, link) {
+		if (session->client == client && session->screen == screen)
+			return session;
+	}
+
+	if (!(session = malloc(sizeof(*session))))
+		return NULL;
+	session->client = client;
+	session->screen = screen;
+	/* Nothing has been copied yet, so everything is damaged. */
+	pixman_region32_init_rect(&session->damage, 0, 0, geom->width, geom->height);
+	session->client_destroy_listener.notify = &handle_session_client_destroy;
+	wl_client_add_destroy_listener(client, &session->client_destroy_listener);
+	session->screen_destroy_listener.notify = &handle_session_screen_destroy;
+	wl_signal_add(&screen->destroy_signal, &session->screen_destroy_listener);
+	wl_list_insert(&sessions, &session->link);
+
+	return session;
+}
+
+static uint32_t
+format_wld_to_shm(uint32_t format)
+{
+	switch (format) {
+	case WLD_FORMAT_ARGB8888:
+		return WL_SHM_FORMAT_ARGB8888;
+	case WLD_FORMAT_XRGB8888:
+		return WL_SHM_FORMAT_XRGB8888;
+	default:
+		return format;
+	}
+}
+
+static uint32_t
+format_bytes(uint32_t format)
+{
+	switch (format) {
+	case DRM_FORMAT_RGB565:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+static bool
+copy_region(struct wld_buffer *dst, struct wld_buffer *src, int32_t x, int32_t y, pixman_region32_t *region)
+{
+	struct wld_renderer *renderer;
+
+	/* Prefer the GPU for dmabufs, and fall back to pixman for SHM. */
+	if ((wld_capabilities(swc.drm->renderer, dst) & WLD_CAPABILITY_WRITE)
+	 && (wld_capabilities(swc.drm->renderer, src) & WLD_CAPABILITY_READ))
+		renderer = swc.drm->renderer;
+	else if ((wld_capabilities(swc.shm->renderer, dst) & WLD_CAPABILITY_WRITE)
+	      && (wld_capabilities(swc.shm->renderer, src) & WLD_CAPABILITY_READ))
+		renderer = swc.shm->renderer;
+	else
+		return false;
+
+	wld_set_target_buffer(renderer, dst);
+	wld_copy_region(renderer, src, -x, -y, region);
+	wld_flush(renderer);
+
+	return true;
+}
+
+static void
+frame_finish(struct frame *frame)
+{
+	if (!frame->buffer)
+		return;
+	wl_list_remove(&frame->buffer_destroy_listener.link);
+	wl_list_remove(&frame->link);
+	wl_list_init(&frame->link);
+	frame->buffer = NULL;
+}
+
+static void
+frame_fail(struct frame *frame)
+{
+	frame_finish(frame);
+	zwlr_screencopy_frame_v1_send_failed(frame->resource);
+}
+
+/* Frames waiting for damage stay in the list until some arrives. */
+static void
+frame_copy(struct frame *frame, struct wld_buffer *src)
+{
+	struct session *session = NULL;
+	pixman_region32_t region;
+	pixman_box32_t *boxes;
+	struct timespec now;
+	int i, num_boxes;
+
+	pixman_region32_init_rect(&region, frame->box.x, frame->box.y, frame->box.width, frame->box.height);
+	if (frame->with_damage) {
+		if (!(session = session_get(wl_resource_get_client(frame->resource), frame->screen))) {
+			pixman_region32_fini(&region);
+			frame_fail(frame);
+			return;
+		}
+		pixman_region32_intersect(&region, &region, &session->damage);
+		if (!pixman_region32_not_empty(&region)) {
+			pixman_region32_fini(&region);
+			return;
+		}
+	}
+
+	if (!copy_region(wayland_buffer_get(frame->buffer), src, frame->box.x, frame->box.y, &region)) {
+		pixman_region32_fini(&region);
+		frame_fail(frame);
+		return;
+	}
+	frame_finish(frame);
+
+	zwlr_screencopy_frame_v1_send_flags(frame->resource, 0);
+	if (session) {
+		pixman_region32_subtract(&session->damage, &session->damage, &region);
+		pixman_region32_translate(&region, -frame->box.x, -frame->box.y);
+		boxes = pixman_region32_rectangles(&region, &num_boxes);
+		for (i = 0; i < num_boxes; ++i) {
+			zwlr_screencopy_frame_v1_send_damage(frame->resource, boxes[i].x1, boxes[i].y1,
+			                                     boxes[i].x2 - boxes[i].x1, boxes[i].y2 - boxes[i].y1);
+		}
+	}
+	pixman_region32_fini(&region);
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	zwlr_screencopy_frame_v1_send_ready(frame->resource, (uint64_t)now.tv_sec >> 32, now.tv_sec & 0xffffffff, now.tv_nsec);
+}
+
+static void
+handle_buffer_destroy(struct wl_listener *listener, void *data)
+{
+	struct frame *frame = wl_container_of(listener, frame, buffer_destroy_listener);
+
+	frame_fail(frame);
+}
+
+static void
+handle_frame_screen_destroy(struct wl_listener *listener, void *data)
+{
+	struct frame *frame = wl_container_of(listener, frame, screen_destroy_listener);
+
+	wl_list_remove(&frame->screen_destroy_listener.link);
+	frame->screen = NULL;
+	if (frame->buffer)
+		frame_fail(frame);
+}
+
+static void
+copy_frame(struct wl_resource *resource, struct wl_resource *buffer_resource, bool with_damage)
+{
+	struct frame *frame = wl_resource_get_user_data(resource);
+	struct wld_buffer *buffer = wayland_buffer_get(buffer_resource), *src;
+
+	if (frame->buffer) {
+		wl_resource_post_error(resource, ZWLR_SCREENCOPY_FRAME_V1_ERROR_ALREADY_USED, "frame already used");
+		return;
+	}
+	if (!buffer || buffer->width != frame->box.width || buffer->height != frame->box.height || buffer->format != frame->format) {
+		wl_resource_post_error(resource, ZWLR_SCREENCOPY_FRAME_V1_ERROR_INVALID_BUFFER, "invalid buffer");
+		return;
+	}
+	if (!frame->screen) {
+		zwlr_screencopy_frame_v1_send_failed(resource);
+		return;
+	}
+
+	frame->buffer = buffer_resource;
+	frame->with_damage = with_damage;
+	frame->buffer_destroy_listener.notify = &handle_buffer_destroy;
+	wl_resource_add_destroy_listener(buffer_resource, &frame->buffer_destroy_listener);
+	wl_list_insert(&frames, &frame->link);
+
+	/* The most recent frame can be copied right away, unless some views were
+	 * scanned out instead of rendered into it. Otherwise wait for the next
+	 * repaint. */
+	if (compositor_prepare_capture(frame->screen)
+	 && (src = compositor_get_screen_buffer(frame->screen)) && src->format == frame->format)
+		frame_copy(frame, src);
+}
+
+static void
+copy(struct wl_client *client, struct wl_resource *resource, struct wl_resource *buffer)
+{
+	copy_frame(resource, buffer, false);
+}
+
+static void
+copy_with_damage(struct wl_client *client, struct wl_resource *resource, struct wl_resource *buffer)
+{
+	copy_frame(resource, buffer, true);
+}
+
+static const struct zwlr_screencopy_frame_v1_interface frame_impl = {
+	.copy = copy,
+	.destroy = destroy_resource,
+	.copy_with_damage = copy_with_damage,
+};
+
+static void
+frame_destroy(struct wl_resource *resource)
+{
+	struct frame *frame = wl_resource_get_user_data(resource);
+
+	frame_finish(frame);
+	if (frame->screen)
+		wl_list_remove(&frame->screen_destroy_listener.link);
+	free(frame);
+}
+
+static void
+capture_output_region(struct wl_client *client, struct wl_resource *resource, uint32_t id, int32_t overlay_cursor,
+                      struct wl_resource *output_resource, int32_t x, int32_t y, int32_t width, int32_t height)
+{
+	struct output *output = wl_resource_get_user_data(output_resource);
+	struct screen *screen = output->screen;
+	struct frame *frame;
+	pixman_box32_t box;
+	uint32_t version = wl_resource_get_version(resource);
+
+	if (!(frame = malloc(sizeof(*frame))))
+		goto error0;
+	frame->resource = wl_resource_create(client, &zwlr_screencopy_frame_v1_interface, version, id);
+	if (!frame->resource)
+		goto error1;
+	wl_resource_set_implementation(frame->resource, &frame_impl, frame, &frame_destroy);
+	frame->buffer = NULL;
+	wl_list_init(&frame->link);
+	frame->screen = screen;
+	frame->screen_destroy_listener.notify = &handle_frame_screen_destroy;
+	wl_signal_add(&screen->destroy_signal, &frame->screen_destroy_listener);
+	frame->format = screen->planes.primary.format;
+
+	box.x1 = MAX(x, 0);
+	box.y1 = MAX(y, 0);
+	box.x2 = MIN((int64_t)x + width, screen->base.geometry.width);
+	box.y2 = MIN((int64_t)y + height, screen->base.geometry.height);
+	if (box.x2 <= box.x1 || box.y2 <= box.y1) {
+		zwlr_screencopy_frame_v1_send_failed(frame->resource);
+		return;
+	}
+	frame->box.x = box.x1;
+	frame->box.y = box.y1;
+	frame->box.width = box.x2 - box.x1;
+	frame->box.height = box.y2 - box.y1;
+
+	/* The cursor is on its own plane, so it is never part of the frame. */
+	zwlr_screencopy_frame_v1_send_buffer(frame->resource, format_wld_to_shm(frame->format), frame->box.width, frame->box.height,
+	                                     frame->box.width * format_bytes(frame->format));
+	if (version >= 3) {
+		zwlr_screencopy_frame_v1_send_linux_dmabuf(frame->resource, frame->format, frame->box.width, frame->box.height);
+		zwlr_screencopy_frame_v1_send_buffer_done(frame->resource);
+	}
+
+	return;
+
+error1:
+	free(frame);
+error0:
+	wl_resource_post_no_memory(resource);
+}
+
+static void
+capture_output(struct wl_client *client, struct wl_resource *resource, uint32_t id, int32_t overlay_cursor, struct wl_resource *output)
+{
+	capture_output_region(client, resource, id, overlay_cursor, output, 0, 0, INT32_MAX, INT32_MAX);
+}
+
+static const struct zwlr_screencopy_manager_v1_interface manager_impl = {
+	.capture_output = capture_output,
+	.capture_output_region = capture_output_region,
+	.destroy = destroy_resource,
+};
+
+static void
+bind_manager(struct wl_client *client, void *data, uint32_t version, uint32_t id)
+{
+	struct wl_resource *resource;
+
+	resource = wl_resource_create(client, &zwlr_screencopy_manager_v1_interface, version, id);
+	if (!resource) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &manager_impl, NULL, NULL);
+}
+
+struct wl_global *
+screencopy_manager_create(struct wl_display *display)
+{
+	return wl_global_create(display, &zwlr_screencopy_manager_v1_interface, 3, NULL, &bind_manager);
+}
+
+void
+screencopy_add_damage(struct screen *screen, pixman_region32_t *damage)
+{
+	struct session *session;
+
+	wl_list_for_each (session, &sessions, link) {
+		if (session->screen == screen)
+			pixman_region32_union(&session->damage, &session->damage, damage);
+	}
+}
+
+bool
+screencopy_is_pending(struct screen *screen)
+{
+	struct frame *frame;
+
+	wl_list_for_each (frame, &frames, link) {
+		if (frame->screen == screen)
+			return true;
+	}
+
+	return false;
+}
+
+void
+screencopy_handle_repaint(struct screen *screen)
+{
+	struct frame *frame, *next;
+	struct wld_buffer *src;
+
+	if (wl_list_empty(&frames) || !(src = compositor_get_screen_buffer(screen)))
+		return;
+
+	wl_list_for_each_safe (frame, next, &frames, link) {
+		if (frame->screen != screen)
+			continue;
+		if (src->format != frame->format)
+			frame_fail(frame);
+		else
+			frame_copy(frame, src);
+	}
+}
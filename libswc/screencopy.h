@@ -0,0 +1,51 @@
+/* swc: libswc/screencopy.h
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SWC_SCREENCOPY_H
+#define SWC_SCREENCOPY_H
+
+#include <pixman.h>
+#include <stdbool.h>
+
+struct screen;
+struct wl_display;
+struct wl_global;
+
+struct wl_global *screencopy_manager_create(struct wl_display *display);
+
+/**
+ * Record damage to a screen, in screen coordinates, before it is repainted.
+ */
+void screencopy_add_damage(struct screen *screen, pixman_region32_t *damage);
+
+/**
+ * Returns whether any captures are waiting for the next frame of a screen.
+ */
+bool screencopy_is_pending(struct screen *screen);
+
+/**
+ * Complete any captures waiting for the next frame of a screen.
+ */
+void screencopy_handle_repaint(struct screen *screen);
+
+#endif
@@ -27,6 +27,7 @@
 #include "seat.h"
 #include "compositor.h"
 #include "data_device.h"
+#include "dispatch.h"
 #include "event.h"
 #include "internal.h"
 #include "keyboard.h"
@@ -410,11 +411,11 @@ seat_create(struct wl_display *display, const char *seat_name)
 	}
 	seat->base.pointer = &seat->pointer;
 
-	seat->kbd_source = wl_event_loop_add_fd
-		(swc.event_loop, seat->kbd_fd, WL_EVENT_READABLE,
+	seat->kbd_source = dispatch_add_fd
+		("keyboard", seat->kbd_fd, WL_EVENT_READABLE,
 		 &handle_ws_data, seat);
-	seat->mouse_source = wl_event_loop_add_fd
-		(swc.event_loop, seat->mouse_fd, WL_EVENT_READABLE,
+	seat->mouse_source = dispatch_add_fd
+		("mouse", seat->mouse_fd, WL_EVENT_READABLE,
 		 &handle_ws_data, seat);
 
 	return &seat->base;
@@ -438,8 +439,8 @@ seat_destroy(struct swc_seat *seat_base)
 {
 	struct seat *seat = wl_container_of(seat_base, seat, base);
 
-	wl_event_source_remove(seat->mouse_source);
-	wl_event_source_remove(seat->kbd_source);
+	dispatch_remove(seat->mouse_source);
+	dispatch_remove(seat->kbd_source);
 	close(seat->mouse_fd);
 	seat->mouse_fd = -1;
 	close(seat->kbd_fd);
@@ -453,3 +454,9 @@ seat_destroy(struct swc_seat *seat_base)
 	free(seat->name);
 	free(seat);
 }
+
+void
+seat_add_capabilities(struct swc_seat *seat_base, uint32_t capabilities)
+{
+	/* wscons seats always have both a keyboard and a pointer. */
+}
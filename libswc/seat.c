@@ -24,17 +24,26 @@
 #include "seat.h"
 #include "compositor.h"
 #include "data_device.h"
+#include "dispatch.h"
 #include "event.h"
 #include "internal.h"
 #include "keyboard.h"
+#include "latency.h"
 #include "launch.h"
 #include "pointer.h"
+#include "relative_pointer.h"
 #include "screen.h"
 #include "surface.h"
+#include "trace.h"
 #include "util.h"
 
 #include <dirent.h>
 #include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -42,6 +51,7 @@
 
 #include <libinput.h>
 #include <linux/input.h>
+#include <sys/eventfd.h>
 #ifdef ENABLE_LIBUDEV
 # include <libudev.h>
 #endif
@@ -50,6 +60,32 @@
 # define NETLINK_MASK 4
 #endif
 
+struct queued_event {
+	enum libinput_event_type type;
+	/* CLOCK_MONOTONIC time, in microseconds. */
+	uint64_t time;
+	union {
+		struct {
+			struct libinput_device *device;
+			uint32_t capabilities;
+		} device;
+		struct {
+			uint32_t value, state;
+		} key;
+		struct {
+			double x, y;
+			/* Only for relative motion. */
+			double dx_unaccel, dy_unaccel;
+		} motion;
+		struct {
+			bool vertical, horizontal;
+			/* Vertical, then horizontal. */
+			double value[2];
+			int value120[2];
+		} scroll;
+	};
+};
+
 struct seat {
 	struct swc_seat base;
 
@@ -57,7 +93,30 @@ struct seat {
 	uint32_t capabilities;
 
 	struct libinput *libinput;
-	struct wl_event_source *libinput_source;
+	struct {
+		pthread_t thread, main_thread;
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+
+		/* Wakes the main thread when events are queued or a device needs
+		 * to be opened, and wakes the input thread when it is wanted. */
+		int event_fd, wake_fd;
+		struct wl_event_source *source;
+
+		/* Written by the input thread at tail, and read by the main thread
+		 * at head. full is set while the input thread waits for room. */
+		struct queued_event events[1024];
+		atomic_uint head, tail;
+		atomic_bool full;
+
+		/* Protected by the mutex. */
+		struct {
+			const char *path;
+			int flags, fd;
+			bool pending;
+		} open;
+		bool pause, paused, suspend, quit, exited;
+	} input;
 
 #ifdef ENABLE_LIBUDEV
 	struct udev *udev;
@@ -104,24 +163,6 @@ handle_data_device_event(struct wl_listener *listener, void *data)
 		data_device_offer_selection(seat->base.data_device, seat->base.keyboard->focus.client);
 }
 
-static void
-handle_swc_event(struct wl_listener *listener, void *data)
-{
-	struct seat *seat = wl_container_of(listener, seat, swc_listener);
-	struct event *ev = data;
-
-	switch (ev->type) {
-	case SWC_EVENT_DEACTIVATED:
-		libinput_suspend(seat->libinput);
-		keyboard_reset(seat->base.keyboard);
-		break;
-	case SWC_EVENT_ACTIVATED:
-		if (libinput_resume(seat->libinput) != 0)
-			WARNING("Failed to resume libinput context\n");
-		break;
-	}
-}
-
 /* Wayland Seat Interface */
 static void
 get_pointer(struct wl_client *client, struct wl_resource *resource, uint32_t id)
@@ -187,10 +228,59 @@ update_capabilities(struct seat *seat, uint32_t capabilities)
 		wl_seat_send_capabilities(resource, seat->capabilities);
 }
 
+/* Input thread {{{ */
+
+/* libinput is read on its own thread, so that input is not held up while the
+ * main thread is busy. The thread copies each event into a single-producer,
+ * single-consumer ring and wakes the main thread through an eventfd, which
+ * handles the events in order.
+ *
+ * libinput is not thread-safe, so the main thread only uses it while the
+ * input thread is paused, and swc-launch is only spoken to from the main
+ * thread, so devices opened by the input thread are opened on its behalf. */
+
+static bool
+on_input_thread(struct seat *seat)
+{
+	return !pthread_equal(pthread_self(), seat->input.main_thread);
+}
+
+/* Called with the mutex held. */
+static void
+open_device(struct seat *seat)
+{
+	const char *path = seat->input.open.path;
+	int flags = seat->input.open.flags, fd;
+
+	pthread_mutex_unlock(&seat->input.mutex);
+	fd = launch_open_device(path, flags);
+	pthread_mutex_lock(&seat->input.mutex);
+
+	seat->input.open.fd = fd;
+	seat->input.open.pending = false;
+	pthread_cond_broadcast(&seat->input.cond);
+}
+
 static int
 open_restricted(const char *path, int flags, void *user_data)
 {
-	return launch_open_device(path, flags);
+	struct seat *seat = user_data;
+	int fd;
+
+	if (!on_input_thread(seat))
+		return launch_open_device(path, flags);
+
+	pthread_mutex_lock(&seat->input.mutex);
+	seat->input.open.path = path;
+	seat->input.open.flags = flags;
+	seat->input.open.pending = true;
+	eventfd_write(seat->input.event_fd, 1);
+	while (seat->input.open.pending)
+		pthread_cond_wait(&seat->input.cond, &seat->input.mutex);
+	fd = seat->input.open.fd;
+	pthread_mutex_unlock(&seat->input.mutex);
+
+	return fd;
 }
 
 static void
@@ -221,131 +311,525 @@ device_capabilities(struct libinput_device *device)
 	return capabilities;
 }
 
-static int
-handle_libinput_data(int fd, uint32_t mask, void *data)
+/**
+ * Stop the input thread from using libinput until resume_input_thread is
+ * called. This must not be called while opening a device for the thread.
+ */
+static void
+pause_input_thread(struct seat *seat)
+{
+	pthread_mutex_lock(&seat->input.mutex);
+	seat->input.pause = true;
+	eventfd_write(seat->input.wake_fd, 1);
+	while (!seat->input.paused) {
+		if (seat->input.open.pending)
+			open_device(seat);
+		else
+			pthread_cond_wait(&seat->input.cond, &seat->input.mutex);
+	}
+	pthread_mutex_unlock(&seat->input.mutex);
+}
+
+static void
+resume_input_thread(struct seat *seat)
+{
+	pthread_mutex_lock(&seat->input.mutex);
+	seat->input.pause = false;
+	pthread_cond_broadcast(&seat->input.cond);
+	pthread_mutex_unlock(&seat->input.mutex);
+}
+
+static bool
+queue_has_room(struct seat *seat)
+{
+	/* Sequentially consistent, like the store of head and the accesses to
+	 * full, so that the input thread cannot miss a wakeup when it sees a full
+	 * queue at the same time as the main thread empties it. */
+	uint32_t head = atomic_load(&seat->input.head);
+	uint32_t tail = atomic_load_explicit(&seat->input.tail, memory_order_relaxed);
+
+	return tail - head < ARRAY_LENGTH(seat->input.events);
+}
+
+/* Copy what the main thread needs from a libinput event. */
+static bool
+read_event(struct libinput_event *generic_event, struct queued_event *event)
 {
-	struct seat *seat = data;
-	struct screen *screen;
-	struct swc_rectangle *rect;
-	struct libinput_event *generic_event;
-	struct libinput_device *device;
 	union {
 		struct libinput_event_keyboard *k;
 		struct libinput_event_pointer *p;
-	} event;
-	wl_fixed_t x, y, value;
-	uint32_t time, key, state;
-	enum wl_pointer_axis_source source;
-	int value120;
+	} e;
 
-	if (libinput_dispatch(seat->libinput) != 0) {
+	event->type = libinput_event_get_type(generic_event);
+	switch (event->type) {
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+		event->device.device = libinput_device_ref(libinput_event_get_device(generic_event));
+		event->device.capabilities = device_capabilities(event->device.device);
+		break;
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		e.k = libinput_event_get_keyboard_event(generic_event);
+		event->time = libinput_event_keyboard_get_time_usec(e.k);
+		event->key.value = libinput_event_keyboard_get_key(e.k);
+		event->key.state = libinput_event_keyboard_get_key_state(e.k);
+		break;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		e.p = libinput_event_get_pointer_event(generic_event);
+		event->time = libinput_event_pointer_get_time_usec(e.p);
+		event->motion.x = libinput_event_pointer_get_dx(e.p);
+		event->motion.y = libinput_event_pointer_get_dy(e.p);
+		event->motion.dx_unaccel = libinput_event_pointer_get_dx_unaccelerated(e.p);
+		event->motion.dy_unaccel = libinput_event_pointer_get_dy_unaccelerated(e.p);
+		break;
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+		/* The screen is only known on the main thread, so the position is
+		 * kept as a fraction of its size. */
+		e.p = libinput_event_get_pointer_event(generic_event);
+		event->time = libinput_event_pointer_get_time_usec(e.p);
+		event->motion.x = libinput_event_pointer_get_absolute_x_transformed(e.p, 1);
+		event->motion.y = libinput_event_pointer_get_absolute_y_transformed(e.p, 1);
+		break;
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+		e.p = libinput_event_get_pointer_event(generic_event);
+		event->time = libinput_event_pointer_get_time_usec(e.p);
+		event->key.value = libinput_event_pointer_get_button(e.p);
+		event->key.state = libinput_event_pointer_get_button_state(e.p);
+		break;
+	case LIBINPUT_EVENT_POINTER_SCROLL_WHEEL:
+	case LIBINPUT_EVENT_POINTER_SCROLL_FINGER:
+	case LIBINPUT_EVENT_POINTER_SCROLL_CONTINUOUS:
+		e.p = libinput_event_get_pointer_event(generic_event);
+		event->time = libinput_event_pointer_get_time_usec(e.p);
+		event->scroll.vertical = libinput_event_pointer_has_axis(e.p, LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL);
+		event->scroll.horizontal = libinput_event_pointer_has_axis(e.p, LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL);
+		event->scroll.value[0] = event->scroll.value[1] = 0;
+		event->scroll.value120[0] = event->scroll.value120[1] = 0;
+		if (event->scroll.vertical) {
+			event->scroll.value[0] = libinput_event_pointer_get_scroll_value(e.p, LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL);
+			if (event->type == LIBINPUT_EVENT_POINTER_SCROLL_WHEEL)
+				event->scroll.value120[0] = libinput_event_pointer_get_scroll_value_v120(e.p, LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL);
+		}
+		if (event->scroll.horizontal) {
+			event->scroll.value[1] = libinput_event_pointer_get_scroll_value(e.p, LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL);
+			if (event->type == LIBINPUT_EVENT_POINTER_SCROLL_WHEEL)
+				event->scroll.value120[1] = libinput_event_pointer_get_scroll_value_v120(e.p, LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL);
+		}
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+static void
+read_events(struct seat *seat)
+{
+	struct libinput_event *generic_event;
+	struct queued_event *event;
+	uint32_t tail;
+	bool queued = false;
+
+	TRACE_BEGIN("read_libinput_events");
+	if (libinput_dispatch(seat->libinput) != 0)
 		WARNING("libinput_dispatch failed: %s\n", strerror(errno));
-		return 0;
+
+	while (libinput_next_event_type(seat->libinput) != LIBINPUT_EVENT_NONE) {
+		/* Leave the rest of the events with libinput until the main thread
+		 * makes room, rather than dropping them. Setting full before checking
+		 * again makes sure that one of the threads sees the other. */
+		if (!queue_has_room(seat)) {
+			atomic_store(&seat->input.full, true);
+			if (!queue_has_room(seat))
+				break;
+			atomic_store(&seat->input.full, false);
+		}
+
+		generic_event = libinput_get_event(seat->libinput);
+		tail = atomic_load_explicit(&seat->input.tail, memory_order_relaxed);
+		event = &seat->input.events[tail % ARRAY_LENGTH(seat->input.events)];
+		if (read_event(generic_event, event)) {
+			atomic_store_explicit(&seat->input.tail, tail + 1, memory_order_release);
+			queued = true;
+		}
+		libinput_event_destroy(generic_event);
 	}
+	TRACE_END();
 
-	while ((generic_event = libinput_get_event(seat->libinput))) {
-		switch (libinput_event_get_type(generic_event)) {
-		case LIBINPUT_EVENT_DEVICE_ADDED:
-			device = libinput_event_get_device(generic_event);
-			update_capabilities(seat, device_capabilities(device));
-			if (swc.manager->new_device)
-				swc.manager->new_device(device);
-			break;
-		case LIBINPUT_EVENT_KEYBOARD_KEY:
-			event.k = libinput_event_get_keyboard_event(generic_event);
-			time = libinput_event_keyboard_get_time(event.k);
-			key = libinput_event_keyboard_get_key(event.k);
-			state = libinput_event_keyboard_get_key_state(event.k);
-			keyboard_handle_key(seat->base.keyboard, time, key, state);
-			break;
-		case LIBINPUT_EVENT_POINTER_MOTION:
-			event.p = libinput_event_get_pointer_event(generic_event);
-			time = libinput_event_pointer_get_time(event.p);
-			x = wl_fixed_from_double(libinput_event_pointer_get_dx(event.p));
-			y = wl_fixed_from_double(libinput_event_pointer_get_dy(event.p));
-			pointer_handle_relative_motion(&seat->pointer, time, x, y);
-			pointer_handle_frame(&seat->pointer);
-			break;
-		case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
-			screen = wl_container_of(swc.screens.next, screen, link);
-			rect = &screen->base.geometry;
-			event.p = libinput_event_get_pointer_event(generic_event);
-			time = libinput_event_pointer_get_time(event.p);
-			x = wl_fixed_from_double(libinput_event_pointer_get_absolute_x_transformed(event.p, rect->width));
-			y = wl_fixed_from_double(libinput_event_pointer_get_absolute_y_transformed(event.p, rect->height));
-			pointer_handle_absolute_motion(&seat->pointer, time, x, y);
-			pointer_handle_frame(&seat->pointer);
+	if (queued)
+		eventfd_write(seat->input.event_fd, 1);
+}
+
+static void *
+run_input_thread(void *data)
+{
+	struct seat *seat = data;
+	struct pollfd fds[] = {
+		{.fd = libinput_get_fd(seat->libinput), .events = POLLIN},
+		{.fd = seat->input.wake_fd, .events = POLLIN},
+	};
+	eventfd_t value;
+	bool suspended = !swc.active;
+
+	for (;;) {
+		if (poll(fds, ARRAY_LENGTH(fds), -1) == -1 && errno != EINTR) {
+			ERROR("Could not poll input: %s\n", strerror(errno));
 			break;
-		case LIBINPUT_EVENT_POINTER_BUTTON:
-			event.p = libinput_event_get_pointer_event(generic_event);
-			time = libinput_event_pointer_get_time(event.p);
-			key = libinput_event_pointer_get_button(event.p);
-			state = libinput_event_pointer_get_button_state(event.p);
-			pointer_handle_button(&seat->pointer, time, key, state);
-			if (state == LIBINPUT_BUTTON_STATE_PRESSED) {
-		                /* qemu generates GEAR_UP/GEAR_DOWN events on scroll, so pass
-				 * those through as axis events. */
-				source = WL_POINTER_AXIS_SOURCE_WHEEL;
-				switch (key) {
-				case BTN_GEAR_DOWN:
-					pointer_handle_axis(&seat->pointer, time, WL_POINTER_AXIS_VERTICAL_SCROLL, source, wl_fixed_from_int(10), 120);
-					break;
-				case BTN_GEAR_UP:
-					pointer_handle_axis(&seat->pointer, time, WL_POINTER_AXIS_VERTICAL_SCROLL, source, wl_fixed_from_int(-10), -120);
-					break;
-				}
-			}
-			pointer_handle_frame(&seat->pointer);
+		}
+		if (fds[1].revents & POLLIN)
+			eventfd_read(seat->input.wake_fd, &value);
+
+		pthread_mutex_lock(&seat->input.mutex);
+		while (seat->input.pause && !seat->input.quit) {
+			seat->input.paused = true;
+			pthread_cond_broadcast(&seat->input.cond);
+			pthread_cond_wait(&seat->input.cond, &seat->input.mutex);
+		}
+		seat->input.paused = false;
+		if (seat->input.quit) {
+			pthread_mutex_unlock(&seat->input.mutex);
 			break;
-		case LIBINPUT_EVENT_POINTER_SCROLL_WHEEL:
+		}
+		if (seat->input.suspend != suspended) {
+			suspended = seat->input.suspend;
+			pthread_mutex_unlock(&seat->input.mutex);
+			if (suspended)
+				libinput_suspend(seat->libinput);
+			else if (libinput_resume(seat->libinput) != 0)
+				WARNING("Failed to resume libinput context\n");
+		} else {
+			pthread_mutex_unlock(&seat->input.mutex);
+		}
+
+		read_events(seat);
+	}
+
+	pthread_mutex_lock(&seat->input.mutex);
+	seat->input.exited = true;
+	pthread_cond_broadcast(&seat->input.cond);
+	pthread_mutex_unlock(&seat->input.mutex);
+
+	return NULL;
+}
+
+static void
+set_input_suspended(struct seat *seat, bool suspend)
+{
+	pthread_mutex_lock(&seat->input.mutex);
+	seat->input.suspend = suspend;
+	eventfd_write(seat->input.wake_fd, 1);
+	pthread_mutex_unlock(&seat->input.mutex);
+}
+
+static void
+send_relative_motion(struct seat *seat, struct queued_event *event)
+{
+	relative_pointer_send_motion(&seat->pointer, event->time,
+	                             wl_fixed_from_double(event->motion.x), wl_fixed_from_double(event->motion.y),
+	                             wl_fixed_from_double(event->motion.dx_unaccel), wl_fixed_from_double(event->motion.dy_unaccel));
+}
+
+/**
+ * Handle an event, which was coalesced from the queued events from first up
+ * to end.
+ */
+static void
+handle_event(struct seat *seat, struct queued_event *event, uint32_t first, uint32_t end)
+{
+	struct screen *screen;
+	struct swc_rectangle *rect;
+	enum wl_pointer_axis_source source;
+	uint32_t time = event->time / 1000;
+
+	latency_set_input_time(event->type == LIBINPUT_EVENT_DEVICE_ADDED ? 0 : event->time);
+	switch (event->type) {
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+		update_capabilities(seat, event->device.capabilities);
+		pause_input_thread(seat);
+		if (swc.manager->new_device)
+			swc.manager->new_device(event->device.device);
+		libinput_device_unref(event->device.device);
+		resume_input_thread(seat);
+		break;
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		keyboard_handle_key(seat->base.keyboard, time, event->key.value, event->key.state);
+		break;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		pointer_handle_relative_motion(&seat->pointer, time, wl_fixed_from_double(event->motion.x), wl_fixed_from_double(event->motion.y));
+		/* Send each delta to the client that the motion moved the focus to,
+		 * in the same frame. */
+		for (; first != end; ++first)
+			send_relative_motion(seat, &seat->input.events[first % ARRAY_LENGTH(seat->input.events)]);
+		pointer_handle_frame(&seat->pointer);
+		break;
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+		screen = wl_container_of(swc.screens.next, screen, link);
+		rect = &screen->base.geometry;
+		pointer_handle_absolute_motion(&seat->pointer, time, wl_fixed_from_double(event->motion.x * rect->width),
+		                               wl_fixed_from_double(event->motion.y * rect->height));
+		pointer_handle_frame(&seat->pointer);
+		break;
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+		pointer_handle_button(&seat->pointer, time, event->key.value, event->key.state);
+		if (event->key.state == LIBINPUT_BUTTON_STATE_PRESSED) {
+			/* qemu generates GEAR_UP/GEAR_DOWN events on scroll, so pass
+			 * those through as axis events. */
 			source = WL_POINTER_AXIS_SOURCE_WHEEL;
-			goto scroll;
-		case LIBINPUT_EVENT_POINTER_SCROLL_FINGER:
-			source = WL_POINTER_AXIS_SOURCE_FINGER;
-			goto scroll;
-		case LIBINPUT_EVENT_POINTER_SCROLL_CONTINUOUS:
-			source = WL_POINTER_AXIS_SOURCE_CONTINUOUS;
-			goto scroll;
-		scroll:
-			event.p = libinput_event_get_pointer_event(generic_event);
-			time = libinput_event_pointer_get_time(event.p);
-			value120 = 0;
-			if (libinput_event_pointer_has_axis(event.p, LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL)) {
-				value = wl_fixed_from_double(libinput_event_pointer_get_scroll_value(event.p, LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL));
-				if (source == WL_POINTER_AXIS_SOURCE_WHEEL)
-					value120 = libinput_event_pointer_get_scroll_value_v120(event.p, LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL);
-				pointer_handle_axis(&seat->pointer, time, WL_POINTER_AXIS_VERTICAL_SCROLL, source, value, value120);
-			}
-			if (libinput_event_pointer_has_axis(event.p, LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL)) {
-				value = wl_fixed_from_double(libinput_event_pointer_get_scroll_value(event.p, LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL));
-				if (source == WL_POINTER_AXIS_SOURCE_WHEEL)
-					value120 = libinput_event_pointer_get_scroll_value_v120(event.p, LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL);
-				pointer_handle_axis(&seat->pointer, time, WL_POINTER_AXIS_HORIZONTAL_SCROLL, source, value, value120);
+			switch (event->key.value) {
+			case BTN_GEAR_DOWN:
+				pointer_handle_axis(&seat->pointer, time, WL_POINTER_AXIS_VERTICAL_SCROLL, source, wl_fixed_from_int(10), 120);
+				break;
+			case BTN_GEAR_UP:
+				pointer_handle_axis(&seat->pointer, time, WL_POINTER_AXIS_VERTICAL_SCROLL, source, wl_fixed_from_int(-10), -120);
+				break;
 			}
-			pointer_handle_frame(&seat->pointer);
-			break;
-		default:
-			break;
 		}
+		pointer_handle_frame(&seat->pointer);
+		break;
+	case LIBINPUT_EVENT_POINTER_SCROLL_WHEEL:
+		source = WL_POINTER_AXIS_SOURCE_WHEEL;
+		goto scroll;
+	case LIBINPUT_EVENT_POINTER_SCROLL_FINGER:
+		source = WL_POINTER_AXIS_SOURCE_FINGER;
+		goto scroll;
+	case LIBINPUT_EVENT_POINTER_SCROLL_CONTINUOUS:
+		source = WL_POINTER_AXIS_SOURCE_CONTINUOUS;
+		goto scroll;
+	scroll:
+		if (event->scroll.vertical) {
+			pointer_handle_axis(&seat->pointer, time, WL_POINTER_AXIS_VERTICAL_SCROLL, source,
+			                    wl_fixed_from_double(event->scroll.value[0]),
+			                    source == WL_POINTER_AXIS_SOURCE_WHEEL ? event->scroll.value120[0] : 0);
+		}
+		if (event->scroll.horizontal) {
+			pointer_handle_axis(&seat->pointer, time, WL_POINTER_AXIS_HORIZONTAL_SCROLL, source,
+			                    wl_fixed_from_double(event->scroll.value[1]),
+			                    source == WL_POINTER_AXIS_SOURCE_WHEEL ? event->scroll.value120[1] : 0);
+		}
+		pointer_handle_frame(&seat->pointer);
+		break;
+	default:
+		break;
+	}
+	latency_set_input_time(0);
+}
 
-		libinput_event_destroy(generic_event);
+/**
+ * Fold the next queued event into a pointer motion or scroll event, if it is
+ * of the same kind, so that a run of them is handled as a single event.
+ *
+ * The earlier event's time is kept, so that latency is measured from the
+ * first input of the run.
+ */
+static bool
+coalesce_event(struct queued_event *event, const struct queued_event *next)
+{
+	int i;
+
+	if (next->type != event->type)
+		return false;
+
+	switch (event->type) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		/* Sum the deltas before converting them to fixed-point, so that
+		 * many small motions do not lose precision. */
+		event->motion.x += next->motion.x;
+		event->motion.y += next->motion.y;
+		break;
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+		event->motion.x = next->motion.x;
+		event->motion.y = next->motion.y;
+		break;
+	case LIBINPUT_EVENT_POINTER_SCROLL_WHEEL:
+	case LIBINPUT_EVENT_POINTER_SCROLL_FINGER:
+	case LIBINPUT_EVENT_POINTER_SCROLL_CONTINUOUS:
+		/* A scroll that starts or stops on an axis ends the run, since a
+		 * value of 0 tells clients that scrolling has stopped. */
+		if (next->scroll.vertical != event->scroll.vertical || next->scroll.horizontal != event->scroll.horizontal)
+			return false;
+		if (event->scroll.vertical && (event->scroll.value[0] == 0 || next->scroll.value[0] == 0))
+			return false;
+		if (event->scroll.horizontal && (event->scroll.value[1] == 0 || next->scroll.value[1] == 0))
+			return false;
+		for (i = 0; i < 2; ++i) {
+			event->scroll.value[i] += next->scroll.value[i];
+			event->scroll.value120[i] += next->scroll.value120[i];
+		}
+		break;
+	default:
+		return false;
 	}
 
+	return true;
+}
+
+static int
+handle_input_events(int fd, uint32_t mask, void *data)
+{
+	struct seat *seat = data;
+	struct queued_event *event, merged;
+	eventfd_t value;
+	uint32_t head, tail, next;
+
+	eventfd_read(fd, &value);
+
+	pthread_mutex_lock(&seat->input.mutex);
+	if (seat->input.open.pending)
+		open_device(seat);
+	pthread_mutex_unlock(&seat->input.mutex);
+
+	TRACE_BEGIN("handle_input_events");
+	head = atomic_load_explicit(&seat->input.head, memory_order_relaxed);
+	tail = atomic_load_explicit(&seat->input.tail, memory_order_acquire);
+	while (head != tail) {
+		event = &seat->input.events[head % ARRAY_LENGTH(seat->input.events)];
+		merged = *event;
+		for (next = head + 1; next != tail; ++next) {
+			event = &seat->input.events[next % ARRAY_LENGTH(seat->input.events)];
+			if (!coalesce_event(&merged, event))
+				break;
+		}
+		handle_event(seat, &merged, head, next);
+		head = next;
+		atomic_store(&seat->input.head, head);
+	}
+	if (atomic_exchange(&seat->input.full, false))
+		eventfd_write(seat->input.wake_fd, 1);
+	TRACE_END();
+
 	return 0;
 }
 
+static bool
+start_input_thread(struct seat *seat)
+{
+	struct sched_param param;
+	const char *priority;
+	sigset_t mask, old_mask;
+	int ret;
+
+	seat->input.event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (seat->input.event_fd == -1)
+		goto error0;
+	seat->input.wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (seat->input.wake_fd == -1)
+		goto error1;
+	seat->input.source = dispatch_add_fd("libinput", seat->input.event_fd, WL_EVENT_READABLE, &handle_input_events, seat);
+	if (!seat->input.source)
+		goto error2;
+
+	pthread_mutex_init(&seat->input.mutex, NULL);
+	pthread_cond_init(&seat->input.cond, NULL);
+	atomic_init(&seat->input.head, 0);
+	atomic_init(&seat->input.tail, 0);
+	atomic_init(&seat->input.full, false);
+	seat->input.open.pending = false;
+	seat->input.pause = false;
+	seat->input.paused = false;
+	seat->input.suspend = !swc.active;
+	seat->input.quit = false;
+	seat->input.exited = false;
+
+	/* Signals are handled by the main thread. */
+	sigfillset(&mask);
+	pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+	ret = pthread_create(&seat->input.thread, NULL, &run_input_thread, seat);
+	pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+	if (ret != 0) {
+		ERROR("Could not create input thread: %s\n", strerror(ret));
+		goto error3;
+	}
+
+	if ((priority = getenv("SWC_INPUT_PRIORITY"))) {
+		param.sched_priority = atoi(priority);
+		if ((ret = pthread_setschedparam(seat->input.thread, SCHED_FIFO, &param)) != 0)
+			WARNING("Could not set input thread priority: %s\n", strerror(ret));
+	}
+
+	return true;
+
+error3:
+	pthread_cond_destroy(&seat->input.cond);
+	pthread_mutex_destroy(&seat->input.mutex);
+	dispatch_remove(seat->input.source);
+error2:
+	close(seat->input.wake_fd);
+error1:
+	close(seat->input.event_fd);
+error0:
+	return false;
+}
+
+static void
+stop_input_thread(struct seat *seat)
+{
+	struct queued_event *event;
+	uint32_t head, tail;
+
+	pthread_mutex_lock(&seat->input.mutex);
+	seat->input.quit = true;
+	eventfd_write(seat->input.wake_fd, 1);
+	pthread_cond_broadcast(&seat->input.cond);
+	while (!seat->input.exited) {
+		if (seat->input.open.pending)
+			open_device(seat);
+		else
+			pthread_cond_wait(&seat->input.cond, &seat->input.mutex);
+	}
+	pthread_mutex_unlock(&seat->input.mutex);
+	pthread_join(seat->input.thread, NULL);
+
+	/* Release any devices left in the queue. */
+	head = atomic_load(&seat->input.head);
+	tail = atomic_load(&seat->input.tail);
+	for (; head != tail; ++head) {
+		event = &seat->input.events[head % ARRAY_LENGTH(seat->input.events)];
+		if (event->type == LIBINPUT_EVENT_DEVICE_ADDED)
+			libinput_device_unref(event->device.device);
+	}
+
+	pthread_cond_destroy(&seat->input.cond);
+	pthread_mutex_destroy(&seat->input.mutex);
+	dispatch_remove(seat->input.source);
+	close(seat->input.wake_fd);
+	close(seat->input.event_fd);
+}
+
+/* }}} */
+
+static void
+handle_swc_event(struct wl_listener *listener, void *data)
+{
+	struct seat *seat = wl_container_of(listener, seat, swc_listener);
+	struct event *ev = data;
+
+	switch (ev->type) {
+	case SWC_EVENT_DEACTIVATED:
+		if (seat->libinput)
+			set_input_suspended(seat, true);
+		keyboard_reset(seat->base.keyboard);
+		break;
+	case SWC_EVENT_ACTIVATED:
+		if (seat->libinput)
+			set_input_suspended(seat, false);
+		break;
+	}
+}
+
 bool
 initialize_libinput(struct seat *seat)
 {
+	/* Devices opened while creating the context are opened directly. */
+	seat->input.main_thread = pthread_self();
+
 #ifdef ENABLE_LIBUDEV
 	if (!(seat->udev = udev_new())) {
 		ERROR("Could not create udev context\n");
 		goto error0;
 	}
 
-	seat->libinput = libinput_udev_create_context(&libinput_interface, NULL, seat->udev);
+	seat->libinput = libinput_udev_create_context(&libinput_interface, seat, seat->udev);
 #else
-	seat->libinput = libinput_netlink_create_context(&libinput_interface, NULL, NETLINK_MASK);
+	seat->libinput = libinput_netlink_create_context(&libinput_interface, seat, NETLINK_MASK);
 #endif
 
 	if (!seat->libinput) {
@@ -365,15 +849,14 @@ initialize_libinput(struct seat *seat)
 	}
 #endif
 
-	seat->libinput_source = wl_event_loop_add_fd(swc.event_loop, libinput_get_fd(seat->libinput), WL_EVENT_READABLE, &handle_libinput_data, seat);
-	if (!seat->libinput_source) {
-		ERROR("Could not create event source for libinput\n");
-		goto error2;
-	}
-
 	if (!swc.active)
 		libinput_suspend(seat->libinput);
 
+	if (!start_input_thread(seat)) {
+		ERROR("Could not start input thread\n");
+		goto error2;
+	}
+
 	return true;
 
 error2:
@@ -430,7 +913,9 @@ seat_create(struct wl_display *display, const char *seat_name)
 	}
 	seat->base.pointer = &seat->pointer;
 
-	if (!initialize_libinput(seat))
+	/* Headless screens have no input devices to go with them. */
+	seat->libinput = NULL;
+	if (swc.backend == SWC_BACKEND_DRM && !initialize_libinput(seat))
 		goto error6;
 
 	return &seat->base;
@@ -456,11 +941,13 @@ seat_destroy(struct swc_seat *seat_base)
 {
 	struct seat *seat = wl_container_of(seat_base, seat, base);
 
-	wl_event_source_remove(seat->libinput_source);
-	libinput_unref(seat->libinput);
+	if (seat->libinput) {
+		stop_input_thread(seat);
+		libinput_unref(seat->libinput);
 #ifdef ENABLE_LIBUDEV
-	udev_unref(seat->udev);
+		udev_unref(seat->udev);
 #endif
+	}
 
 	pointer_finalize(&seat->pointer);
 	keyboard_destroy(seat->base.keyboard);
@@ -470,3 +957,11 @@ seat_destroy(struct swc_seat *seat_base)
 	free(seat->name);
 	free(seat);
 }
+
+void
+seat_add_capabilities(struct swc_seat *seat_base, uint32_t capabilities)
+{
+	struct seat *seat = wl_container_of(seat_base, seat, base);
+
+	update_capabilities(seat, capabilities);
+}
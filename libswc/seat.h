@@ -24,6 +24,8 @@
 #ifndef SWC_SEAT_H
 #define SWC_SEAT_H
 
+#include <stdint.h>
+
 struct wl_display;
 
 struct swc_seat {
@@ -35,4 +37,10 @@ struct swc_seat {
 struct swc_seat *seat_create(struct wl_display *display, const char *name);
 void seat_destroy(struct swc_seat *seat);
 
+/**
+ * Advertise input capabilities provided by something other than the seat's
+ * own devices.
+ */
+void seat_add_capabilities(struct swc_seat *seat, uint32_t capabilities);
+
 #endif
@@ -27,6 +27,7 @@
 
 #include "shm.h"
 #include "internal.h"
+#include "stats.h"
 #include "util.h"
 #include "wayland_buffer.h"
 
@@ -44,6 +45,7 @@ struct pool {
 	void *data;
 	uint32_t size;
 	unsigned references;
+	struct stats_charge charge;
 };
 
 struct pool_reference {
@@ -68,6 +70,7 @@ unref_pool(struct pool *pool)
 		return;
 
 	munmap(pool->data, pool->size);
+	stats_uncharge(&pool->charge);
 	free(pool);
 }
 
@@ -148,8 +151,13 @@ resize(struct wl_client *client, struct wl_resource *resource, int32_t size)
 	struct pool *pool = wl_resource_get_user_data(resource);
 	void *data;
 
+	if (!stats_recharge(&pool->charge, size)) {
+		wl_resource_post_no_memory(resource);
+		return;
+	}
 	data = swc_mremap(pool->data, pool->size, size);
 	if (data == MAP_FAILED) {
+		stats_recharge(&pool->charge, pool->size);
 		wl_resource_post_error(resource, WL_SHM_ERROR_INVALID_FD, "mremap failed: %s", strerror(errno));
 		return;
 	}
@@ -169,7 +177,7 @@ create_pool(struct wl_client *client, struct wl_resource *resource, uint32_t id,
 	struct swc_shm *shm = wl_resource_get_user_data(resource);
 	struct pool *pool;
 
-	pool = malloc(sizeof(*pool));
+	pool = calloc(1, sizeof(*pool));
 	if (!pool) {
 		wl_resource_post_no_memory(resource);
 		goto error0;
@@ -189,6 +197,10 @@ create_pool(struct wl_client *client, struct wl_resource *resource, uint32_t id,
 	close(fd);
 	pool->size = size;
 	pool->references = 1;
+	if (!stats_charge(&pool->charge, client, STATS_POOL, size)) {
+		wl_resource_post_no_memory(resource);
+		wl_resource_destroy(pool->resource);
+	}
 	return;
 
 error2:
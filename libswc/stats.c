@@ -0,0 +1,669 @@
+/* swc: libswc/stats.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "stats.h"
+#include "dispatch.h"
+#include "internal.h"
+#include "latency.h"
+#include "screen.h"
+#include "util.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <wayland-server.h>
+#include "swc-server-protocol.h"
+
+/* The shortest interval between reports, in milliseconds. */
+#define MIN_INTERVAL 100
+
+struct message_stats {
+	const struct wl_message *message;
+	const char *interface;
+	uint32_t opcode;
+	bool event;
+	uint64_t count, time;
+};
+
+struct client {
+	struct client_stats stats;
+	struct wl_client *client;
+	struct wl_listener destroy_listener;
+	struct wl_list link;
+
+	/* Calls client_over_limit once the current request is done. */
+	struct wl_event_source *over_limit_idle;
+
+	/* An open-addressed hash table of the requests and events seen, keyed by
+	 * their message. */
+	struct message_stats *messages;
+	uint32_t num_messages, messages_capacity;
+};
+
+struct subscription {
+	struct wl_resource *resource;
+	struct wl_event_source *timer;
+	uint32_t interval;
+	struct wl_list link;
+};
+
+static struct {
+	struct wl_global *global;
+	struct wl_listener client_created_listener;
+	struct wl_list clients;
+	struct wl_list subscriptions;
+	uint32_t next_client;
+
+	const char *page_path;
+	struct swc_stats_page *page;
+	size_t page_size;
+
+	struct swc_client_usage soft_limits, hard_limits;
+
+	/* Only installed while a subscription wants message statistics. */
+	struct wl_protocol_logger *logger;
+	uint32_t message_subscriptions;
+	/* Whether a report is being sent, whose events are not counted. */
+	bool reporting;
+
+	/* The request being handled, if any. libwayland has no hook for the end
+	 * of a request, so it ends when the next one starts, another event
+	 * source is dispatched, or the event loop goes idle. */
+	struct {
+		struct client *client;
+		const struct wl_message *message;
+		uint64_t start;
+		bool idle_pending;
+	} request;
+} stats;
+
+struct stats_totals stats_totals;
+
+static void
+handle_client_destroy(struct wl_listener *listener, void *data)
+{
+	struct client *client = wl_container_of(listener, client, destroy_listener);
+
+	if (stats.request.client == client)
+		stats_end_request();
+	if (client->over_limit_idle)
+		dispatch_remove(client->over_limit_idle);
+	wl_list_remove(&client->link);
+	wl_array_release(&client->stats.pending_input);
+	free(client->messages);
+	free(client);
+}
+
+static void
+handle_client_created(struct wl_listener *listener, void *data)
+{
+	struct wl_client *wl_client = data;
+	struct client *client;
+
+	if (!(client = calloc(1, sizeof(*client)))) {
+		WARNING("Could not allocate client statistics\n");
+		return;
+	}
+	client->stats.id = stats.next_client++;
+	wl_array_init(&client->stats.pending_input);
+	client->client = wl_client;
+	client->destroy_listener.notify = &handle_client_destroy;
+	wl_client_add_destroy_listener(wl_client, &client->destroy_listener);
+	wl_list_insert(stats.clients.prev, &client->link);
+}
+
+static struct client *
+get_client(struct wl_client *wl_client)
+{
+	struct wl_listener *listener;
+	struct client *client;
+
+	/* The destroy listener is removed before the client's resources are
+	 * destroyed, so their destructors find nothing to update. */
+	if (!(listener = wl_client_get_destroy_listener(wl_client, &handle_client_destroy)))
+		return NULL;
+
+	return wl_container_of(listener, client, destroy_listener);
+}
+
+struct client_stats *
+stats_client(struct wl_client *wl_client)
+{
+	struct client *client = get_client(wl_client);
+
+	return client ? &client->stats : NULL;
+}
+
+EXPORT bool
+swc_client_get_usage(struct wl_client *client, struct swc_client_usage *usage)
+{
+	struct client_stats *stats;
+
+	if (!(stats = stats_client(client)))
+		return false;
+	*usage = stats->usage;
+
+	return true;
+}
+
+EXPORT void
+swc_set_client_limits(const struct swc_client_usage *soft, const struct swc_client_usage *hard)
+{
+	stats.soft_limits = soft ? *soft : (struct swc_client_usage){0};
+	stats.hard_limits = hard ? *hard : (struct swc_client_usage){0};
+}
+
+static bool
+over_limit(const struct swc_client_usage *usage, const struct swc_client_usage *limit)
+{
+#define OVER(field) (limit->field && usage->field > limit->field)
+	return OVER(pool_bytes) || OVER(dmabuf_bytes) || OVER(proxy_bytes)
+	    || OVER(pools) || OVER(dmabufs) || OVER(proxies) || OVER(buffers) || OVER(frame_callbacks);
+#undef OVER
+}
+
+/* Called once the request that put a client over a soft limit is handled. */
+static void
+notify_over_limit(void *data)
+{
+	struct client *client = data;
+
+	client->over_limit_idle = NULL;
+	if (client->stats.over_soft_limit)
+		swc.manager->client_over_limit(client->client, &client->stats.usage);
+}
+
+/* Add count objects and bytes of memory to a client's usage, unless this would
+ * put it over a hard limit. */
+static bool
+update_usage(struct wl_client *wl_client, enum stats_resource resource, int32_t count, int64_t bytes)
+{
+	struct client *client;
+	struct swc_client_usage usage;
+
+	if (!(client = get_client(wl_client)))
+		return true;
+
+	usage = client->stats.usage;
+	switch (resource) {
+	case STATS_POOL:
+		usage.pools += count;
+		usage.pool_bytes += bytes;
+		break;
+	case STATS_DMABUF:
+		usage.dmabufs += count;
+		usage.dmabuf_bytes += bytes;
+		break;
+	case STATS_PROXY:
+		usage.proxies += count;
+		usage.proxy_bytes += bytes;
+		break;
+	case STATS_BUFFER:
+		usage.buffers += count;
+		break;
+	case STATS_FRAME_CALLBACK:
+		usage.frame_callbacks += count;
+		break;
+	}
+
+	/* Releasing resources always succeeds, even if the limits were lowered
+	 * below what the client already uses. */
+	if ((count > 0 || bytes > 0) && over_limit(&usage, &stats.hard_limits))
+		return false;
+	client->stats.usage = usage;
+
+	if (!over_limit(&usage, &stats.soft_limits)) {
+		client->stats.over_soft_limit = false;
+	} else if (!client->stats.over_soft_limit) {
+		client->stats.over_soft_limit = true;
+		/* The manager may well destroy the client, which the request being
+		 * handled does not expect, so wait until it is done. */
+		if (swc.manager->client_over_limit && !client->over_limit_idle)
+			client->over_limit_idle = dispatch_add_idle("stats", &notify_over_limit, client);
+	}
+
+	return true;
+}
+
+static void
+handle_charged_client_destroy(struct wl_listener *listener, void *data)
+{
+	struct stats_charge *charge = wl_container_of(listener, charge, client_destroy_listener);
+
+	wl_list_remove(&charge->client_destroy_listener.link);
+	charge->client = NULL;
+}
+
+bool
+stats_charge(struct stats_charge *charge, struct wl_client *client, enum stats_resource resource, uint64_t bytes)
+{
+	charge->client = NULL;
+	charge->resource = resource;
+	charge->bytes = bytes;
+
+	if (!update_usage(client, resource, 1, bytes))
+		return false;
+	charge->client = client;
+	charge->client_destroy_listener.notify = &handle_charged_client_destroy;
+	wl_client_add_destroy_listener(client, &charge->client_destroy_listener);
+
+	return true;
+}
+
+bool
+stats_recharge(struct stats_charge *charge, uint64_t bytes)
+{
+	if (charge->client && !update_usage(charge->client, charge->resource, 0, (int64_t)(bytes - charge->bytes)))
+		return false;
+	charge->bytes = bytes;
+
+	return true;
+}
+
+void
+stats_uncharge(struct stats_charge *charge)
+{
+	if (!charge->client)
+		return;
+	update_usage(charge->client, charge->resource, -1, -(int64_t)charge->bytes);
+	wl_list_remove(&charge->client_destroy_listener.link);
+	charge->client = NULL;
+}
+
+bool
+stats_add(struct wl_client *client, enum stats_resource resource)
+{
+	return update_usage(client, resource, 1, 0);
+}
+
+void
+stats_remove(struct wl_client *client, enum stats_resource resource)
+{
+	update_usage(client, resource, -1, 0);
+}
+
+/* Protocol profiling {{{ */
+
+static struct message_stats *
+find_message(struct client *client, const struct wl_message *message)
+{
+	uint32_t mask = client->messages_capacity - 1, i;
+	struct message_stats *entry;
+
+	for (i = ((uintptr_t)message >> 3) * 2654435761u & mask;; i = (i + 1) & mask) {
+		entry = &client->messages[i];
+		if (!entry->message || entry->message == message)
+			return entry;
+	}
+}
+
+static bool
+grow_messages(struct client *client)
+{
+	struct message_stats *old = client->messages;
+	uint32_t i, old_capacity = client->messages_capacity;
+
+	client->messages_capacity = old_capacity ? old_capacity * 2 : 32;
+	if (!(client->messages = calloc(client->messages_capacity, sizeof(*client->messages)))) {
+		client->messages = old;
+		client->messages_capacity = old_capacity;
+		return false;
+	}
+	for (i = 0; i < old_capacity; ++i) {
+		if (old[i].message)
+			*find_message(client, old[i].message) = old[i];
+	}
+	free(old);
+
+	return true;
+}
+
+static struct message_stats *
+add_message(struct client *client, const struct wl_protocol_logger_message *message, bool event)
+{
+	struct message_stats *entry;
+
+	/* Keep the table at most three quarters full. */
+	if ((client->num_messages + 1) * 4 > client->messages_capacity * 3 && !grow_messages(client))
+		return NULL;
+
+	entry = find_message(client, message->message);
+	if (!entry->message) {
+		entry->message = message->message;
+		entry->interface = wl_resource_get_class(message->resource);
+		entry->opcode = message->message_opcode;
+		entry->event = event;
+		++client->num_messages;
+	}
+
+	return entry;
+}
+
+void
+stats_end_request(void)
+{
+	if (!stats.request.client)
+		return;
+	find_message(stats.request.client, stats.request.message)->time += get_monotonic_ns() - stats.request.start;
+	stats.request.client = NULL;
+}
+
+static void
+handle_idle(void *data)
+{
+	stats.request.idle_pending = false;
+	stats_end_request();
+}
+
+static void
+log_message(void *data, enum wl_protocol_logger_type type, const struct wl_protocol_logger_message *message)
+{
+	struct client *client;
+	struct message_stats *entry;
+	bool event = type == WL_PROTOCOL_LOGGER_EVENT;
+
+	if (event && stats.reporting)
+		return;
+	if (!event)
+		stats_end_request();
+
+	if (!(client = get_client(wl_resource_get_client(message->resource))))
+		return;
+	if (!(entry = add_message(client, message, event)))
+		return;
+	++entry->count;
+
+	if (event)
+		return;
+	stats.request.client = client;
+	stats.request.message = message->message;
+	stats.request.start = get_monotonic_ns();
+	if (!stats.request.idle_pending && dispatch_add_idle("stats", &handle_idle, NULL))
+		stats.request.idle_pending = true;
+}
+
+static void
+send_messages(struct subscription *subscription, struct client *client)
+{
+	struct message_stats *entry;
+	uint32_t i;
+
+	for (i = 0; i < client->messages_capacity; ++i) {
+		entry = &client->messages[i];
+		if (!entry->message)
+			continue;
+		swc_stats_send_message(subscription->resource, client->stats.id,
+		                       entry->event ? SWC_STATS_MESSAGE_TYPE_EVENT : SWC_STATS_MESSAGE_TYPE_REQUEST,
+		                       entry->interface, entry->opcode, entry->message->name,
+		                       entry->count, entry->time >> 32, entry->time & 0xffffffff);
+	}
+}
+
+/* }}} */
+
+static void
+send_report(struct subscription *subscription)
+{
+	struct wl_client *wl_client = wl_resource_get_client(subscription->resource);
+	struct wl_resource *screen_resource;
+	struct screen *screen;
+	struct client *client;
+	struct wl_array histogram;
+	bool send_message = wl_resource_get_version(subscription->resource) >= 2;
+	enum latency_input input;
+	pid_t pid;
+
+	stats.reporting = true;
+	wl_list_for_each (screen, &swc.screens, link) {
+		screen_resource = wl_resource_find_for_client(&screen->resources, wl_client);
+		swc_stats_send_screen(subscription->resource, screen->id, screen_resource,
+		                      screen->stats.frames, screen->stats.missed_vblanks,
+		                      screen->stats.composite_time >> 32, screen->stats.composite_time & 0xffffffff);
+	}
+
+	wl_list_for_each (client, &stats.clients, link) {
+		wl_client_get_credentials(client->client, &pid, NULL, NULL);
+		swc_stats_send_client(subscription->resource, client->stats.id, pid, client->stats.commits,
+		                      client->stats.shm_bytes >> 32, client->stats.shm_bytes & 0xffffffff,
+		                      client->stats.usage.buffers, client->stats.usage.frame_callbacks);
+		if (send_message)
+			send_messages(subscription, client);
+	}
+
+	if (wl_resource_get_version(subscription->resource) >= 3) {
+		for (input = 0; input < NUM_LATENCY_INPUTS; ++input) {
+			histogram.size = histogram.alloc = sizeof(latency_histograms[input]);
+			histogram.data = latency_histograms[input];
+			swc_stats_send_latency(subscription->resource, input, &histogram);
+		}
+	}
+
+	swc_stats_send_done(subscription->resource, get_monotonic_ns() / 1000000);
+	stats.reporting = false;
+}
+
+static int
+handle_timer(void *data)
+{
+	struct subscription *subscription = data;
+
+	send_report(subscription);
+	wl_event_source_timer_update(subscription->timer, subscription->interval);
+
+	return 0;
+}
+
+static const struct swc_stats_interface stats_impl = {
+	.destroy = destroy_resource,
+};
+
+static void
+destroy_subscription(struct wl_resource *resource)
+{
+	struct subscription *subscription = wl_resource_get_user_data(resource);
+
+	wl_list_remove(&subscription->link);
+	dispatch_remove(subscription->timer);
+	if (wl_resource_get_version(resource) >= 2 && --stats.message_subscriptions == 0 && stats.logger) {
+		stats_end_request();
+		wl_protocol_logger_destroy(stats.logger);
+		stats.logger = NULL;
+	}
+	free(subscription);
+}
+
+static void
+subscribe(struct wl_client *client, struct wl_resource *resource, uint32_t id, uint32_t interval)
+{
+	struct subscription *subscription;
+
+	if (!(subscription = malloc(sizeof(*subscription))))
+		goto error0;
+	subscription->resource = wl_resource_create(client, &swc_stats_interface, wl_resource_get_version(resource), id);
+	if (!subscription->resource)
+		goto error1;
+	subscription->timer = dispatch_add_timer("stats", &handle_timer, subscription);
+	if (!subscription->timer)
+		goto error2;
+	subscription->interval = MAX(interval, MIN_INTERVAL);
+	wl_resource_set_implementation(subscription->resource, &stats_impl, subscription, &destroy_subscription);
+	wl_list_insert(&stats.subscriptions, &subscription->link);
+	if (wl_resource_get_version(subscription->resource) >= 2 && stats.message_subscriptions++ == 0) {
+		stats.logger = wl_display_add_protocol_logger(swc.display, &log_message, NULL);
+		if (!stats.logger)
+			WARNING("Could not add protocol logger; messages will not be counted\n");
+	}
+	wl_event_source_timer_update(subscription->timer, subscription->interval);
+	return;
+
+error2:
+	wl_resource_destroy(subscription->resource);
+error1:
+	free(subscription);
+error0:
+	wl_resource_post_no_memory(resource);
+}
+
+static const struct swc_stats_manager_interface stats_manager_impl = {
+	.subscribe = subscribe,
+	.destroy = destroy_resource,
+};
+
+static void
+bind_stats_manager(struct wl_client *client, void *data, uint32_t version, uint32_t id)
+{
+	struct wl_resource *resource;
+
+	resource = wl_resource_create(client, &swc_stats_manager_interface, version, id);
+	if (!resource) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &stats_manager_impl, NULL, NULL);
+
+	if (!swc.manager->allow_stats || !swc.manager->allow_stats(client)) {
+		wl_resource_post_error(resource, SWC_STATS_MANAGER_ERROR_PERMISSION_DENIED,
+		                       "client is not allowed to see statistics");
+	}
+}
+
+void
+stats_publish(void)
+{
+	struct swc_stats_page *page = stats.page;
+	uint32_t sequence;
+
+	if (!page)
+		return;
+
+	sequence = page->sequence;
+	__atomic_store_n(&page->sequence, sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	page->time = get_monotonic_ns();
+	page->frames = stats_totals.frames;
+	page->missed_vblanks = stats_totals.missed_vblanks;
+	page->damage_pixels = stats_totals.damage_pixels;
+	page->update_time = stats_totals.update_time;
+	page->damage_time = stats_totals.damage_time;
+	page->repaint_time = stats_totals.repaint_time;
+	page->flush_time = stats_totals.flush_time;
+	page->shm_bytes = stats_totals.shm_bytes;
+	page->buffer_bytes = stats_totals.buffer_bytes;
+
+	__atomic_store_n(&page->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+static void
+create_page(const char *path)
+{
+	long page_size;
+	int fd;
+
+	page_size = sysconf(_SC_PAGESIZE);
+	stats.page_size = page_size > 0 ? (sizeof(*stats.page) + page_size - 1) / page_size * page_size : sizeof(*stats.page);
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd == -1) {
+		WARNING("Could not create statistics page '%s': %s\n", path, strerror(errno));
+		return;
+	}
+	if (ftruncate(fd, stats.page_size) != 0) {
+		WARNING("Could not resize statistics page: %s\n", strerror(errno));
+		goto error1;
+	}
+	stats.page = mmap(NULL, stats.page_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (stats.page == MAP_FAILED) {
+		WARNING("Could not map statistics page: %s\n", strerror(errno));
+		stats.page = NULL;
+		goto error1;
+	}
+	close(fd);
+
+	stats.page->magic = SWC_STATS_PAGE_MAGIC;
+	stats.page->version = SWC_STATS_PAGE_VERSION;
+	stats.page_path = path;
+	stats_publish();
+	return;
+
+error1:
+	close(fd);
+	unlink(path);
+}
+
+bool
+stats_initialize(void)
+{
+	const char *path;
+
+	stats.global = wl_global_create(swc.display, &swc_stats_manager_interface, 3, NULL, &bind_stats_manager);
+	if (!stats.global)
+		goto error0;
+
+	stats.logger = NULL;
+	stats.message_subscriptions = 0;
+
+	wl_list_init(&stats.clients);
+	wl_list_init(&stats.subscriptions);
+	stats.client_created_listener.notify = &handle_client_created;
+	wl_display_add_client_created_listener(swc.display, &stats.client_created_listener);
+
+	if ((path = getenv("SWC_STATS_PAGE")))
+		create_page(path);
+
+	return true;
+
+error0:
+	return false;
+}
+
+void
+stats_finalize(void)
+{
+	struct client *client, *next;
+	struct subscription *subscription, *next_subscription;
+
+	/* Their timers must not outlive the event sources. */
+	wl_list_for_each_safe (subscription, next_subscription, &stats.subscriptions, link)
+		wl_resource_destroy(subscription->resource);
+	stats_end_request();
+	wl_list_remove(&stats.client_created_listener.link);
+	wl_list_for_each_safe (client, next, &stats.clients, link) {
+		if (client->over_limit_idle)
+			dispatch_remove(client->over_limit_idle);
+		wl_list_remove(&client->destroy_listener.link);
+		wl_array_release(&client->stats.pending_input);
+		free(client->messages);
+		free(client);
+	}
+	wl_global_destroy(stats.global);
+
+	if (stats.page) {
+		munmap(stats.page, stats.page_size);
+		unlink(stats.page_path);
+		stats.page = NULL;
+	}
+}
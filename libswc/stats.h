@@ -0,0 +1,127 @@
+/* swc: libswc/stats.h
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SWC_STATS_H
+#define SWC_STATS_H
+
+#include "swc.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wayland-server.h>
+
+/* Counters are running totals, and are only updated on the main thread. */
+
+struct screen_stats {
+	uint32_t frames;
+	uint32_t missed_vblanks;
+	uint64_t composite_time;
+	/* When the frame waiting to be shown was submitted, in nanoseconds. */
+	uint64_t submit_time;
+};
+
+struct stats_totals {
+	uint64_t frames;
+	uint64_t missed_vblanks;
+	uint64_t damage_pixels;
+	uint64_t update_time;
+	uint64_t damage_time;
+	uint64_t repaint_time;
+	uint64_t flush_time;
+	uint64_t shm_bytes;
+	uint64_t buffer_bytes;
+};
+
+extern struct stats_totals stats_totals;
+
+struct client_stats {
+	uint32_t id;
+	uint32_t commits;
+	uint64_t shm_bytes;
+	struct swc_client_usage usage;
+	bool over_soft_limit;
+
+	/* Inputs sent to the client, waiting for its next commit. */
+	struct wl_array pending_input;
+};
+
+/**
+ * Get the statistics of a client, or NULL if the client is being destroyed.
+ */
+struct client_stats *stats_client(struct wl_client *client);
+
+enum stats_resource {
+	STATS_POOL,
+	STATS_DMABUF,
+	STATS_PROXY,
+	STATS_BUFFER,
+	STATS_FRAME_CALLBACK,
+};
+
+/* Memory charged to a client until it is released, which may be after the
+ * client is gone. */
+struct stats_charge {
+	struct wl_client *client;
+	struct wl_listener client_destroy_listener;
+	enum stats_resource resource;
+	uint64_t bytes;
+};
+
+/**
+ * Charge an object of the given size to a client.
+ *
+ * Returns false, without charging anything, if this would put the client over
+ * a hard limit. The caller should then fail the request with a no_memory
+ * error.
+ */
+bool stats_charge(struct stats_charge *charge, struct wl_client *client, enum stats_resource resource, uint64_t bytes);
+
+/**
+ * Change the size of a charged object, with the same limit as stats_charge.
+ */
+bool stats_recharge(struct stats_charge *charge, uint64_t bytes);
+void stats_uncharge(struct stats_charge *charge);
+
+/**
+ * Count an object without a size against a client, such as a wl_buffer or a
+ * frame callback, with the same limit as stats_charge.
+ */
+bool stats_add(struct wl_client *client, enum stats_resource resource);
+void stats_remove(struct wl_client *client, enum stats_resource resource);
+
+/**
+ * Finish timing the client request being handled, if any. This is called when
+ * another event source is dispatched.
+ */
+void stats_end_request(void);
+
+/**
+ * Copy the totals to the shared statistics page, if there is one.
+ */
+void stats_publish(void);
+
+bool stats_initialize(void);
+void stats_finalize(void);
+
+#endif
@@ -25,15 +25,31 @@
 #include "internal.h"
 #include "subcompositor.h"
 #include "subsurface.h"
+#include "surface.h"
 #include "util.h"
 
 static void
 get_subsurface(struct wl_client *client, struct wl_resource *resource,
                uint32_t id, struct wl_resource *surface_resource, struct wl_resource *parent_resource)
 {
+	struct surface *surface = wl_resource_get_user_data(surface_resource);
+	struct surface *parent = wl_resource_get_user_data(parent_resource);
+	struct surface *ancestor;
 	struct subsurface *subsurface;
 
-	subsurface = subsurface_new(client, wl_resource_get_version(resource), id);
+	if (surface->subsurface || surface->view) {
+		wl_resource_post_error(resource, WL_SUBCOMPOSITOR_ERROR_BAD_SURFACE, "surface already has a role");
+		return;
+	}
+
+	for (ancestor = parent; ancestor; ancestor = ancestor->subsurface ? ancestor->subsurface->parent : NULL) {
+		if (ancestor == surface) {
+			wl_resource_post_error(resource, WL_SUBCOMPOSITOR_ERROR_BAD_SURFACE, "surface is an ancestor of parent");
+			return;
+		}
+	}
+
+	subsurface = subsurface_new(client, wl_resource_get_version(resource), id, surface, parent);
 
 	if (!subsurface) {
 		wl_resource_post_no_memory(resource);
@@ -22,39 +22,249 @@
  */
 
 #include "subsurface.h"
+#include "compositor.h"
+#include "surface.h"
 #include "util.h"
+#include "view.h"
 
 #include <stdlib.h>
 #include <wayland-server.h>
 
+static struct compositor_view *stack_above(struct subsurface *subsurface, struct compositor_view *below);
+static struct compositor_view *stack_below(struct subsurface *subsurface, struct compositor_view *above);
+
+/**
+ * Stack the views of the subsurface tree rooted at subsurface directly above
+ * the view below, returning the top-most view of the tree.
+ */
+static struct compositor_view *
+stack_above(struct subsurface *subsurface, struct compositor_view *below)
+{
+	struct subsurface *child;
+
+	wl_list_for_each (child, &subsurface->surface->subsurfaces_below, link)
+		below = stack_above(child, below);
+	compositor_view_place_above(subsurface->view, below);
+	below = subsurface->view;
+	wl_list_for_each (child, &subsurface->surface->subsurfaces_above, link)
+		below = stack_above(child, below);
+
+	return below;
+}
+
+/**
+ * Stack the views of the subsurface tree rooted at subsurface directly below
+ * the view above, returning the bottom-most view of the tree.
+ */
+static struct compositor_view *
+stack_below(struct subsurface *subsurface, struct compositor_view *above)
+{
+	struct subsurface *child;
+
+	wl_list_for_each_reverse (child, &subsurface->surface->subsurfaces_above, link)
+		above = stack_below(child, above);
+	compositor_view_place_below(subsurface->view, above);
+	above = subsurface->view;
+	wl_list_for_each_reverse (child, &subsurface->surface->subsurfaces_below, link)
+		above = stack_below(child, above);
+
+	return above;
+}
+
+/**
+ * Restack the views of the whole subsurface tree that surface belongs to
+ * around the view of its root surface.
+ */
+static void
+restack(struct surface *surface)
+{
+	struct compositor_view *view, *top, *bottom;
+	struct subsurface *child;
+
+	while (surface->subsurface && surface->subsurface->parent)
+		surface = surface->subsurface->parent;
+
+	if (!surface->view || !(view = compositor_view(surface->view)))
+		return;
+
+	top = bottom = view;
+	wl_list_for_each (child, &surface->subsurfaces_above, link)
+		top = stack_above(child, top);
+	wl_list_for_each_reverse (child, &surface->subsurfaces_below, link)
+		bottom = stack_below(child, bottom);
+}
+
+static void
+update_position(struct subsurface *subsurface)
+{
+	struct view *parent_view = subsurface->parent_view;
+
+	if (!subsurface->view || !parent_view)
+		return;
+
+	view_move(&subsurface->view->base, parent_view->geometry.x + subsurface->x, parent_view->geometry.y + subsurface->y);
+}
+
+static void
+handle_parent_move(struct view_handler *handler)
+{
+	struct subsurface *subsurface = wl_container_of(handler, subsurface, parent_view_handler);
+	update_position(subsurface);
+}
+
+static const struct view_handler_impl parent_view_handler_impl = {
+	.move = handle_parent_move,
+};
+
+static void
+update_parent_view(struct subsurface *subsurface)
+{
+	struct view *parent_view = subsurface->parent ? subsurface->parent->view : NULL;
+
+	if (subsurface->parent_view == parent_view)
+		return;
+
+	if (subsurface->parent_view)
+		wl_list_remove(&subsurface->parent_view_handler.link);
+	if (parent_view)
+		wl_list_insert(&parent_view->handlers, &subsurface->parent_view_handler.link);
+	subsurface->parent_view = parent_view;
+
+	if (subsurface->view) {
+		struct compositor_view *parent_compositor_view = parent_view ? compositor_view(parent_view) : NULL;
+
+		/* The subsurface is only mapped while its parent is a mapped compositor
+		 * view. */
+		compositor_view_set_parent(subsurface->view, parent_compositor_view);
+		if (!parent_compositor_view)
+			compositor_view_hide(subsurface->view);
+		update_position(subsurface);
+	}
+}
+
+static void
+remove_parent(struct subsurface *subsurface)
+{
+	if (!subsurface->parent)
+		return;
+
+	wl_list_remove(&subsurface->link);
+	wl_list_remove(&subsurface->parent_destroy_listener.link);
+	subsurface->parent = NULL;
+	update_parent_view(subsurface);
+}
+
+static void
+handle_parent_destroy(struct wl_listener *listener, void *data)
+{
+	struct subsurface *subsurface = wl_container_of(listener, subsurface, parent_destroy_listener);
+	remove_parent(subsurface);
+}
+
+static void
+remove_surface(struct subsurface *subsurface)
+{
+	struct surface *surface = subsurface->surface;
+
+	if (!surface)
+		return;
+
+	remove_parent(subsurface);
+	wl_list_remove(&subsurface->surface_destroy_listener.link);
+	compositor_view_destroy(subsurface->view);
+	subsurface->view = NULL;
+	surface->subsurface = NULL;
+	subsurface->surface = NULL;
+}
+
+static void
+handle_surface_destroy(struct wl_listener *listener, void *data)
+{
+	struct subsurface *subsurface = wl_container_of(listener, subsurface, surface_destroy_listener);
+	remove_surface(subsurface);
+}
+
+static bool
+is_sibling(struct subsurface *subsurface, struct surface *surface)
+{
+	return surface != subsurface->surface && surface->subsurface && surface->subsurface->parent == subsurface->parent;
+}
+
 static void
 set_position(struct wl_client *client, struct wl_resource *resource, int32_t x, int32_t y)
 {
-	/* TODO: Implement. */
+	struct subsurface *subsurface = wl_resource_get_user_data(resource);
+
+	subsurface->pending.x = x;
+	subsurface->pending.y = y;
+	subsurface->pending.position = true;
 }
 
 static void
 place_above(struct wl_client *client, struct wl_resource *resource, struct wl_resource *sibling_resource)
 {
-	/* TODO: Implement. */
+	struct subsurface *subsurface = wl_resource_get_user_data(resource);
+	struct surface *sibling = wl_resource_get_user_data(sibling_resource);
+
+	if (!subsurface->parent)
+		return;
+
+	if (sibling == subsurface->parent) {
+		wl_list_remove(&subsurface->link);
+		wl_list_insert(&subsurface->parent->subsurfaces_above, &subsurface->link);
+	} else if (is_sibling(subsurface, sibling)) {
+		wl_list_remove(&subsurface->link);
+		wl_list_insert(&sibling->subsurface->link, &subsurface->link);
+	} else {
+		wl_resource_post_error(resource, WL_SUBSURFACE_ERROR_BAD_SURFACE, "surface is not a sibling or the parent");
+		return;
+	}
+
+	subsurface->pending.restack = true;
 }
 
 static void
 place_below(struct wl_client *client, struct wl_resource *resource, struct wl_resource *sibling_resource)
 {
-	/* TODO: Implement. */
+	struct subsurface *subsurface = wl_resource_get_user_data(resource);
+	struct surface *sibling = wl_resource_get_user_data(sibling_resource);
+
+	if (!subsurface->parent)
+		return;
+
+	if (sibling == subsurface->parent) {
+		wl_list_remove(&subsurface->link);
+		wl_list_insert(subsurface->parent->subsurfaces_below.prev, &subsurface->link);
+	} else if (is_sibling(subsurface, sibling)) {
+		wl_list_remove(&subsurface->link);
+		wl_list_insert(sibling->subsurface->link.prev, &subsurface->link);
+	} else {
+		wl_resource_post_error(resource, WL_SUBSURFACE_ERROR_BAD_SURFACE, "surface is not a sibling or the parent");
+		return;
+	}
+
+	subsurface->pending.restack = true;
 }
 
 static void
 set_sync(struct wl_client *client, struct wl_resource *resource)
 {
-	/* TODO: Implement. */
+	struct subsurface *subsurface = wl_resource_get_user_data(resource);
+
+	subsurface->synchronized = true;
 }
 
 static void
 set_desync(struct wl_client *client, struct wl_resource *resource)
 {
-	/* TODO: Implement. */
+	struct subsurface *subsurface = wl_resource_get_user_data(resource);
+
+	subsurface->synchronized = false;
+
+	/* If we are no longer synchronized, apply any state that was waiting on the
+	 * parent to be committed. */
+	if (subsurface->surface && !subsurface_is_synchronized(subsurface))
+		surface_apply_cached(subsurface->surface);
 }
 
 static const struct wl_subsurface_interface subsurface_impl = {
@@ -70,11 +280,13 @@ static void
 subsurface_destroy(struct wl_resource *resource)
 {
 	struct subsurface *subsurface = wl_resource_get_user_data(resource);
+
+	remove_surface(subsurface);
 	free(subsurface);
 }
 
 struct subsurface *
-subsurface_new(struct wl_client *client, uint32_t version, uint32_t id)
+subsurface_new(struct wl_client *client, uint32_t version, uint32_t id, struct surface *surface, struct surface *parent)
 {
 	struct subsurface *subsurface;
 
@@ -86,12 +298,102 @@ subsurface_new(struct wl_client *client, uint32_t version, uint32_t id)
 	if (!subsurface->resource)
 		goto error1;
 
+	if (!(subsurface->view = compositor_create_view(surface)))
+		goto error2;
+
 	wl_resource_set_implementation(subsurface->resource, &subsurface_impl, subsurface, &subsurface_destroy);
 
+	subsurface->surface = surface;
+	subsurface->parent = parent;
+	subsurface->parent_view = NULL;
+	subsurface->parent_view_handler.impl = &parent_view_handler_impl;
+	subsurface->x = 0;
+	subsurface->y = 0;
+	subsurface->synchronized = true;
+	subsurface->pending.position = false;
+	subsurface->pending.restack = false;
+	surface->subsurface = subsurface;
+
+	subsurface->surface_destroy_listener.notify = &handle_surface_destroy;
+	wl_resource_add_destroy_listener(surface->resource, &subsurface->surface_destroy_listener);
+	subsurface->parent_destroy_listener.notify = &handle_parent_destroy;
+	wl_resource_add_destroy_listener(parent->resource, &subsurface->parent_destroy_listener);
+
+	/* New subsurfaces are placed at the top of the stack of their siblings. */
+	wl_list_insert(parent->subsurfaces_above.prev, &subsurface->link);
+	update_parent_view(subsurface);
+	restack(parent);
+
 	return subsurface;
 
+error2:
+	wl_resource_destroy(subsurface->resource);
 error1:
 	free(subsurface);
 error0:
 	return NULL;
 }
+
+bool
+subsurface_is_synchronized(struct subsurface *subsurface)
+{
+	while (subsurface) {
+		if (subsurface->synchronized)
+			return true;
+		if (!subsurface->parent)
+			break;
+		subsurface = subsurface->parent->subsurface;
+	}
+
+	return false;
+}
+
+static void
+parent_commit(struct subsurface *subsurface, bool *needs_restack)
+{
+	if (subsurface->pending.position) {
+		subsurface->x = subsurface->pending.x;
+		subsurface->y = subsurface->pending.y;
+		subsurface->pending.position = false;
+		update_position(subsurface);
+	}
+
+	if (subsurface->pending.restack) {
+		subsurface->pending.restack = false;
+		*needs_restack = true;
+	}
+
+	if (subsurface_is_synchronized(subsurface))
+		surface_apply_cached(subsurface->surface);
+}
+
+void
+subsurface_handle_parent_commit(struct surface *parent)
+{
+	struct subsurface *subsurface;
+	bool needs_restack = false;
+
+	wl_list_for_each (subsurface, &parent->subsurfaces_below, link)
+		parent_commit(subsurface, &needs_restack);
+	wl_list_for_each (subsurface, &parent->subsurfaces_above, link)
+		parent_commit(subsurface, &needs_restack);
+
+	if (needs_restack)
+		restack(parent);
+}
+
+void
+subsurface_handle_parent_view(struct surface *parent)
+{
+	struct subsurface *subsurface;
+
+	if (wl_list_empty(&parent->subsurfaces_below) && wl_list_empty(&parent->subsurfaces_above))
+		return;
+
+	wl_list_for_each (subsurface, &parent->subsurfaces_below, link)
+		update_parent_view(subsurface);
+	wl_list_for_each (subsurface, &parent->subsurfaces_above, link)
+		update_parent_view(subsurface);
+
+	restack(parent);
+}
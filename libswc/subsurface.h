@@ -24,14 +24,58 @@
 #ifndef SWC_SUBSURFACE_H
 #define SWC_SUBSURFACE_H
 
+#include "view.h"
+
+#include <stdbool.h>
 #include <stdint.h>
+#include <wayland-server.h>
 
-struct wl_client;
+struct surface;
 
 struct subsurface {
 	struct wl_resource *resource;
+	struct surface *surface, *parent;
+	struct compositor_view *view;
+
+	/* The view of the parent surface, which this subsurface follows. */
+	struct view *parent_view;
+	struct view_handler parent_view_handler;
+
+	struct wl_listener surface_destroy_listener;
+	struct wl_listener parent_destroy_listener;
+
+	/* Position relative to the parent surface. */
+	int32_t x, y;
+	bool synchronized;
+
+	/* State that is applied when the parent surface is committed. */
+	struct {
+		int32_t x, y;
+		bool position, restack;
+	} pending;
+
+	/* Link in the parent's subsurfaces_above or subsurfaces_below. */
+	struct wl_list link;
 };
 
-struct subsurface *subsurface_new(struct wl_client *client, uint32_t version, uint32_t id);
+struct subsurface *subsurface_new(struct wl_client *client, uint32_t version, uint32_t id, struct surface *surface, struct surface *parent);
+
+/**
+ * Whether commits to the subsurface are cached, either because it or one of
+ * its ancestors is in synchronized mode.
+ */
+bool subsurface_is_synchronized(struct subsurface *subsurface);
+
+/**
+ * Apply the pending position and stacking of the subsurfaces of a surface
+ * whose state was just applied, along with any state cached by synchronized
+ * subsurfaces.
+ */
+void subsurface_handle_parent_commit(struct surface *parent);
+
+/**
+ * Update the subsurfaces of a surface after its view changes.
+ */
+void subsurface_handle_parent_view(struct surface *parent);
 
 #endif
@@ -22,11 +22,17 @@
  */
 
 #include "surface.h"
+#include "compositor.h"
+#include "dmabuf.h"
 #include "event.h"
 #include "internal.h"
+#include "latency.h"
 #include "output.h"
 #include "region.h"
 #include "screen.h"
+#include "stats.h"
+#include "subsurface.h"
+#include "trace.h"
 #include "util.h"
 #include "view.h"
 #include "wayland_buffer.h"
@@ -131,6 +137,8 @@ handle_screens(struct view_handler *handler, uint32_t entered, uint32_t left)
 			}
 		}
 	}
+
+	dmabuf_update_surface_feedback(surface);
 }
 
 static const struct view_handler_impl view_handler_impl = {
@@ -160,19 +168,31 @@ damage(struct wl_client *client, struct wl_resource *resource, int32_t x, int32_
 	pixman_region32_union_rect(&surface->pending.state.damage, &surface->pending.state.damage, x, y, width, height);
 }
 
+static void
+destroy_callback(struct wl_resource *resource)
+{
+	remove_resource(resource);
+	stats_remove(wl_resource_get_client(resource), STATS_FRAME_CALLBACK);
+}
+
 static void
 frame(struct wl_client *client, struct wl_resource *resource, uint32_t id)
 {
 	struct surface *surface = wl_resource_get_user_data(resource);
 	struct wl_resource *callback_resource;
 
+	if (!stats_add(client, STATS_FRAME_CALLBACK)) {
+		wl_resource_post_no_memory(resource);
+		return;
+	}
 	callback_resource = wl_resource_create(client, &wl_callback_interface, 1, id);
 	if (!callback_resource) {
+		stats_remove(client, STATS_FRAME_CALLBACK);
 		wl_resource_post_no_memory(resource);
 		return;
 	}
 	surface->pending.commit |= SURFACE_COMMIT_FRAME;
-	wl_resource_set_implementation(callback_resource, NULL, NULL, &remove_resource);
+	wl_resource_set_implementation(callback_resource, NULL, NULL, &destroy_callback);
 	wl_list_insert(surface->pending.state.frame_callbacks.prev, wl_resource_get_link(callback_resource));
 }
 
@@ -212,51 +232,132 @@ trim_region(pixman_region32_t *region, struct wld_buffer *buffer)
 	pixman_region32_intersect_rect(region, region, 0, 0, buffer ? buffer->width : 0, buffer ? buffer->height : 0);
 }
 
+/**
+ * Move the state from a pending commit into another, so that they may later be
+ * applied together.
+ */
 static void
-commit(struct wl_client *client, struct wl_resource *resource)
+pending_merge(struct surface *surface, struct surface_pending *dst, struct surface_pending *src)
 {
-	struct surface *surface = wl_resource_get_user_data(resource);
+	/* Attach */
+	if (src->commit & SURFACE_COMMIT_ATTACH) {
+		/* A buffer that was replaced before it was ever applied will not be used
+		 * by the compositor. */
+		if (dst->commit & SURFACE_COMMIT_ATTACH && dst->state.buffer
+		    && dst->state.buffer != src->state.buffer && dst->state.buffer != surface->state.buffer)
+			wl_buffer_send_release(dst->state.buffer);
+
+		state_set_buffer(&dst->state, src->state.buffer);
+		dst->x = src->x;
+		dst->y = src->y;
+	}
+
+	/* Damage */
+	if (src->commit & SURFACE_COMMIT_DAMAGE) {
+		pixman_region32_union(&dst->state.damage, &dst->state.damage, &src->state.damage);
+		pixman_region32_clear(&src->state.damage);
+	}
+
+	/* Opaque */
+	if (src->commit & SURFACE_COMMIT_OPAQUE)
+		pixman_region32_copy(&dst->state.opaque, &src->state.opaque);
+
+	/* Input */
+	if (src->commit & SURFACE_COMMIT_INPUT)
+		pixman_region32_copy(&dst->state.input, &src->state.input);
+
+	/* Frame */
+	if (src->commit & SURFACE_COMMIT_FRAME) {
+		wl_list_insert_list(dst->state.frame_callbacks.prev, &src->state.frame_callbacks);
+		wl_list_init(&src->state.frame_callbacks);
+	}
+
+	dst->commit |= src->commit;
+	src->commit = 0;
+}
+
+static void
+apply(struct surface *surface, struct surface_pending *pending)
+{
+	struct compositor_view *view;
 
 	/* Attach */
-	if (surface->pending.commit & SURFACE_COMMIT_ATTACH) {
-		if (surface->state.buffer && surface->state.buffer != surface->pending.state.buffer)
-			wl_buffer_send_release(surface->state.buffer);
+	if (pending->commit & SURFACE_COMMIT_ATTACH) {
+		if (surface->state.buffer && surface->state.buffer != pending->state.buffer) {
+			/* The buffer may still be scanned out on a plane. */
+			if (surface->view && (view = compositor_view(surface->view)))
+				compositor_view_release_buffer(view, surface->state.buffer);
+			else
+				wl_buffer_send_release(surface->state.buffer);
+		}
 
-		state_set_buffer(&surface->state, surface->pending.state.buffer);
+		state_set_buffer(&surface->state, pending->state.buffer);
 	}
 
 	surface->buffer = surface->state.buffer ? wayland_buffer_get(surface->state.buffer) : NULL;
 
 	/* Damage */
-	if (surface->pending.commit & SURFACE_COMMIT_DAMAGE) {
-		pixman_region32_union(&surface->state.damage, &surface->state.damage, &surface->pending.state.damage);
-		pixman_region32_clear(&surface->pending.state.damage);
+	if (pending->commit & SURFACE_COMMIT_DAMAGE) {
+		pixman_region32_union(&surface->state.damage, &surface->state.damage, &pending->state.damage);
+		pixman_region32_clear(&pending->state.damage);
 	}
 
 	/* Opaque */
-	if (surface->pending.commit & SURFACE_COMMIT_OPAQUE)
-		pixman_region32_copy(&surface->state.opaque, &surface->pending.state.opaque);
+	if (pending->commit & SURFACE_COMMIT_OPAQUE)
+		pixman_region32_copy(&surface->state.opaque, &pending->state.opaque);
 
 	/* Input */
-	if (surface->pending.commit & SURFACE_COMMIT_INPUT)
-		pixman_region32_copy(&surface->state.input, &surface->pending.state.input);
+	if (pending->commit & SURFACE_COMMIT_INPUT)
+		pixman_region32_copy(&surface->state.input, &pending->state.input);
 
 	/* Frame */
-	if (surface->pending.commit & SURFACE_COMMIT_FRAME) {
-		wl_list_insert_list(&surface->state.frame_callbacks, &surface->pending.state.frame_callbacks);
-		wl_list_init(&surface->pending.state.frame_callbacks);
+	if (pending->commit & SURFACE_COMMIT_FRAME) {
+		wl_list_insert_list(&surface->state.frame_callbacks, &pending->state.frame_callbacks);
+		wl_list_init(&pending->state.frame_callbacks);
 	}
 
 	trim_region(&surface->state.damage, surface->buffer);
 	trim_region(&surface->state.opaque, surface->buffer);
 
 	if (surface->view) {
-		if (surface->pending.commit & SURFACE_COMMIT_ATTACH)
+		if (pending->commit & SURFACE_COMMIT_ATTACH)
 			view_attach(surface->view, surface->buffer);
 		view_update(surface->view);
+		if (pixman_region32_not_empty(&surface->state.damage))
+			latency_commit(wl_resource_get_client(surface->resource), surface->view->screens);
+		if ((view = compositor_view(surface->view)))
+			compositor_view_commit(view);
 	}
 
-	surface->pending.commit = 0;
+	pending->commit = 0;
+
+	/* Subsurface position and stacking, as well as the state of synchronized
+	 * subsurfaces, are applied along with the state of the parent. */
+	subsurface_handle_parent_commit(surface);
+}
+
+static void
+commit(struct wl_client *client, struct wl_resource *resource)
+{
+	struct surface *surface = wl_resource_get_user_data(resource);
+	struct client_stats *stats;
+
+	TRACE_BEGIN("surface_commit");
+	if ((stats = stats_client(client)))
+		++stats->commits;
+	if (surface->subsurface && subsurface_is_synchronized(surface->subsurface)) {
+		pending_merge(surface, &surface->cached, &surface->pending);
+		TRACE_END();
+		return;
+	}
+
+	if (surface->cached.commit) {
+		pending_merge(surface, &surface->cached, &surface->pending);
+		apply(surface, &surface->cached);
+	} else {
+		apply(surface, &surface->pending);
+	}
+	TRACE_END();
 }
 
 static void
@@ -301,6 +402,7 @@ surface_destroy(struct wl_resource *resource)
 
 	state_finalize(&surface->state);
 	state_finalize(&surface->pending.state);
+	state_finalize(&surface->cached.state);
 
 	if (surface->view)
 		wl_list_remove(&surface->view_handler.link);
@@ -331,12 +433,17 @@ surface_new(struct wl_client *client, uint32_t version, uint32_t id)
 
 	/* Initialize the surface. */
 	surface->pending.commit = 0;
+	surface->cached.commit = 0;
 	surface->buffer = NULL;
 	surface->view = NULL;
 	surface->view_handler.impl = &view_handler_impl;
+	surface->subsurface = NULL;
+	wl_list_init(&surface->subsurfaces_above);
+	wl_list_init(&surface->subsurfaces_below);
 
 	state_initialize(&surface->state);
 	state_initialize(&surface->pending.state);
+	state_initialize(&surface->cached.state);
 
 	return surface;
 
@@ -362,4 +469,13 @@ surface_set_view(struct surface *surface, struct view *view)
 		view_attach(view, surface->buffer);
 		view_update(view);
 	}
+
+	subsurface_handle_parent_view(surface);
+}
+
+void
+surface_apply_cached(struct surface *surface)
+{
+	if (surface->cached.commit)
+		apply(surface, &surface->cached);
 }
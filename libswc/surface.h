@@ -53,23 +53,39 @@ struct surface_state {
 	struct wl_list frame_callbacks;
 };
 
+struct surface_pending {
+	struct surface_state state;
+	uint32_t commit;
+	int32_t x, y;
+};
+
 struct surface {
 	struct wl_resource *resource;
 
 	struct surface_state state;
+	struct surface_pending pending;
 
-	struct {
-		struct surface_state state;
-		uint32_t commit;
-		int32_t x, y;
-	} pending;
+	/* State committed while the surface is a synchronized subsurface, which is
+	 * applied when the parent surface's state is applied. */
+	struct surface_pending cached;
 
 	struct wld_buffer *buffer;
 	struct view *view;
 	struct view_handler view_handler;
+
+	/* The subsurface role of this surface, if any. */
+	struct subsurface *subsurface;
+
+	/* Subsurfaces stacked above and below this surface, bottom to top. */
+	struct wl_list subsurfaces_above, subsurfaces_below;
 };
 
 struct surface *surface_new(struct wl_client *client, uint32_t version, uint32_t id);
 void surface_set_view(struct surface *surface, struct view *view);
 
+/**
+ * Apply the state cached by a synchronized subsurface, if there is any.
+ */
+void surface_apply_cached(struct surface *surface);
+
 #endif
@@ -25,19 +25,32 @@
 #include "bindings.h"
 #include "compositor.h"
 #include "data_device_manager.h"
+#include "dispatch.h"
 #include "drm.h"
 #include "event.h"
+#include "headless.h"
+#include "input_record.h"
 #include "internal.h"
 #include "launch.h"
 #include "kde_decoration.h"
+#include "latency.h"
+#include "log.h"
 #include "keyboard.h"
+#ifdef ENABLE_WAYLAND_BACKEND
+# include "nested.h"
+#endif
 #include "panel_manager.h"
 #include "pointer.h"
+#include "record.h"
+#include "relative_pointer.h"
 #include "screen.h"
+#include "screencopy.h"
 #include "seat.h"
 #include "shell.h"
 #include "shm.h"
+#include "stats.h"
 #include "subcompositor.h"
+#include "trace.h"
 #include "util.h"
 #include "window.h"
 #include "xdg_decoration.h"
@@ -109,6 +122,80 @@ swc_deactivate(void)
 		swc.manager->deactivate();
 }
 
+static bool
+select_backend(void)
+{
+	const char *name;
+
+	if (!(name = getenv("SWC_BACKEND")) || strcmp(name, "drm") == 0) {
+		swc.backend = SWC_BACKEND_DRM;
+	} else if (strcmp(name, "headless") == 0) {
+		swc.backend = SWC_BACKEND_HEADLESS;
+#ifdef ENABLE_WAYLAND_BACKEND
+	} else if (strcmp(name, "wayland") == 0) {
+		swc.backend = SWC_BACKEND_WAYLAND;
+#endif
+	} else {
+		ERROR("Unknown backend \"%s\"\n", name);
+		return false;
+	}
+
+	return true;
+}
+
+static bool
+initialize_backend(void)
+{
+	switch (swc.backend) {
+	case SWC_BACKEND_DRM:
+		if (!launch_initialize()) {
+			ERROR("Could not connect to swc-launch\n");
+			return false;
+		}
+		if (!drm_initialize()) {
+			ERROR("Could not initialize DRM\n");
+			launch_finalize();
+			return false;
+		}
+		return true;
+	case SWC_BACKEND_HEADLESS:
+		if (!headless_initialize()) {
+			ERROR("Could not initialize headless backend\n");
+			return false;
+		}
+		return true;
+#ifdef ENABLE_WAYLAND_BACKEND
+	case SWC_BACKEND_WAYLAND:
+		if (!nested_initialize()) {
+			ERROR("Could not initialize Wayland backend\n");
+			return false;
+		}
+		return true;
+#endif
+	}
+
+	return false;
+}
+
+static void
+finalize_backend(void)
+{
+	switch (swc.backend) {
+	case SWC_BACKEND_DRM:
+		drm_finalize();
+		launch_finalize();
+		break;
+	case SWC_BACKEND_HEADLESS:
+		headless_finalize();
+		break;
+#ifdef ENABLE_WAYLAND_BACKEND
+	case SWC_BACKEND_WAYLAND:
+		nested_finalize();
+		break;
+#endif
+	}
+}
+
 EXPORT bool
 swc_initialize(struct wl_display *display, struct wl_event_loop *event_loop, const struct swc_manager *manager)
 {
@@ -117,136 +204,176 @@ swc_initialize(struct wl_display *display, struct wl_event_loop *event_loop, con
 	swc.manager = manager;
 	const char *default_seat = "seat0";
 	wl_signal_init(&swc.event_signal);
+	log_initialize();
+	dispatch_initialize();
+	trace_initialize();
+	latency_initialize();
 
-	if (!launch_initialize()) {
-		ERROR("Could not connect to swc-launch\n");
+	if (!select_backend() || !initialize_backend())
 		goto error0;
-	}
-
-	if (!drm_initialize()) {
-		ERROR("Could not initialize DRM\n");
-		goto error1;
-	}
 
 	swc.shm = shm_create(display);
 	if (!swc.shm) {
 		ERROR("Could not initialize SHM\n");
-		goto error2;
+		goto error1;
 	}
 
 	if (!bindings_initialize()) {
 		ERROR("Could not initialize bindings\n");
-		goto error3;
+		goto error2;
 	}
 
 	swc.subcompositor = subcompositor_create(display);
 	if (!swc.subcompositor) {
 		ERROR("Could not initialize subcompositor\n");
-		goto error4;
+		goto error3;
 	}
 
 	if (!screens_initialize()) {
 		ERROR("Could not initialize screens\n");
-		goto error5;
+		goto error4;
 	}
 
 	if (!compositor_initialize()) {
 		ERROR("Could not initialize compositor\n");
-		goto error6;
+		goto error5;
 	}
 
 	swc.data_device_manager = data_device_manager_create(display);
 	if (!swc.data_device_manager) {
 		ERROR("Could not initialize data device manager\n");
-		goto error7;
+		goto error6;
 	}
 
 	swc.seat = seat_create(display, default_seat);
 	if (!swc.seat) {
 		ERROR("Could not initialize seat\n");
-		goto error8;
+		goto error7;
 	}
 
 	swc.shell = shell_create(display);
 	if (!swc.shell) {
 		ERROR("Could not initialize shell\n");
-		goto error9;
+		goto error8;
 	}
 
 	swc.xdg_shell = xdg_shell_create(display);
 	if (!swc.xdg_shell) {
 		ERROR("Could not initialize XDG shell\n");
-		goto error10;
+		goto error9;
 	}
 
 	swc.xdg_decoration_manager = xdg_decoration_manager_create(display);
 	if (!swc.xdg_decoration_manager) {
 		ERROR("Could not initialize XDG decoration manager\n");
-		goto error11;
+		goto error10;
 	}
 
 	swc.kde_decoration_manager = kde_decoration_manager_create(display);
 	if (!swc.kde_decoration_manager) {
 		ERROR("Could not initialize KDE decoration manager\n");
-		goto error12;
+		goto error11;
 	}
 
 	swc.panel_manager = panel_manager_create(display);
 	if (!swc.panel_manager) {
 		ERROR("Could not initialize panel manager\n");
-		goto error13;
+		goto error12;
 	}
 
 	swc.xdg_output_manager = xdg_output_manager_create(display);
 	if (!swc.xdg_output_manager) {
 		ERROR("Could not initialize XDG output manager\n");
+		goto error13;
+	}
+
+	swc.screencopy_manager = screencopy_manager_create(display);
+	if (!swc.screencopy_manager) {
+		ERROR("Could not initialize screencopy manager\n");
 		goto error14;
 	}
 
+	swc.relative_pointer_manager = relative_pointer_manager_create(display);
+	if (!swc.relative_pointer_manager) {
+		ERROR("Could not initialize relative pointer manager\n");
+		goto error15;
+	}
+
+	if (!record_initialize()) {
+		ERROR("Could not initialize recording\n");
+		goto error16;
+	}
+
+	if (!input_record_initialize()) {
+		ERROR("Could not initialize input recording\n");
+		goto error17;
+	}
+
+	if (!stats_initialize()) {
+		ERROR("Could not initialize statistics\n");
+		goto error18;
+	}
+
 #ifdef ENABLE_XWAYLAND
 	if (!xserver_initialize()) {
 		ERROR("Could not initialize xwayland\n");
-		goto error15;
+		goto error19;
 	}
 #endif
 
 	setup_compositor();
 
+	/* There is no swc-launch to tell us when we become active. */
+	if (swc.backend != SWC_BACKEND_DRM)
+		swc_activate();
+
 	return true;
 
 #ifdef ENABLE_XWAYLAND
-error15:
-	wl_global_destroy(swc.xdg_output_manager);
+error19:
+	stats_finalize();
 #endif
+error18:
+	input_record_finalize();
+error17:
+	record_finalize();
+error16:
+	wl_global_destroy(swc.relative_pointer_manager);
+error15:
+	wl_global_destroy(swc.screencopy_manager);
 error14:
-	wl_global_destroy(swc.panel_manager);
+	wl_global_destroy(swc.xdg_output_manager);
 error13:
-	wl_global_destroy(swc.kde_decoration_manager);
+	wl_global_destroy(swc.panel_manager);
 error12:
-	wl_global_destroy(swc.xdg_decoration_manager);
+	wl_global_destroy(swc.kde_decoration_manager);
 error11:
-	wl_global_destroy(swc.xdg_shell);
+	wl_global_destroy(swc.xdg_decoration_manager);
 error10:
-	wl_global_destroy(swc.shell);
+	wl_global_destroy(swc.xdg_shell);
 error9:
-	seat_destroy(swc.seat);
+	wl_global_destroy(swc.shell);
 error8:
-	wl_global_destroy(swc.data_device_manager);
+	seat_destroy(swc.seat);
 error7:
-	compositor_finalize();
+	wl_global_destroy(swc.data_device_manager);
 error6:
-	screens_finalize();
+	compositor_finalize();
 error5:
-	wl_global_destroy(swc.subcompositor);
+	screens_finalize();
 error4:
-	bindings_finalize();
+	wl_global_destroy(swc.subcompositor);
 error3:
-	shm_destroy(swc.shm);
+	bindings_finalize();
 error2:
-	drm_finalize();
+	shm_destroy(swc.shm);
 error1:
-	launch_finalize();
+	finalize_backend();
 error0:
+	latency_finalize();
+	trace_finalize();
+	dispatch_finalize();
+	log_finalize();
 	return false;
 }
 
@@ -256,6 +383,11 @@ swc_finalize(void)
 #ifdef ENABLE_XWAYLAND
 	xserver_finalize();
 #endif
+	stats_finalize();
+	input_record_finalize();
+	record_finalize();
+	wl_global_destroy(swc.relative_pointer_manager);
+	wl_global_destroy(swc.screencopy_manager);
 	wl_global_destroy(swc.xdg_output_manager);
 	wl_global_destroy(swc.panel_manager);
 	wl_global_destroy(swc.xdg_decoration_manager);
@@ -267,6 +399,9 @@ swc_finalize(void)
 	screens_finalize();
 	bindings_finalize();
 	shm_destroy(swc.shm);
-	drm_finalize();
-	launch_finalize();
+	finalize_backend();
+	latency_finalize();
+	trace_finalize();
+	dispatch_finalize();
+	log_finalize();
 }
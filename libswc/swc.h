@@ -32,8 +32,11 @@ extern "C" {
 #endif
 
 struct libinput_device;
+struct pixman_region32;
+struct wl_client;
 struct wl_display;
 struct wl_event_loop;
+struct wld_buffer;
 
 /* Rectangles {{{ */
 
@@ -91,6 +94,15 @@ struct swc_screen {
  */
 void swc_screen_set_handler(struct swc_screen *screen, const struct swc_screen_handler *handler, void *data);
 
+/**
+ * Set the pixel format (a DRM fourcc code) of the buffers the screen is
+ * composited into. Narrower formats such as RGB565 reduce the memory bandwidth
+ * used by the display engine at the cost of color depth.
+ *
+ * Returns false if the screen can not scan out the format.
+ */
+bool swc_screen_set_format(struct swc_screen *screen, uint32_t format);
+
 /* }}} */
 
 /* Windows {{{ */
@@ -266,6 +278,41 @@ void swc_window_begin_resize(struct swc_window *window, uint32_t edges);
  */
 void swc_window_end_resize(struct swc_window *window);
 
+struct swc_window_capture_handler {
+	/**
+	 * Called when the window's surface commits new contents, whether or not
+	 * the window is visible.
+	 *
+	 * The buffer is the one the window is composited from: the client's own
+	 * buffer, or the compositor's copy of it if the renderer can't use it
+	 * directly. The damage is the area that changed since the previous call,
+	 * in buffer coordinates. The contents are only guaranteed until the
+	 * function returns.
+	 */
+	void (*frame)(void *data, struct wld_buffer *buffer, struct pixman_region32 *damage);
+
+	/**
+	 * Called when the window is destroyed, after which the capture is no
+	 * longer valid.
+	 */
+	void (*destroy)(void *data);
+};
+
+struct swc_window_capture;
+
+/**
+ * Start capturing the contents of a window without compositing it.
+ *
+ * If the window already has a buffer, the frame handler is called right away
+ * with the whole buffer damaged.
+ */
+struct swc_window_capture *swc_window_capture(struct swc_window *window, const struct swc_window_capture_handler *handler, void *data);
+
+/**
+ * Stop capturing a window.
+ */
+void swc_window_capture_destroy(struct swc_window_capture *capture);
+
 /* }}} */
 
 /* Bindings {{{ */
@@ -294,6 +341,131 @@ int swc_add_binding(enum swc_binding_type type, uint32_t modifiers, uint32_t val
 
 /* }}} */
 
+/* Logging {{{ */
+
+enum swc_log_level {
+	SWC_LOG_ERROR,
+	SWC_LOG_WARNING,
+	SWC_LOG_INFO,
+	SWC_LOG_DEBUG,
+};
+
+/**
+ * Set the most verbose level of messages to record for a subsystem, named
+ * after its source file (for example, "drm" or "compositor"), or for every
+ * subsystem if subsystem is NULL.
+ *
+ * The initial levels come from SWC_LOG, a comma-separated list of levels, each
+ * optionally preceded by a subsystem and '=', such as "warning,drm=debug".
+ */
+void swc_log_set_level(const char *subsystem, enum swc_log_level level);
+
+/**
+ * Write the most recent recorded messages to a file descriptor, including
+ * those below the level printed to stderr.
+ */
+void swc_log_dump(int fd);
+
+/* }}} */
+
+/* Debugging {{{ */
+
+/**
+ * Show what is repainted on each frame, as lines over the repainted region
+ * that fade over the next few frames. Regions copied from SHM buffers are
+ * marked in green, border fills in yellow, and all other repaints in magenta.
+ *
+ * This can also be enabled at startup by setting SWC_SHOW_DAMAGE.
+ */
+void swc_show_damage(bool show);
+
+/**
+ * Write a table of the time spent dispatching each of swc's event sources,
+ * such as input devices, DRM events and the X window manager, to a file
+ * descriptor.
+ */
+void swc_dispatch_dump(int fd);
+
+/* }}} */
+
+/* Statistics {{{ */
+
+#define SWC_STATS_PAGE_MAGIC 0x73637773 /* "swcs" */
+#define SWC_STATS_PAGE_VERSION 1
+
+/**
+ * The contents of the file named by SWC_STATS_PAGE, which swc updates after
+ * every repaint, for monitoring tools to map and read without involving the
+ * compositor.
+ *
+ * The fields are written under a sequence lock: readers must load sequence
+ * with acquire semantics before copying the other fields, and retry if it was
+ * odd or has changed afterwards. Times are in nanoseconds.
+ */
+struct swc_stats_page {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t sequence;
+	uint32_t reserved;
+
+	/* The CLOCK_MONOTONIC time of the last update. */
+	uint64_t time;
+
+	/* Frames shown, and vblanks that passed while a frame waited to be shown. */
+	uint64_t frames;
+	uint64_t missed_vblanks;
+	/* The area repainted, in pixels. */
+	uint64_t damage_pixels;
+
+	/* Time spent in whole updates, calculating damage (which includes
+	 * copying client buffers), repainting screens, and copying client
+	 * buffers. */
+	uint64_t update_time;
+	uint64_t damage_time;
+	uint64_t repaint_time;
+	uint64_t flush_time;
+
+	/* Bytes copied from SHM buffers. */
+	uint64_t shm_bytes;
+	/* Bytes of buffers allocated to hold copies of client buffers. */
+	uint64_t buffer_bytes;
+};
+
+/**
+ * The resources a client makes the compositor hold on its behalf.
+ */
+struct swc_client_usage {
+	/* Bytes of SHM pools mapped, dmabufs imported, and buffers allocated to
+	 * hold copies of the client's buffers. */
+	uint64_t pool_bytes;
+	uint64_t dmabuf_bytes;
+	uint64_t proxy_bytes;
+
+	uint32_t pools;
+	uint32_t dmabufs;
+	uint32_t proxies;
+	uint32_t buffers;
+	uint32_t frame_callbacks;
+};
+
+/**
+ * Get the resources used by a client. Returns false if the client is not
+ * known to swc.
+ */
+bool swc_client_get_usage(struct wl_client *client, struct swc_client_usage *usage);
+
+/**
+ * Set the limits on the resources used by each client, where fields that are
+ * zero are unlimited, and NULL removes all limits of that kind.
+ *
+ * When a client first goes over a soft limit, the manager's client_over_limit
+ * callback is called. A request that would put a client over a hard limit
+ * fails, and the client is disconnected.
+ */
+void swc_set_client_limits(const struct swc_client_usage *soft, const struct swc_client_usage *hard);
+
+/* }}} */
+
 /**
  * This is a user-provided structure that swc will use to notify the display
  * server of new windows, screens and input devices.
@@ -323,6 +495,23 @@ struct swc_manager {
 	 * Called when the session gets deactivated.
 	 */
 	void (*deactivate)(void);
+
+	/**
+	 * Called when a client binds swc_stats_manager, which reports on every
+	 * other client. Returns whether the client may use it. If this is NULL,
+	 * no client may.
+	 */
+	bool (*allow_stats)(struct wl_client *client);
+
+	/**
+	 * Called when a client goes over one of the soft limits set with
+	 * swc_set_client_limits. It is called again only after the client has
+	 * gone back under all of them.
+	 *
+	 * It is called from the event loop once the request that went over the
+	 * limit has been handled, so it may destroy the client.
+	 */
+	void (*client_over_limit)(struct wl_client *client, const struct swc_client_usage *usage);
 };
 
 /**
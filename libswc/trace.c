@@ -0,0 +1,306 @@
+/* swc: libswc/trace.c
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "trace.h"
+#include "dispatch.h"
+#include "internal.h"
+#include "util.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wayland-server.h>
+#ifdef __linux__
+# include <sys/syscall.h>
+#endif
+
+/* Must be a power of two. */
+#define BUFFER_SIZE (1 << 16)
+
+struct event {
+	uint64_t time;
+	const char *name;
+	int64_t value;
+	enum trace_type type;
+};
+
+/* Each thread has its own ring buffer, written only by that thread. The head
+ * counts every event ever written, so the flusher can tell which of the slots
+ * it read may have been overwritten in the meantime. */
+struct buffer {
+	struct event events[BUFFER_SIZE];
+	_Atomic uint64_t head;
+	uint64_t tail;
+	pid_t tid;
+	struct buffer *next;
+};
+
+bool trace_enabled;
+
+static struct {
+	FILE *file;
+	int marker;
+	pid_t pid;
+	struct wl_event_source *signal_source;
+	_Atomic(struct buffer *) buffers;
+	struct event *scratch;
+	bool first;
+} trace = {.marker = -1};
+
+static _Thread_local struct buffer *local_buffer;
+
+static pid_t
+get_tid(void)
+{
+#ifdef __linux__
+	return syscall(SYS_gettid);
+#else
+	return 0;
+#endif
+}
+
+static struct buffer *
+buffer_new(void)
+{
+	struct buffer *buffer;
+
+	if (!(buffer = calloc(1, sizeof(*buffer))))
+		return NULL;
+	buffer->tid = get_tid();
+	buffer->next = atomic_load_explicit(&trace.buffers, memory_order_relaxed);
+	while (!atomic_compare_exchange_weak_explicit(&trace.buffers, &buffer->next, buffer, memory_order_release, memory_order_relaxed))
+		;
+
+	return buffer;
+}
+
+static void
+write_marker(enum trace_type type, const char *name, int64_t value)
+{
+	char line[256];
+	int len = 0;
+
+	switch (type) {
+	case TRACE_TYPE_BEGIN:
+		len = snprintf(line, sizeof(line), "B|%d|%s", (int)trace.pid, name);
+		break;
+	case TRACE_TYPE_END:
+		len = snprintf(line, sizeof(line), "E|%d", (int)trace.pid);
+		break;
+	case TRACE_TYPE_COUNTER:
+		len = snprintf(line, sizeof(line), "C|%d|%s|%" PRId64, (int)trace.pid, name, value);
+		break;
+	}
+	if (len > 0)
+		write(trace.marker, line, MIN(len, sizeof(line) - 1));
+}
+
+void
+trace_event(enum trace_type type, const char *name, int64_t value)
+{
+	struct buffer *buffer = local_buffer;
+	struct event *event;
+	uint64_t head;
+
+	if (trace.marker != -1) {
+		write_marker(type, name, value);
+		return;
+	}
+
+	if (!buffer && !(buffer = local_buffer = buffer_new()))
+		return;
+
+	head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+	event = &buffer->events[head & (BUFFER_SIZE - 1)];
+	event->time = get_monotonic_ns();
+	event->name = name;
+	event->value = value;
+	event->type = type;
+	atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+static void
+write_event(struct event *event, pid_t tid)
+{
+	static const char phase[] = {
+		[TRACE_TYPE_BEGIN] = 'B',
+		[TRACE_TYPE_END] = 'E',
+		[TRACE_TYPE_COUNTER] = 'C',
+	};
+
+	fprintf(trace.file, "%s{\"ph\":\"%c\",\"ts\":%" PRIu64 ".%03u,\"pid\":%d,\"tid\":%d",
+	        trace.first ? "" : ",\n", phase[event->type],
+	        event->time / 1000, (unsigned)(event->time % 1000), (int)trace.pid, (int)tid);
+	if (event->name)
+		fprintf(trace.file, ",\"name\":\"%s\"", event->name);
+	if (event->type == TRACE_TYPE_COUNTER)
+		fprintf(trace.file, ",\"args\":{\"value\":%" PRId64 "}", event->value);
+	fputc('}', trace.file);
+	trace.first = false;
+}
+
+static void
+flush_buffer(struct buffer *buffer)
+{
+	uint64_t head, start, valid, index;
+	uint32_t count, skip;
+
+	head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+	start = head - buffer->tail > BUFFER_SIZE ? head - BUFFER_SIZE : buffer->tail;
+	for (index = start, count = 0; index != head; ++index, ++count)
+		trace.scratch[count] = buffer->events[index & (BUFFER_SIZE - 1)];
+
+	/* The owning thread may have wrapped around while we were copying, so
+	 * discard any events whose slots were reused, including the one it may
+	 * be writing right now. */
+	atomic_thread_fence(memory_order_acquire);
+	index = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+	valid = index >= BUFFER_SIZE ? index - BUFFER_SIZE + 1 : 0;
+	skip = valid > start ? MIN(valid - start, count) : 0;
+
+	if (start + skip != buffer->tail)
+		WARNING("Dropped %" PRIu64 " trace events on thread %d\n", start + skip - buffer->tail, (int)buffer->tid);
+
+	for (; skip < count; ++skip)
+		write_event(&trace.scratch[skip], buffer->tid);
+	buffer->tail = head;
+}
+
+void
+trace_flush(void)
+{
+	struct buffer *buffer;
+
+	if (!trace.file)
+		return;
+
+	buffer = atomic_load_explicit(&trace.buffers, memory_order_acquire);
+	for (; buffer; buffer = buffer->next)
+		flush_buffer(buffer);
+	fflush(trace.file);
+}
+
+static int
+handle_signal(int signal, void *data)
+{
+	trace_flush();
+	return 0;
+}
+
+static bool
+open_marker(void)
+{
+	static const char *paths[] = {
+		"/sys/kernel/tracing/trace_marker",
+		"/sys/kernel/debug/tracing/trace_marker",
+	};
+	unsigned i;
+
+	for (i = 0; i < ARRAY_LENGTH(paths); ++i) {
+		if ((trace.marker = open(paths[i], O_WRONLY | O_CLOEXEC)) != -1)
+			return true;
+	}
+
+	return false;
+}
+
+void
+trace_initialize(void)
+{
+	const char *path;
+
+	if (!(path = getenv("SWC_TRACE")))
+		return;
+
+	trace.pid = getpid();
+
+	if (strcmp(path, "ftrace") == 0) {
+		if (!open_marker()) {
+			WARNING("Could not open trace_marker: %s\n", strerror(errno));
+			return;
+		}
+		trace_enabled = true;
+		return;
+	}
+
+	if (!(trace.file = fopen(path, "we"))) {
+		WARNING("Could not open trace file '%s': %s\n", path, strerror(errno));
+		return;
+	}
+	if (!(trace.scratch = malloc(BUFFER_SIZE * sizeof(*trace.scratch)))) {
+		WARNING("Could not allocate trace buffer\n");
+		goto error0;
+	}
+	trace.signal_source = dispatch_add_signal("trace", SIGUSR2, &handle_signal, NULL);
+	if (!trace.signal_source)
+		WARNING("Could not create trace signal source; trace will be written on exit\n");
+
+	fputs("[\n", trace.file);
+	trace.first = true;
+	trace_enabled = true;
+	return;
+
+error0:
+	fclose(trace.file);
+	trace.file = NULL;
+}
+
+void
+trace_finalize(void)
+{
+	struct buffer *buffer, *next;
+
+	if (!trace_enabled)
+		return;
+	trace_enabled = false;
+
+	if (trace.marker != -1) {
+		close(trace.marker);
+		trace.marker = -1;
+		return;
+	}
+
+	if (trace.signal_source)
+		dispatch_remove(trace.signal_source);
+	trace_flush();
+	fputs("\n]\n", trace.file);
+	fclose(trace.file);
+	trace.file = NULL;
+	free(trace.scratch);
+
+	/* Other threads have been stopped by now, so it is safe to free their
+	 * buffers. */
+	buffer = atomic_exchange(&trace.buffers, NULL);
+	for (; buffer; buffer = next) {
+		next = buffer->next;
+		free(buffer);
+	}
+	local_buffer = NULL;
+}
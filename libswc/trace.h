@@ -0,0 +1,79 @@
+/* swc: libswc/trace.h
+ *
+ * Copyright (c) 2026 Michael Forney
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SWC_TRACE_H
+#define SWC_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tracing is enabled by setting SWC_TRACE. If it is "ftrace", events are
+ * written to the kernel's trace_marker as they occur, in the format used by
+ * atrace. Otherwise, it names a file, and each thread records events into its
+ * own ring buffer, which is appended to the file in the Chrome trace event
+ * format when the compositor receives SIGUSR2 or exits.
+ *
+ * When tracing is disabled, each trace point costs a single predicted branch. */
+
+enum trace_type {
+	TRACE_TYPE_BEGIN,
+	TRACE_TYPE_END,
+	TRACE_TYPE_COUNTER,
+};
+
+extern bool trace_enabled;
+
+#define TRACE_BEGIN(name) \
+	do { \
+		if (__builtin_expect(trace_enabled, 0)) \
+			trace_event(TRACE_TYPE_BEGIN, name, 0); \
+	} while (0)
+#define TRACE_END() \
+	do { \
+		if (__builtin_expect(trace_enabled, 0)) \
+			trace_event(TRACE_TYPE_END, NULL, 0); \
+	} while (0)
+#define TRACE_COUNTER(name, value) \
+	do { \
+		if (__builtin_expect(trace_enabled, 0)) \
+			trace_event(TRACE_TYPE_COUNTER, name, value); \
+	} while (0)
+
+/**
+ * Record a trace event for the calling thread.
+ *
+ * The name must be a string literal, or otherwise outlive the trace.
+ */
+void trace_event(enum trace_type type, const char *name, int64_t value);
+
+/**
+ * Write out the events recorded since the last flush.
+ */
+void trace_flush(void);
+
+void trace_initialize(void);
+void trace_finalize(void);
+
+#endif
@@ -25,38 +25,23 @@
 #define SWC_UTIL_H
 
 #include "swc.h"
+#include "log.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
 #include <sys/time.h>
+#include <time.h>
 #include <pixman.h>
 #include <wayland-util.h>
 
 #define EXPORT __attribute__((visibility("default")))
 
-#if ENABLE_DEBUG
-#define MESSAGE_SOURCE \
-	fprintf(stderr, "[swc:%s:%d] ", __FILE__, __LINE__);
-#else
-#define MESSAGE_SOURCE
-#endif
-
-#define MESSAGE(type, format, ...) \
-	do { \
-		MESSAGE_SOURCE \
-		fprintf(stderr, type ": " format, ##__VA_ARGS__); \
-	} while (false)
-
-#define WARNING(format, ...) MESSAGE("WARNING", format, ##__VA_ARGS__)
-#define ERROR(format, ...) MESSAGE("ERROR", format, ##__VA_ARGS__)
-
-#if ENABLE_DEBUG
-#define DEBUG(format, ...) MESSAGE("DEBUG", format, ##__VA_ARGS__)
-#else
-#define DEBUG(format, ...)
-#endif
+#define ERROR(format, ...) LOG(SWC_LOG_ERROR, format, ##__VA_ARGS__)
+#define WARNING(format, ...) LOG(SWC_LOG_WARNING, format, ##__VA_ARGS__)
+#define INFO(format, ...) LOG(SWC_LOG_INFO, format, ##__VA_ARGS__)
+#define DEBUG(format, ...) LOG(SWC_LOG_DEBUG, format, ##__VA_ARGS__)
 
 #define ARRAY_LENGTH(array) (sizeof(array) / sizeof(array)[0])
 
@@ -78,6 +63,16 @@ get_time(void)
 	return timeval.tv_sec * 1000 + timeval.tv_usec / 1000;
 }
 
+/* Nanoseconds on the monotonic clock, for measuring intervals. */
+static inline uint64_t
+get_monotonic_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
 extern pixman_box32_t infinite_extents;
 
 static inline bool
@@ -24,6 +24,7 @@
 #include "wayland_buffer.h"
 #include "internal.h"
 #include "shm.h"
+#include "stats.h"
 #include "util.h"
 
 #include <wld/wld.h>
@@ -46,6 +47,8 @@ static void
 destroy_buffer(struct wl_resource *resource)
 {
 	struct wld_buffer *buffer = wl_resource_get_user_data(resource);
+
+	stats_remove(wl_resource_get_client(resource), STATS_BUFFER);
 	wld_buffer_unreference(buffer);
 }
 
@@ -54,8 +57,12 @@ wayland_buffer_create_resource(struct wl_client *client, uint32_t version, uint3
 {
 	struct wl_resource *resource;
 
+	if (!stats_add(client, STATS_BUFFER))
+		return NULL;
 	resource = wl_resource_create(client, &wl_buffer_interface, version, id);
 	if (resource)
 		wl_resource_set_implementation(resource, &buffer_impl, buffer, &destroy_buffer);
+	else
+		stats_remove(client, STATS_BUFFER);
 	return resource;
 }
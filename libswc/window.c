@@ -27,12 +27,14 @@
 #include "internal.h"
 #include "keyboard.h"
 #include "seat.h"
+#include "surface.h"
 #include "swc.h"
 #include "util.h"
 #include "view.h"
 
 #include <stdlib.h>
 #include <string.h>
+#include <wld/wld.h>
 
 #define INTERNAL(w) ((struct window *)(w))
 
@@ -359,6 +361,73 @@ static const struct view_handler_impl view_handler_impl = {
 	.resize = handle_resize,
 };
 
+struct swc_window_capture {
+	struct window *window;
+	const struct swc_window_capture_handler *handler;
+	void *data;
+	struct wl_listener view_commit_listener;
+	struct wl_listener view_destroy_listener;
+};
+
+static void
+handle_capture_view_commit(struct wl_listener *listener, void *data)
+{
+	struct swc_window_capture *capture = wl_container_of(listener, capture, view_commit_listener);
+	pixman_region32_t *damage = data;
+
+	capture->handler->frame(capture->data, capture->window->view->buffer, damage);
+}
+
+static void
+handle_capture_view_destroy(struct wl_listener *listener, void *data)
+{
+	struct swc_window_capture *capture = wl_container_of(listener, capture, view_destroy_listener);
+	const struct swc_window_capture_handler *handler = capture->handler;
+	void *handler_data = capture->data;
+
+	swc_window_capture_destroy(capture);
+	if (handler->destroy)
+		handler->destroy(handler_data);
+}
+
+EXPORT struct swc_window_capture *
+swc_window_capture(struct swc_window *base, const struct swc_window_capture_handler *handler, void *data)
+{
+	struct window *window = INTERNAL(base);
+	struct swc_window_capture *capture;
+	struct wld_buffer *buffer;
+
+	if (!(capture = malloc(sizeof(*capture))))
+		return NULL;
+
+	capture->window = window;
+	capture->handler = handler;
+	capture->data = data;
+	capture->view_commit_listener.notify = &handle_capture_view_commit;
+	wl_signal_add(&window->view->commit_signal, &capture->view_commit_listener);
+	capture->view_destroy_listener.notify = &handle_capture_view_destroy;
+	wl_signal_add(&window->view->destroy_signal, &capture->view_destroy_listener);
+
+	if ((buffer = window->view->base.buffer)) {
+		pixman_region32_t damage;
+
+		pixman_region32_init_rect(&damage, 0, 0, buffer->width, buffer->height);
+		if ((buffer = compositor_view_flush(window->view, &damage)))
+			handler->frame(data, buffer, &damage);
+		pixman_region32_fini(&damage);
+	}
+
+	return capture;
+}
+
+EXPORT void
+swc_window_capture_destroy(struct swc_window_capture *capture)
+{
+	wl_list_remove(&capture->view_commit_listener.link);
+	wl_list_remove(&capture->view_destroy_listener.link);
+	free(capture);
+}
+
 bool
 window_initialize(struct window *window, const struct window_impl *impl, struct surface *surface)
 {
@@ -456,8 +525,8 @@ window_set_parent(struct window *window, struct window *parent)
 	if (window->base.parent == &parent->base)
 		return;
 
-	compositor_view_set_parent(window->view, parent->view);
-	window->base.parent = &parent->base;
+	compositor_view_set_parent(window->view, parent ? parent->view : NULL);
+	window->base.parent = parent ? &parent->base : NULL;
 
 	if (window->handler->parent_changed)
 		window->handler->parent_changed(window->handler_data);
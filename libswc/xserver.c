@@ -26,6 +26,7 @@
  */
 
 #include "xserver.h"
+#include "dispatch.h"
 #include "internal.h"
 #include "util.h"
 #include "xwm.h"
@@ -190,7 +191,7 @@ handle_usr1(int signal_number, void *data)
 		/* XXX: How do we handle this case? */
 	}
 
-	wl_event_source_remove(xserver.usr1_source);
+	dispatch_remove(xserver.usr1_source);
 
 	return 0;
 }
@@ -215,7 +216,7 @@ xserver_initialize(void)
 		goto error0;
 	}
 
-	xserver.usr1_source = wl_event_loop_add_signal(swc.event_loop, SIGUSR1, &handle_usr1, NULL);
+	xserver.usr1_source = dispatch_add_signal("xserver", SIGUSR1, &handle_usr1, NULL);
 
 	if (!xserver.usr1_source) {
 		ERROR("Failed to create SIGUSR1 event source\n");
@@ -301,7 +302,7 @@ error3:
 	close(wl[1]);
 	close(wl[0]);
 error2:
-	wl_event_source_remove(xserver.usr1_source);
+	dispatch_remove(xserver.usr1_source);
 error1:
 	close_display();
 error0:
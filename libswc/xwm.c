@@ -23,9 +23,11 @@
 
 #include "xwm.h"
 #include "compositor.h"
+#include "dispatch.h"
 #include "internal.h"
 #include "surface.h"
 #include "swc.h"
+#include "trace.h"
 #include "util.h"
 #include "view.h"
 #include "window.h"
@@ -383,6 +385,7 @@ connection_data(int fd, uint32_t mask, void *data)
 	xcb_generic_event_t *event;
 	uint32_t count = 0;
 
+	TRACE_BEGIN("xwm_connection_data");
 	while ((event = xcb_poll_for_event(xwm.connection))) {
 		switch (event->response_type & ~0x80) {
 		case XCB_CREATE_NOTIFY:
@@ -410,6 +413,8 @@ connection_data(int fd, uint32_t mask, void *data)
 	}
 
 	xcb_flush(xwm.connection);
+	TRACE_COUNTER("xwm_events", count);
+	TRACE_END();
 
 	return count;
 }
@@ -458,7 +463,7 @@ xwm_initialize(int fd)
 	values[0] = XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY | XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT;
 	change_attributes_cookie = xcb_change_window_attributes(xwm.connection, xwm.screen->root, mask, values);
 
-	xwm.source = wl_event_loop_add_fd(swc.event_loop, fd, WL_EVENT_READABLE, &connection_data, NULL);
+	xwm.source = dispatch_add_fd("xwm", fd, WL_EVENT_READABLE, &connection_data, NULL);
 	wl_list_init(&xwm.windows);
 	wl_list_init(&xwm.unpaired_windows);
 
@@ -520,7 +525,7 @@ xwm_initialize(int fd)
 	return true;
 
 error3:
-	wl_event_source_remove(xwm.source);
+	dispatch_remove(xwm.source);
 error2:
 	xcb_ewmh_connection_wipe(&xwm.ewmh);
 error1:
@@ -532,7 +537,7 @@ error0:
 void
 xwm_finalize(void)
 {
-	wl_event_source_remove(xwm.source);
+	dispatch_remove(xwm.source);
 	xcb_ewmh_connection_wipe(&xwm.ewmh);
 	xcb_disconnect(xwm.connection);
 }
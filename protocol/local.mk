@@ -7,8 +7,10 @@ PROTOCOL_EXTENSIONS =           \
     $(dir)/server-decoration.xml\
     $(dir)/swc.xml              \
     $(dir)/wayland-drm.xml      \
+    $(dir)/wlr-screencopy-unstable-v1.xml \
     $(wayland_protocols)/stable/xdg-shell/xdg-shell.xml \
     $(wayland_protocols)/unstable/linux-dmabuf/linux-dmabuf-unstable-v1.xml \
+    $(wayland_protocols)/unstable/relative-pointer/relative-pointer-unstable-v1.xml \
     $(wayland_protocols)/unstable/xdg-decoration/xdg-decoration-unstable-v1.xml \
     $(wayland_protocols)/unstable/xdg-output/xdg-output-unstable-v1.xml
 
@@ -20,8 +22,10 @@ $(dir)/$$(basename $$(notdir $(1)))-protocol.c: $(1)
 	$$(Q_GEN)$$(WAYLAND_SCANNER) private-code <$$< >$$@
 $(dir)/$$(basename $$(notdir $(1)))-server-protocol.h: $(1)
 	$$(Q_GEN)$$(WAYLAND_SCANNER) server-header <$$< >$$@
+$(dir)/$$(basename $$(notdir $(1)))-client-protocol.h: $(1)
+	$$(Q_GEN)$$(WAYLAND_SCANNER) client-header <$$< >$$@
 
-CLEAN_FILES += $(foreach type,protocol.c server-protocol.h, \
+CLEAN_FILES += $(foreach type,protocol.c server-protocol.h client-protocol.h, \
                  $(dir)/$$(basename $$(notdir $(1)))-$(type))
 
 endef